@@ -4,6 +4,26 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <unistd.h>
+
+#include "WebPageLinker.h"
+#include "reader.h"
+#include "output.h"
+#include "snapshot.h"
+#include "import.h"
+#include "packed.h"
+#include "k2tree.h"
+#include "pipeline.h"
+#include "parallel.h"
+#include "journal.h"
+#include "binproto.h"
+#include "server.h"
+#include "query.h"
+#include "ingest.h"
+#include "dict.h"
+#include "uring.h"
+#include "stats.h"
+
 
 /*
  * File: linked.c
@@ -15,163 +35,425 @@
 
 
 
+struct page *graphHead = NULL;
+struct page *graphTail = NULL;
+
+
+
 /*
- * page -- Represents a web page in a directed graph. 
- * Each page has a unique name and may contain links to other pages. 
- * It includes a linked list of outgoing links for efficient graph traversal. 
- * The `next` pointer links to the next page in the list, 
- * while `edges` points to the list of outgoing links. 
- * The `visited` flag is used to track whether the page has been visited during traversal.
+ * Results of @isConnected go to `resultOut`, by default the buffered writer for stdout.
  */
-struct page {
+#define RESULT_BUFFER_SIZE (1 << 20)
 
+struct outBuf stdoutResults;
+struct outBuf *resultOut = &stdoutResults;
 
-	char *name;
-	struct page *next;
-	struct link *edges;
-	int visited;
-};
+
+
+/*
+ * With --map, queries are answered straight from `frozenView` until the first command
+ * that changes the graph turns the mapped snapshot into ordinary pages and links.
+ * With --compress or --k2tree, `freezeGraph` packs the list graph into `frozenView` when
+ * it is queried, and the next change unpacks it again.
+ */
+struct graphView frozenView;
+int (*freezeGraph)(struct graphView *view) = NULL;
 
 
 
 /*
- * link -- Represents a directed edge in a graph, connecting one page to another.  
- * The `to` pointer references the destination page of the link.  
- * The `next` pointer links to the next link in the adjacency list,  
- * allowing multiple outgoing links from a single page to be stored efficiently.
+ * Name index -- the dictionary from page name to live page (see dict.h), so lookups,
+ * duplicate checks and removals no longer walk the whole `graphHead` list, and
+ * threads can look names up at once. Tombstoned pages are taken out of the index
+ * immediately, which lets a page with the same name be added again before the next
+ * compaction. Pages are only added and removed while no other thread uses the index,
+ * so those are also the points where tables replaced by a resize can be freed.
  */
-struct link {
+struct nameDict nameIndex = { NULL, 0, NULL, PTHREAD_MUTEX_INITIALIZER };
 
 
-	struct page *to;
-	struct link *next;
-};
 
+/*
+ * Tombstone bookkeeping. `pageCount`/`linkCount` count every node still held in
+ * the lists, `deadPages`/`deadLinks` how many of those are tombstones. Once the
+ * tombstones make up more than 1/COMPACT_RATIO of the storage (and there are at
+ * least COMPACT_MIN_TOMBSTONES of them), compactGraph() sweeps them out in bulk.
+ */
+#define COMPACT_RATIO 4
+#define COMPACT_MIN_TOMBSTONES 1024
+
+long pageCount = 0;
+long linkCount = 0;
+long deadPages = 0;
+long deadLinks = 0;
 
 
-struct page *graphHead = NULL;
+
+/*
+ * Bumped whenever a page may leave the name index or be freed (a removal, a compaction
+ * or the whole graph being dropped), so page pointers a pageRef kept from before are
+ * looked up again.
+ */
+unsigned long pageGeneration = 0;
 
 
 
 /*
-* addPageToGraph(node) -- adds a new page node to the linked list graph.
-* It checks if the graph is empty and initializes the head if necessary.
-* If a page with the same name already exists, it prints an error and returns 1.
-* Otherwise, it appends the new page to the end of the list and returns 0.
+ * pool -- A slab allocator for fixed-size graph nodes. Nodes are carved out of
+ * large slabs instead of one malloc each, released nodes are kept on a free list
+ * for reuse, and the whole pool is freed slab by slab at exit. poolAllocArray()
+ * hands out a contiguous run of nodes, which the bulk loader uses to build every
+ * page or link of a batch in a single allocation.
+ */
+#define POOL_SLAB_ITEMS 4096
+#define POOL_HEADER 16
+
+struct pool pagePool = { sizeof(struct page), NULL, NULL, 0, NULL };
+struct pool linkPool = { sizeof(struct link), NULL, NULL, 0, NULL };
+
+
+
+/*
+* poolAllocArray(pool, count) -- allocates a new slab holding 'count' zeroed nodes
+* and returns a pointer to the first one, or NULL if out of memory.
 */
-int addPageToGraph(struct page *node) {
+void * poolAllocArray(struct pool *pool, size_t count) {
 
-	if (graphHead == NULL) {
-		graphHead = node;
-		return 0;
-	}
+	char *slab = calloc(1, POOL_HEADER + count * pool->itemSize);
 
-	struct page *cur = graphHead;
-	struct page *behind = malloc(sizeof(struct page));
-	
-	if (behind == NULL) {
+	if (slab == NULL) {
 		fprintf(stderr, "Ran Out Of Memory.\n");
-		return 1;
+		return NULL;
+	}
+
+	*(void **) slab = pool->slabs;
+	pool->slabs = slab;
+	return slab + POOL_HEADER;
+}
+
+
+
+/*
+* poolAlloc(pool) -- returns one zeroed node, taken from the free list when possible
+* and otherwise from the current slab. Returns NULL if out of memory.
+*/
+void * poolAlloc(struct pool *pool) {
+
+	if (pool->freeList != NULL) {
+		void *item = pool->freeList;
+		pool->freeList = *(void **) item;
+		memset(item, 0, pool->itemSize);
+		return item;
 	}
-	
-	while (cur != NULL) {
 
-		if (strcmp(node->name, cur->name) == 0) {
-			fprintf(stderr, "There is already a Page with that name.\n");
-			return 1;
+	if (pool->bumpLeft == 0) {
+		pool->bump = poolAllocArray(pool, POOL_SLAB_ITEMS);
+		if (pool->bump == NULL) {
+			return NULL;
 		}
+		pool->bumpLeft = POOL_SLAB_ITEMS;
+	}
+
+	void *item = pool->bump;
+	pool->bump += pool->itemSize;
+	pool->bumpLeft--;
+	return item;
+}
+
+
+
+/*
+* poolRelease(pool, item) -- puts 'item' on the pool's free list for reuse.
+*/
+void poolRelease(struct pool *pool, void *item) {
+
+	*(void **) item = pool->freeList;
+	pool->freeList = item;
+}
+
+
+
+/*
+* poolDestroy(pool) -- frees every slab of the pool and resets it to empty.
+*/
+void poolDestroy(struct pool *pool) {
 
-		behind = cur;
-		cur = cur->next;
+	while (pool->slabs != NULL) {
+		void *next = *(void **) pool->slabs;
+		free(pool->slabs);
+		pool->slabs = next;
 	}
+	pool->freeList = NULL;
+	pool->bump = NULL;
+	pool->bumpLeft = 0;
+}
 
-	behind->next = node;
-	return 0;
+
+
+/*
+* pageToken(node) -- returns a view of the name of the page 'node'.
+*/
+struct token pageToken(struct page *node) {
+
+	struct token name = { node->name, strlen(node->name) };
+	return name;
 }
 
 
 
+/*
+* reserveIndex(count) -- makes room in the name index for 'count' more pages at once.
+* Returns 0 on success, 1 if out of memory.
+*/
+int reserveIndex(size_t count) {
+
+	dictCollect(&nameIndex);
+	return dictReserve(&nameIndex, count);
+}
+
+
 
 /*
-* addLinkToPage(srcPage, link) -- creates a link between two pages in the graph.  
-* It searches for the source page and the destination page in the linked list.  
-* If either page is not found, it prints an error and returns 1.  
-* Otherwise, it allocates memory for a new link structure and appends it  
-* to the list of links for the source page. Returns 0 on success.  
+* indexInsert(node) -- adds 'node' to the name index. The caller has made sure no live page has
+* its name. Returns 0 on success, 1 if out of memory.
 */
-int addLinkToPage(char *srcPage, char *link) {
+int indexInsert(struct page *node) {
 
+	dictCollect(&nameIndex);
+	return dictInsert(&nameIndex, node) != node;
+}
 
-	struct page *src = malloc(sizeof(struct page));
 
-	if (src == NULL) {
-                fprintf(stderr, "Ran Out Of Memory.\n");
-                return 1;
-        }
 
-	struct page *linkNode = malloc(sizeof(struct page));
+/*
+* indexRemove(node) -- takes 'node' out of the name index.
+*/
+void indexRemove(struct page *node) {
+
+	dictRemove(&nameIndex, node);
+}
 
-        if (linkNode == NULL) {
-                fprintf(stderr, "Ran Out Of Memory.\n");
-                return 1;
-        }
 
-	struct page *cur = graphHead;
 
-	int srcSeen = 0;
-	int linkSeen = 0;
+/*
+* findNode(name) -- searches for a live page in the graph by its name.
+* It hashes the name and probes the name index, without locking, so any
+* number of threads may search at once.
+* If a match is found, it returns a pointer to the corresponding page.
+* If no match is found, it returns NULL.
+*/
+struct page * findNode(struct token name) {
 
-	while (cur != NULL) {
+	return findHashed(name, hashName(name));
+}
 
-		int srcComp = strcmp(srcPage, cur->name);
-		int linkComp = strcmp(link, cur->name);
 
-		if (srcComp == 0) {
-			src = cur;
-			srcSeen = 1;
-		} 
 
-		if (linkComp == 0) {
-			linkNode = cur;
-			linkSeen = 1;
-		}
+/*
+* findHashed(name, hash) -- findNode() for a name whose hashName() is already known to be 'hash'.
+*/
+struct page * findHashed(struct token name, unsigned long long hash) {
+
+	uint64_t start = statsBegin();
+	struct page *node = dictFind(&nameIndex, name, hash);
+
+	statsEnd(STAT_FIND_NODE, start);
+	return node;
+}
+
+
+
+/*
+* refNode(name, ref) -- returns the live page called 'name' like findNode(), using what 'ref'
+* knows of it: the page it found before, while no page has been removed since, and otherwise its
+* hash, so the name is never hashed again. 'ref' may be NULL.
+*/
+struct page * refNode(struct token name, struct pageRef *ref) {
+
+	if (ref == NULL) {
+		return findNode(name);
+	}
+
+	if (ref->page == NULL || ref->generation != pageGeneration) {
+		ref->page = findHashed(name, ref->hash);
+		ref->generation = pageGeneration;
+	}
+	return ref->page;
+}
+
+
+
+/*
+* refHash(name, ref) -- returns the hashName() of 'name', taken from 'ref' when there is one.
+*/
+unsigned long long refHash(struct token name, struct pageRef *ref) {
+
+	return ref != NULL ? ref->hash : hashName(name);
+}
+
+
+
+/*
+* internName(name) -- copies the bytes of 'name' into a new null-terminated string.
+* This is the only place a page name is copied out of the input. Returns NULL if out of memory.
+*/
+char * internName(struct token name) {
+
+	char *copy = malloc(name.len + 1);
+
+	if (copy == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return NULL;
+	}
+
+	memcpy(copy, name.ptr, name.len);
+	copy[name.len] = 0;
+	return copy;
+}
+
+
+
+/*
+* appendPage(node) -- appends the new page 'node' to the end of the `graphHead` list through `graphTail`.
+*/
+void appendPage(struct page *node) {
+
+	if (graphHead == NULL) {
+		graphHead = node;
+	} else {
+		graphTail->next = node;
+	}
+	graphTail = node;
+	pageCount++;
+}
+
+
+
+/*
+* newPage(name) -- creates a page called 'name', enters it in the name index and appends it to
+* the graph. The caller has made sure no live page has that name. Returns NULL if out of memory.
+*/
+struct page * newPage(struct token name) {
+
+	struct page *node = poolAlloc(&pagePool);
+
+	if (node == NULL) {
+		return NULL;
+	}
+
+	node->name = internName(name);
+
+	if (node->name == NULL || indexInsert(node) != 0) {
+		free(node->name);
+		poolRelease(&pagePool, node);
+		return NULL;
+	}
+
+	appendPage(node);
+	return node;
+}
+
+
+
+/*
+* findOrAddPage(name) -- returns the live page called 'name', creating it first if there is none.
+* Returns NULL if out of memory.
+*/
+struct page * findOrAddPage(struct token name) {
+
+	struct page *node = findNode(name);
+
+	return node != NULL ? node : newPage(name);
+}
+
+
+
+/*
+* addPageToGraph(name) -- adds a new page called 'name' to the linked list graph.
+* If a live page with the same name already exists, it prints an error and returns 1.
+* Otherwise, it interns the name, records the page in the name index, appends it to
+* the end of the list through `graphTail` and returns 0.
+*/
+int addPageToGraph(struct token name) {
 
-		cur = cur->next;
+	return addPageRef(name, NULL);
+}
+
+
+
+/*
+* addPageRef(name, ref) -- addPageToGraph() for a name 'ref' knows about (or NULL), which
+* remembers the new page.
+*/
+int addPageRef(struct token name, struct pageRef *ref) {
+
+	if (refNode(name, ref) != NULL) {
+		fprintf(stderr, "There is already a Page with that name.\n");
+		return 1;
 	}
 
-	if (srcSeen == 0 || linkSeen == 0) {
+	struct page *node = newPage(name);
+
+	if (ref != NULL) {
+		ref->page = node;
+		ref->generation = pageGeneration;
+	}
+	return node == NULL;
+}
+
+
+
+
+/*
+* addLinkToPage(srcPage, link) -- creates a link between two pages in the graph.
+* It looks up the source page and the destination page in the name index
+* and links them with linkPages(). Returns 0 on success, 1 on error.
+*/
+int addLinkToPage(struct token srcPage, struct token link) {
+
+	struct page *src = findNode(srcPage);
+
+	return linkPages(src, findNode(link));
+}
+
+
+
+/*
+* linkPages(src, linkNode) -- appends a link to 'linkNode' to the list of links of 'src'.
+* If either page is NULL (was not found), it prints an error and returns 1.
+* Otherwise, it allocates memory for a new link structure and appends it
+* to the list of links for the source page. Returns 0 on success.
+*/
+int linkPages(struct page *src, struct page *linkNode) {
+
+	if (src == NULL || linkNode == NULL) {
 		fprintf(stderr, "Could not Find the link.\n");
 		return 1;
 	}
 
 
-	struct link *linkNodeAct = malloc(sizeof(struct link));
+	struct link *linkNodeAct = poolAlloc(&linkPool);
 
-	if (link == NULL) {
-		fprintf(stderr, "Ran Out Of Memory.\n");
+	if (linkNodeAct == NULL) {
                 return 1;
 	}
 
 	linkNodeAct->to = linkNode;
 	linkNodeAct->next = NULL;
 
-	struct link *linkCur = src->edges;
-	
-	struct link *behind = malloc(sizeof(struct link));
-
-        if (behind == NULL) {
-                fprintf(stderr, "Ran Out Of Memory.\n");
-                return 1;
-        }
+	src->outCount++;
+	linkNode->inCount++;
+	linkCount++;
 
-	if (linkCur == NULL) {
+	if (src->edges == NULL) {
 		src->edges = linkNodeAct;
 		return 0;
 	}
 
-	while (linkCur != NULL) {
-		behind = linkCur;
-		linkCur = linkCur->next;
+	struct link *behind = src->edges;
+
+	while (behind->next != NULL) {
+		behind = behind->next;
 	}
 
 	behind->next = linkNodeAct;
@@ -182,350 +464,1076 @@ int addLinkToPage(char *srcPage, char *link) {
 
 
 /*
-* findNode(name) -- searches for a page in the graph by its name.  
-* It traverses the linked list of pages, comparing each page's name to the given name.  
-* If a match is found, it returns a pointer to the corresponding page.  
-* If no match is found, it returns NULL.  
+* compactGraph() -- removes every tombstone from the graph in one sweep.
+* Links that were removed or point at a removed page are freed from each live
+* page's adjacency list, then the removed pages themselves are unlinked from
+* `graphHead` and freed. The live link counters are recomputed exactly, since
+* the per-removal estimates can count a link into and out of a removed page twice.
 */
-struct page * findNode(char *name) {
+void compactGraph() {
+
+	struct page *cur;
 
-	struct page *node = NULL;
+	for (cur = graphHead; cur != NULL; cur = cur->next) {
+		cur->inCount = 0;
+	}
 
-	struct page *cur = graphHead;
+	linkCount = 0;
 
-	while (cur != NULL) {
+	for (cur = graphHead; cur != NULL; cur = cur->next) {
 
-		int isWord = strcmp(cur->name, name);
-		
-		if (isWord == 0) {
-			node = cur;
-			break;
+		struct link **linkCur = &cur->edges;
+		cur->outCount = 0;
+
+		while (*linkCur != NULL) {
+			struct link *edge = *linkCur;
+			if (cur->removed || edge->to == NULL || edge->to->removed) {
+				*linkCur = edge->next;
+				poolRelease(&linkPool, edge);
+			} else {
+				cur->outCount++;
+				edge->to->inCount++;
+				linkCount++;
+				linkCur = &edge->next;
+			}
 		}
-	cur = cur->next;
 	}
-	return node;
+
+	struct page **pageCur = &graphHead;
+	graphTail = NULL;
+
+	while (*pageCur != NULL) {
+		struct page *node = *pageCur;
+		if (node->removed) {
+			*pageCur = node->next;
+			free(node->name);
+			poolRelease(&pagePool, node);
+		} else {
+			graphTail = node;
+			pageCur = &node->next;
+		}
+	}
+
+	pageCount -= deadPages;
+	deadPages = 0;
+	deadLinks = 0;
+	pageGeneration++;
+}
+
+
+
+/*
+* maybeCompactGraph() -- runs compactGraph() once the tombstone ratio crosses the threshold.
+*/
+void maybeCompactGraph() {
+
+	long dead = deadPages + deadLinks;
+
+	if (dead >= COMPACT_MIN_TOMBSTONES && dead * COMPACT_RATIO >= pageCount + linkCount) {
+		compactGraph();
+	}
+}
+
+
+
+/*
+* removePageFromGraph(pageName) -- tombstones the live page named 'pageName'.
+* The page is dropped from the name index and flagged as removed, so traversals
+* skip it and every link into or out of it; the nodes themselves are freed by the
+* next compaction. Prints an error and returns 1 if no such page exists, otherwise returns 0.
+*/
+int removePageFromGraph(struct token pageName) {
+
+	struct page *node = findNode(pageName);
+
+	if (node == NULL) {
+		fprintf(stderr, "Could not Find the Page.\n");
+		return 1;
+	}
+
+	indexRemove(node);
+	node->removed = 1;
+	pageGeneration++;
+	deadPages++;
+	deadLinks += node->outCount + node->inCount;
+	return 0;
 }
 
 
 
 /*
-* dfs(fromPage, toPage) -- performs a depth-first search (DFS) to check if there is a path from fromPage to toPage.
-* It starts at fromPage, marking it as visited, and recursively explores its outgoing links to other pages.
-* If it encounters toPage during the traversal, it returns 1, indicating that a path exists.
-* If all possible links are explored and toPage is not found, it returns 0.
-* The function assumes that visited is a field in the struct page to track the nodes that have been visited.
+* removeLinkFromPage(srcPage, link) -- tombstones every live link from 'srcPage' to 'link'.
+* Both pages are found through the name index and only the source's adjacency list is scanned.
+* Prints an error and returns 1 if either page or the link does not exist, otherwise returns 0.
 */
-int dfs(struct page *fromPage, struct page *toPage) {
+int removeLinkFromPage(struct token srcPage, struct token link) {
+
+	struct page *src = findNode(srcPage);
+	struct page *linkNode = findNode(link);
+	int found = 0;
+
+	if (src != NULL && linkNode != NULL) {
+		for (struct link *cur = src->edges; cur != NULL; cur = cur->next) {
+			if (cur->to == linkNode) {
+				cur->to = NULL;
+				found = 1;
+				src->outCount--;
+				linkNode->inCount--;
+				deadLinks++;
+			}
+		}
+	}
 
-	if (strcmp(fromPage->name, toPage->name) == 0) {
+	if (found == 0) {
+		fprintf(stderr, "Could not Find the link.\n");
 		return 1;
 	}
+	return 0;
+}
+
+
+
+/*
+* findPage(pageName) -- returns 0 if a live page with the name 'pageName' is found in the graph,
+* otherwise returns 1. It looks the name up in the name index.
+*/
+int findPage(struct token pageName) {
+
+	return findNode(pageName) == NULL;
+}
+
+
+/*
+ * Bulk load -- with --bulk, @addPages and @addLinks are not applied one at a time.
+ * Their names are appended to the flat `bulkBytes` buffer and recorded as
+ * bulkPage/bulkEdge entries tagged with a sequence number giving their position
+ * in the input. The buffered batch is applied by bulkFlush() right before the next
+ * command that reads or removes from the graph, and at EOF. Sequence numbers keep
+ * the error behaviour of the one-at-a-time path: a page added twice is reported at
+ * the later add, and a link is only valid if both pages were added before it.
+ */
+struct bulkPage {
+
+
+	size_t off;
+	size_t len;
+	unsigned long long hash;
+	long seq;
+};
+
+struct bulkEdge {
+
+
+	size_t srcOff;
+	size_t toOff;
+	size_t srcLen;
+	size_t toLen;
+	unsigned long long srcHash;
+	unsigned long long toHash;
+	long seq;
+};
+
+struct bulkError {
+
+
+	long seq;
+	const char *message;
+};
+
+char *bulkBytes = NULL;
+size_t bulkBytesLen = 0;
+size_t bulkBytesCap = 0;
+
+struct bulkPage *bulkPages = NULL;
+size_t bulkPageCount = 0;
+size_t bulkPageCap = 0;
 
-	if (fromPage->visited == 1) {
+struct bulkEdge *bulkEdges = NULL;
+size_t bulkEdgeCount = 0;
+size_t bulkEdgeCap = 0;
+
+long bulkSeq = 0;
+
+
+
+/*
+* growArray(array, cap, itemSize, need) -- makes sure the heap array '*array' with capacity
+* '*cap' items can hold 'need' items, doubling it as required. Returns 0 on success, 1 if out of memory.
+*/
+int growArray(void **array, size_t *cap, size_t itemSize, size_t need) {
+
+	if (need <= *cap) {
 		return 0;
 	}
 
-	fromPage->visited = 1;
+	size_t newCap = *cap == 0 ? 1024 : *cap;
+	while (newCap < need) {
+		newCap *= 2;
+	}
 
-	struct link *curLink = fromPage->edges;
-    	while (curLink != NULL) {
-        	if (dfs(curLink->to, toPage)) {
-            		return 1;
-        	}
-        	curLink = curLink->next;
-    	}
+	void *grown = realloc(*array, newCap * itemSize);
+	if (grown == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	*array = grown;
+	*cap = newCap;
 	return 0;
 }
 
 
 
 /*
-* resetVisits() -- resets the 'visited' field of all pages in the graph to 0.
-* It traverses the entire list of pages starting from graphHead and sets the 'visited' field of each page to 0.
-* This function is typically used to prepare for a new search or traversal, ensuring that all pages are marked as unvisited before starting a new operation.
+* bulkSaveName(name) -- copies 'name' and a null terminator onto the end of `bulkBytes`
+* and returns its offset, or (size_t) -1 if out of memory.
 */
-void resetVisits() {
-        struct page *cur = graphHead;
-        while (cur != NULL) {
-		cur->visited = 0;
-                cur = cur->next;
-        }
+size_t bulkSaveName(struct token name) {
+
+	if (growArray((void **) &bulkBytes, &bulkBytesCap, 1, bulkBytesLen + name.len + 1) != 0) {
+		return (size_t) -1;
+	}
+
+	size_t off = bulkBytesLen;
+	memcpy(bulkBytes + off, name.ptr, name.len);
+	bulkBytes[off + name.len] = 0;
+	bulkBytesLen += name.len + 1;
+	return off;
+}
+
+
+
+/*
+* bulkName(off, len) -- returns a view of the buffered name stored at offset 'off'.
+*/
+struct token bulkName(size_t off, size_t len) {
+
+	struct token name = { bulkBytes + off, len };
+	return name;
+}
+
+
+
+/*
+* bulkAddPage(name, hash) -- buffers an @addPages entry for the name 'name', whose hashName() is
+* 'hash', for the next bulkFlush(). Returns 0 on success, 1 if out of memory.
+*/
+int bulkAddPage(struct token name, unsigned long long hash) {
+
+	if (growArray((void **) &bulkPages, &bulkPageCap, sizeof(struct bulkPage), bulkPageCount + 1) != 0) {
+		return 1;
+	}
+
+	size_t off = bulkSaveName(name);
+	if (off == (size_t) -1) {
+		return 1;
+	}
+
+	struct bulkPage *entry = &bulkPages[bulkPageCount++];
+	entry->off = off;
+	entry->len = name.len;
+	entry->hash = hash;
+	entry->seq = ++bulkSeq;
+	return 0;
+}
+
+
+
+/*
+* bulkAddLink(srcPage, link, srcHash, toHash) -- buffers one @addLinks edge for the next bulkFlush(),
+* with the hashName() of either name when it is already known, or 0 to have the flush work it out.
+* Returns 0 on success, 1 if out of memory.
+*/
+int bulkAddLink(struct token srcPage, struct token link, unsigned long long srcHash, unsigned long long toHash) {
+
+	if (growArray((void **) &bulkEdges, &bulkEdgeCap, sizeof(struct bulkEdge), bulkEdgeCount + 1) != 0) {
+		return 1;
+	}
+
+	size_t srcOff = bulkSaveName(srcPage);
+	size_t toOff = bulkSaveName(link);
+	if (srcOff == (size_t) -1 || toOff == (size_t) -1) {
+		return 1;
+	}
+
+	struct bulkEdge *entry = &bulkEdges[bulkEdgeCount++];
+	entry->srcOff = srcOff;
+	entry->toOff = toOff;
+	entry->srcLen = srcPage.len;
+	entry->toLen = link.len;
+	entry->srcHash = srcHash;
+	entry->toHash = toHash;
+	entry->seq = ++bulkSeq;
+	return 0;
+}
+
+
+
+/*
+* compareBulkPages(a, b) -- qsort order for indexes into `bulkPages`: by name
+* (hash first, then bytes), and by sequence number among equal names.
+*/
+int compareBulkPages(const void *a, const void *b) {
+
+	const struct bulkPage *one = &bulkPages[*(const size_t *) a];
+	const struct bulkPage *two = &bulkPages[*(const size_t *) b];
+
+	if (one->hash != two->hash) {
+		return one->hash < two->hash ? -1 : 1;
+	}
+
+	int cmp = strcmp(bulkBytes + one->off, bulkBytes + two->off);
+	if (cmp != 0) {
+		return cmp;
+	}
+	return one->seq < two->seq ? -1 : one->seq > two->seq;
+}
+
+
+
+/*
+* spliceResolved(arg, i, src, to) -- resolver for spliceLinks(): edge i of the array 'arg' is
+* already resolved.
+*/
+static int spliceResolved(void *arg, size_t i, struct page **src, struct page **to) {
+
+	const struct link *edges = arg;
+
+	*src = (struct page *) edges[i].next;
+	*to = edges[i].to;
+	return 0;
+}
+
+
+
+/*
+* spliceLinks(edges, count) -- adds 'count' resolved edges to the graph in bulk. Each entry of
+* 'edges' holds its destination in `to` and, temporarily, its source page in `next`. The edges are
+* sorted stably by source page, keeping duplicates, every new link is built from one allocation, and each source's run is
+* spliced onto the end of its list with a single walk, a shard of source pages per thread when
+* there are many (see ingest.c). Returns 0 on success, 1 if out of memory.
+*/
+int spliceLinks(struct link *edges, size_t count) {
+
+	return ingestLinks(count, spliceResolved, edges, NULL, NULL);
 }
 
 
 
 /*
-* printConnection(pageOne, pageTwo) -- prints 1 if there is a path of links connecting pageOne to pageTwo, 
-* otherwise prints 0. It uses depth-first search (DFS) to determine if a path exists between the two pages. 
-* It first finds the pages corresponding to pageOne and pageTwo using the findNode function. 
-* Then, it calls the dfs function to check if pageOne is connected to pageTwo. 
-* After performing the search, it resets the 'visited' status of all pages to ensure the graph is ready for subsequent operations. 
-* Assumes that the pages pageOne and pageTwo exist in the graph.
+* compareBulkErrors(a, b) -- qsort order for deferred errors: by sequence number.
+*/
+int compareBulkErrors(const void *a, const void *b) {
+
+	long one = ((const struct bulkError *) a)->seq;
+	long two = ((const struct bulkError *) b)->seq;
+
+	return one < two ? -1 : one > two;
+}
+
+
+
+/*
+ * bulkBorn -- The pages bulkFlush() created: `batch[k]` was added by the command with sequence
+ * number `bornSeq[k]`, for k below `created`. A page outside it was there before the flush.
+ */
+struct bulkBorn {
+
+
+	struct page *batch;
+	long *bornSeq;
+	size_t created;
+};
+
+
+
+/*
+* resolveBulkEdge(arg, i, src, to) -- ingestLinks() resolver for buffered edge i: looks up both of
+* its pages, which must have been added before the edge was. Returns 0 if they were, 1 otherwise.
 */
-void printConnection(char *pageOne, char *pageTwo) {
+static int resolveBulkEdge(void *arg, size_t i, struct page **src, struct page **to) {
 
+	const struct bulkBorn *born = arg;
+	const struct bulkEdge *edge = &bulkEdges[i];
+	struct token srcName = bulkName(edge->srcOff, edge->srcLen);
+	struct token toName = bulkName(edge->toOff, edge->toLen);
 
-	struct page *nodeOne = findNode(pageOne);
-	struct page *nodeTwo = findNode(pageTwo);
+	*src = findHashed(srcName, edge->srcHash != 0 ? edge->srcHash : hashName(srcName));
+	*to = findHashed(toName, edge->toHash != 0 ? edge->toHash : hashName(toName));
 
+	if (*src == NULL || *to == NULL) {
+		return 1;
+	}
 
-	printf("%d\n", dfs(nodeOne, nodeTwo));
-	resetVisits();
+	long srcBorn = *src >= born->batch && *src < born->batch + born->created ? born->bornSeq[*src - born->batch] : 0;
+	long toBorn = *to >= born->batch && *to < born->batch + born->created ? born->bornSeq[*to - born->batch] : 0;
+
+	return srcBorn > edge->seq || toBorn > edge->seq;
 }
 
+
+
 /*
-* findPage(pageName) -- returns 0 if the page with the name 'pageName' is found in the graph, 
-* otherwise returns 1. It iterates through the list of pages starting from the head of the graph 
-* and compares each page's name with the given 'pageName'. If a match is found, the function breaks out 
-* of the loop and returns 0. If no match is found after traversing all pages, it returns 1. 
-* Assumes that the graph is correctly initialized and contains pages.
+* bulkFlush() -- applies every buffered page and link to the graph in one pass.
+* Buffered pages are sorted by name so duplicates (within the batch or against the
+* graph) are found without per-page list walks; the surviving pages are created in
+* one contiguous pool allocation and entered into the name index in input order.
+* The edges are then resolved, checked against the sequence numbers of their pages and
+* spliced onto their source pages by ingestLinks(), on every core for a large batch. Errors are printed in input order
+* with the same messages as the one-at-a-time path. Returns the number of errors.
 */
-int findPage(char *pageName) {
+int bulkFlush() {
+
+	if (bulkPageCount == 0 && bulkEdgeCount == 0) {
+		return 0;
+	}
+
+	uint64_t start = statsBegin();
+	int errors = 0;
+	size_t errorCount = 0;
+	size_t *order = malloc((bulkPageCount + 1) * sizeof(size_t));
+	long *bornSeq = malloc((bulkPageCount + 1) * sizeof(long));
+	struct bulkError *errorList = malloc((bulkPageCount + bulkEdgeCount + 1) * sizeof(struct bulkError));
+
+	if (order == NULL || bornSeq == NULL || errorList == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		free(order);
+		free(bornSeq);
+		free(errorList);
+		return 1;
+	}
+
+	// Pick the first add of every name that is not already in the graph.
+	// bornSeq temporarily holds 1 for winners and 0 for duplicates.
+	for (size_t i = 0; i < bulkPageCount; i++) {
+		order[i] = i;
+	}
+	qsort(order, bulkPageCount, sizeof(size_t), compareBulkPages);
+
+	size_t winners = 0;
+	for (size_t i = 0; i < bulkPageCount; i++) {
+		struct bulkPage *entry = &bulkPages[order[i]];
+		struct bulkPage *prev = i > 0 ? &bulkPages[order[i - 1]] : NULL;
+		int first = prev == NULL || prev->hash != entry->hash ||
+			strcmp(bulkBytes + prev->off, bulkBytes + entry->off) != 0;
+
+		if (first && findHashed(bulkName(entry->off, entry->len), entry->hash) == NULL) {
+			bornSeq[order[i]] = 1;
+			winners++;
+		} else {
+			bornSeq[order[i]] = 0;
+			errorList[errorCount].seq = entry->seq;
+			errorList[errorCount++].message = "There is already a Page with that name.\n";
+		}
+	}
 
-	struct page *cur = graphHead;
-	int found = 1;
+	// Create the surviving pages contiguously, in input order. From here on
+	// bornSeq[k] is the sequence number of batch[k]; k never passes i.
+	struct page *batch = winners > 0 ? poolAllocArray(&pagePool, winners) : NULL;
+	size_t created = 0;
+
+	if (winners > 0 && (batch == NULL || reserveIndex(winners) != 0)) {
+		errors++;
+		winners = 0;
+	}
 
-        while (cur != NULL) {
-		if (strcmp(cur->name, pageName) == 0) {
-			found = 0;
+	for (size_t i = 0; i < bulkPageCount && created < winners; i++) {
+		if (bornSeq[i] == 0) {
+			continue;
+		}
+
+		struct page *node = &batch[created];
+		node->name = internName(bulkName(bulkPages[i].off, bulkPages[i].len));
+		if (node->name == NULL || indexInsert(node) != 0) {
+			errors++;
 			break;
 		}
-		cur = cur->next;
-	}	
-	return found;
+
+		appendPage(node);
+		bornSeq[created++] = bulkPages[i].seq;
+	}
+
+	// The name index is only read from here on, so edges are resolved on every core.
+	struct bulkBorn born = { batch, bornSeq, created };
+	size_t *failed = NULL;
+	size_t failedCount = 0;
+
+	errors += ingestLinks(bulkEdgeCount, resolveBulkEdge, &born, &failed, &failedCount);
+
+	for (size_t i = 0; i < failedCount; i++) {
+		errorList[errorCount].seq = bulkEdges[failed[i]].seq;
+		errorList[errorCount++].message = "Could not Find the link.\n";
+	}
+	free(failed);
+
+	qsort(errorList, errorCount, sizeof(struct bulkError), compareBulkErrors);
+	for (size_t i = 0; i < errorCount; i++) {
+		fprintf(stderr, "%s", errorList[i].message);
+	}
+	errors += errorCount;
+
+	free(order);
+	free(bornSeq);
+	free(errorList);
+
+	bulkBytesLen = 0;
+	bulkPageCount = 0;
+	bulkEdgeCount = 0;
+	statsEnd(STAT_BULK_FLUSH, start);
+	return errors;
 }
 
 
 
 /*
-* removeAllWhitespace(str) -- removes all whitespace characters (spaces, tabs, newlines) 
-* from the string 'str'. It iterates over the string, copying non-whitespace characters 
-* to the front of the string and updating the string to exclude whitespace. After processing, 
-* the string is null-terminated at the correct position. 
-* Assumes that 'str' is a valid, null-terminated string.
+* bulkFree() -- releases the bulk load buffers.
 */
-void removeAllWhitespace(char *str) {
-    int i = 0, j = 0;
-    while (str[i] != 0) {
-        if (!isspace((unsigned char) str[i])) { // Skip all whitespace (tabs, spaces, newlines)
-            str[j++] = str[i];
-        }
-        i++;
-    }
-    str[j] = '\0'; // Null-terminate cleaned string
+void bulkFree() {
+
+	free(bulkBytes);
+	free(bulkPages);
+	free(bulkEdges);
 }
 
 
 
 /*
  * freeMemory() -- Frees all dynamically allocated memory for the graph structure. 
- * It iterates over all the pages in the graph, freeing the memory allocated for 
- * each page’s name and its associated edges (links). For each page, it also 
- * frees the memory allocated for the links and then the page itself. 
- * Assumes that 'graphHead' is a valid pointer to the first page in the graph.
+ * It iterates over all the pages in the graph, tombstoned ones included, freeing 
+ * the memory allocated for each page’s name. The pages and links themselves live 
+ * in the page and link pools, which are released slab by slab, and finally the 
+ * name index is freed. Everything is reset to an empty graph, so it can be built up
+ * again afterwards.
  */
 void freeMemory() {
 
 	struct page *curPage = graphHead;
 
 	while (curPage != NULL) {
-
-		struct link *curLink = curPage->edges;
-
-		while (curLink != NULL) {
-		
-			struct link *tempNode = curLink;
-
-			curLink = curLink->next;
-			free(tempNode);
-		}
 		free(curPage->name);
-		struct page *tempPage = curPage;
 		curPage = curPage->next;
-		free(tempPage);
 	}
+	poolDestroy(&linkPool);
+	poolDestroy(&pagePool);
+	dictFree(&nameIndex);
+
+	graphHead = NULL;
+	graphTail = NULL;
+	pageCount = 0;
+	linkCount = 0;
+	deadPages = 0;
+	deadLinks = 0;
+	pageGeneration++;
 }
 
 
 /*
-* main(argc, argv) -- the entry point of the program. It processes command-line arguments to either 
-* read from a file (if a file path is provided) or from stdin (if no file is specified). It expects one 
-* of three actions: adding pages to a graph (@addPages), adding links between pages (@addLinks), or checking 
-* if two pages are connected (@isConnected). The function parses each line of input, processes actions and 
-* their arguments, and executes the appropriate graph manipulation. It returns 0 if no errors are encountered, 
-* and 1 if there are errors (such as memory allocation failure, invalid input, or pages not found).
-* Assumptions: The function assumes that input is well-formed according to the expected format and that 
-* graph manipulation functions (like addPageToGraph and addLinkToPage) handle memory and edge cases correctly.
+* runCommand(words, count, bulkMode) -- executes one tokenized input line. The first word
+* picks one of seven actions: adding pages to a graph (@addPages), adding links between pages
+* (@addLinks), checking if two pages are connected (@isConnected), removing pages
+* (@removePages) or links (@removeLinks), saving a snapshot of the graph (@save) or
+* importing an edge list (@loadEdges); the remaining words are its arguments. With
+* 'bulkMode' set, adds are buffered for bulkFlush() and flushed before any other action.
+* Returns the number of errors seen, which are reported but don't stop processing.
 */
-int main(int argc, char* argv[]) {
+int runCommand(struct token *words, size_t count, int bulkMode) {
+
+        return runCommandRefs(words, NULL, count, bulkMode);
+}
 
 
+
+/*
+* runCommandRefs(words, refs, count, bulkMode) -- runCommand() for a line whose names have been
+* hashed ahead of time: 'refs[i]' is what is known of 'words[i]' (see refNode()), and it keeps
+* the pages the command finds or adds for the next command naming them. 'refs' may be NULL.
+*/
+int runCommandRefs(struct token *words, struct pageRef **refs, size_t count, int bulkMode) {
+
+        uint64_t start = statsBegin();
+        int tag = commandTag(words[0]);
+        struct token *args = words + 1;
+        // WITHOUT REFS EVERY NAME GETS THE SAME EMPTY ONE
+        struct pageRef *noRef = NULL;
+        struct pageRef **argRefs = refs != NULL ? refs + 1 : &noRef;
+        size_t refStep = refs != NULL;
+        size_t argCount = count - 1;
         int errSeen = 0;
-        FILE *input;
+        struct page *nodeOne;
+        struct page *nodeTwo;
+
+        // BUFFERED BULK ERRORS CAME IN FIRST, SO THEY ARE PRINTED BEFORE THIS ONE
+        if (tag == CMD_INVALID) {
+                errSeen += bulkMode ? bulkFlush() : 0;
+                fprintf(stderr, "Invalid Input.");
+                return errSeen + 1;
+        }
 
-        if (argc > 1) {
+        // QUERIES WAITING TO RUN TOGETHER SEE THE GRAPH AS IT WAS BEFORE ANY OTHER COMMAND
+        if (tag != CMD_IS_CONNECTED) {
+                errSeen += queryFlush();
+        }
+
+        // A FROZEN VIEW ONLY ANSWERS QUERIES, ANYTHING ELSE NEEDS IT AS ORDINARY PAGES AND LINKS
+        if (tag != CMD_IS_CONNECTED && viewThaw(&frozenView) != 0) {
+                return errSeen + 1;
+        }
 
-                input = fopen(argv[1], "r");
+        // EVERY CHANGE IS JOURNALED BEFORE IT IS MADE; AN EDGE LIST JOURNALS THE PAGES AND LINKS IT ADDS
+        if (tag != CMD_IS_CONNECTED && tag != CMD_SAVE && tag != CMD_LOAD_EDGES && journalAppend(words, count) != 0) {
+                errSeen++;
+        }
 
-                if (input == NULL) {
-                        fprintf(stderr, "Couldn't open the file given.\n");
-                        return 1;
+        // ANY COMMAND THAT READS OR REMOVES FROM THE GRAPH SEES THE BUFFERED BULK LOAD FIRST
+        if (bulkMode && tag != CMD_ADD_PAGES && tag != CMD_ADD_LINKS) {
+                errSeen += bulkFlush();
+        }
+
+        switch (tag) {
+        case CMD_ADD_PAGES:
+
+                for (size_t i = 0; i < argCount; i++) {
+                        if (bulkMode) {
+                                errSeen += bulkAddPage(args[i], refHash(args[i], argRefs[i * refStep]));
+                        } else {
+                                uint64_t added = statsBegin();
+                                errSeen += addPageRef(args[i], argRefs[i * refStep]);
+                                statsEnd(STAT_ADD_PAGE, added);
+                        }
                 }
+                break;
 
-                if (argc > 2) {
-                        fprintf(stderr, "Too many argumnets were given.\n");
-                        errSeen = 1;
+        case CMD_ADD_LINKS:
+
+                if (argCount == 0) {
+                        errSeen += bulkMode ? bulkFlush() : 0;
+                        fprintf(stderr, "No Arguments were given in @addLinks");
+                        errSeen++;
                 }
-        } else {
-                input = stdin;
-        }
 
-        char *line = NULL;
-        size_t len = 0;
+                for (size_t i = 1; i < argCount; i++) {
+                        if (bulkMode) {
+                                struct pageRef *srcRef = argRefs[0];
+                                struct pageRef *toRef = argRefs[i * refStep];
+                                errSeen += bulkAddLink(args[0], args[i], srcRef != NULL ? srcRef->hash : 0,
+                                                       toRef != NULL ? toRef->hash : 0);
+                        } else {
+                                uint64_t added = statsBegin();
+                                struct page *src = refNode(args[0], argRefs[0]);
+                                errSeen += linkPages(src, refNode(args[i], argRefs[i * refStep]));
+                                statsEnd(STAT_ADD_LINK, added);
+                        }
+                }
+                break;
+
+        case CMD_IS_CONNECTED:
+
+                // CHECK HOW MANY ARGS WERE GIVEN < 2 or > 2 -> stderr, dont check if connected
+                if (argCount != 2) {
+                        errSeen++;
+                        fprintf(stderr, "Either too many or too few arguments given.\n");
+                        errSeen += queryFailed();
+                        // CHECK IF PAGES ARE REAL
+                } else if (frozenView.ops != NULL || (freezeGraph != NULL && freezeGraph(&frozenView) == 0)) {
+                        errSeen += queryView(&frozenView, args[0], args[1]);
+                } else if ((nodeOne = refNode(args[0], argRefs[0])) == NULL ||
+                           (nodeTwo = refNode(args[1], argRefs[refStep])) == NULL) {
+                        errSeen++;
+                        fprintf(stderr, "Either Page does not Exist.\n");
+                        errSeen += queryFailed();
+                } else {
+                        errSeen += queryPages(nodeOne, nodeTwo);
+                }
+                break;
 
-        while (getline(&line, &len, input) > 0) {
+        case CMD_REMOVE_PAGES:
 
-                if (line == NULL) {
-                        fprintf(stderr, "Not enough Space in memory.\n");
-                        return 1;
+                for (size_t i = 0; i < argCount; i++) {
+                        errSeen += removePageFromGraph(args[i]);
                 }
+                maybeCompactGraph();
+                break;
 
-		char *action = NULL;
+        case CMD_REMOVE_LINKS:
 
-                char **pageLinks = malloc(strlen(line) * sizeof(char*));
-		if (pageLinks == NULL) {
-                        fprintf(stderr, "Ran Out Of Memory.\n");
-                        return 1;
+                if (argCount < 2) {
+                        fprintf(stderr, "Too few arguments were given in @removeLinks.\n");
+                        errSeen++;
+                        break;
                 }
-		// Make sure that everything is initialized before setting into String list 
-		for (int i = 0; i < strlen(line); i++) {
-    			pageLinks[i] = NULL;
-		}
 
-                char *word = strtok(line, " \t\n");
-                int index = 0;
-                int pntrIndex = 0;
+                for (size_t i = 1; i < argCount; i++) {
+                        errSeen += removeLinkFromPage(args[0], args[i]);
+                }
+                maybeCompactGraph();
+                break;
 
-                int addPages = 1;
-                int addLinks = 1;
-                int isConnected = 1;
+        case CMD_SAVE:
 
-                while (word != 0) {
+                if (argCount != 1) {
+                        errSeen++;
+                        fprintf(stderr, "Either too many or too few arguments given.\n");
+                        break;
+                }
 
-                        if (word[strlen(word) - 1] == '\n') {
-                                word[strlen(word) - 1] = 0;
-                        }
+                // THE JOURNAL SAYS WHERE THE GRAPH GOES FIRST, SO A CRASH BEFORE ITS CHECKPOINT CAN BE TOLD APART
+                char *path = internName(args[0]);
+                if (path == NULL || journalSaving(path) != 0) {
+                        errSeen++;
+                } else if (saveSnapshot(path) != 0) {
+                        errSeen += 1 + journalSaving(NULL);
+                } else {
+                        errSeen += journalCheckpoint(path);
+                }
+                free(path);
+                break;
 
-                        removeAllWhitespace(word);
+        case CMD_LOAD_EDGES:
 
-                        if (index == 0) {
+                if (argCount != 1) {
+                        errSeen++;
+                        fprintf(stderr, "Either too many or too few arguments given.\n");
+                        break;
+                }
 
-                                addPages = strcmp(word, "@addPages");
-                                addLinks = strcmp(word, "@addLinks");
-                                isConnected = strcmp(word, "@isConnected");
+                char *edgePath = internName(args[0]);
+                errSeen += edgePath == NULL ? 1 : importEdges(edgePath);
+                free(edgePath);
+                break;
+        }
 
-                                if (addPages == 0 || addLinks == 0 || isConnected == 0) {
-                                        if (action != NULL) {
-						free(action);
-						action = NULL;
-					}
-					action = strdup(word);
-                                        index = 1;
-                                } else {
-                                        fprintf(stderr, "Invalid Input.");
-                                        errSeen = 1;
-                                        break;
-                                }
+        // THE COMMAND STAGES ARE IN THE ORDER OF THEIR TAGS
+        statsEnd(STAT_ADD_PAGES + tag - CMD_ADD_PAGES, start);
+        return errSeen;
+}
 
-                        } else {
 
-                                pageLinks[pntrIndex] = strdup(word);
-                                pntrIndex++;
 
-                        }
+/*
+* runBinary(reader, bulkMode, errSeen) -- runs the binary command frames of binproto.h read from
+* 'reader', adding the errors they cause to '*errSeen'. A malformed frame is reported and skipped.
+* Returns 0 at the end of input, or -1 if it can't be read or ends part way through a frame.
+*/
+static int runBinary(struct lineReader *reader, int bulkMode, int *errSeen) {
+
+        struct binNames names = { 0 };
+        struct token *args = NULL;
+        size_t argCap = 0;
+        struct token *words = NULL;
+        size_t wordCap = 0;
+        const char *prefix;
+        const char *body;
+        int status;
+
+        while ((status = readerTake(reader, 4, &prefix)) > 0) {
+
+                const unsigned char *bytes = (const unsigned char *) prefix;
+                uint32_t len = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+                int opcode;
+                size_t count;
+
+                // A LENGTH THAT CAN'T BE RIGHT LEAVES NO WAY TO FIND THE NEXT FRAME
+                if (len == 0 || len > BIN_MAX_FRAME) {
+                        fprintf(stderr, "Invalid binary command.\n");
+                        status = -1;
+                        break;
+                }
 
+                if ((status = readerTake(reader, len, &body)) <= 0) {
+                        status = -1;
+                        break;
+                }
 
-                        // LAST THING BEFORE END OF WHILE LOOP, WILL GO TO NEXT WORD IN LINE
-                        word = strtok(NULL, " ");
+                if (binDecode(&names, (const uint8_t *) body, len, &opcode, &args, &count, &argCap) != 0 ||
+                    (opcode == BIN_QUERY_BATCH && count % 2 != 0) ||
+                    growArray((void **) &words, &wordCap, sizeof(struct token), count + 1) != 0) {
+                        fprintf(stderr, "Invalid binary command.\n");
+                        (*errSeen)++;
+                        continue;
+                }
 
+                // A BATCH IS RUN AS ONE @isConnected PER PAIR OF NAMES
+                words[0] = binActionWord(opcode);
+                if (opcode == BIN_QUERY_BATCH) {
+                        for (size_t i = 0; i < count; i += 2) {
+                                words[1] = args[i];
+                                words[2] = args[i + 1];
+                                *errSeen += runCommand(words, 3, bulkMode);
+                        }
+                } else {
+                        memcpy(words + 1, args, count * sizeof(struct token));
+                        *errSeen += runCommand(words, count + 1, bulkMode);
                 }
+                outputEndLine(resultOut);
+        }
 
-                if (action != NULL && action[0] != 0) {
+        free(args);
+        free(words);
+        binNamesFree(&names);
+        return status;
+}
 
-                        // CHECK IF ACTION IS NULL, IF SO -> DONT MAKE STRUCTS
-                        if (addPages == 0) {
-                                int i = 0;
-                                while (pageLinks[i] != 0) {
-                                        char *pageWord = pageLinks[i];
 
-                                        struct page *curNode = malloc(sizeof(struct page));
-                                        curNode->name = pageWord;
-                                        curNode->next = NULL;
-                                        curNode->edges = NULL;
-                                        curNode->visited = 0;
 
+/*
+* runInput(inputPath, bulkMode, binary) -- runs every command in the file at 'inputPath', or on stdin
+* if it is NULL. Each input line is split into word views in place and handed to runCommand; a
+* mapped file's lines are never copied. Input streamed through a pipe is read, parsed and executed
+* on separate threads by pipelineRun(), and a large input file is parsed on every core by
+* parallelRun(). With 'binary' set the input is read as binary frames instead. Returns the number
+* of errors, or -1 if the input can't be opened.
+*/
+static int runInput(const char *inputPath, int bulkMode, int binary) {
 
-                                        errSeen += addPageToGraph(curNode);
-                                        i++;
+        struct lineReader reader;
+        int errSeen = 0;
 
-                                }
+        if (readerOpen(&reader, inputPath) != 0) {
+                fprintf(stderr, "Couldn't open the file given.\n");
+                return -1;
+        }
 
-                        } else if(addLinks == 0) {
+        // RUNS OF QUERIES ARE SEARCHED ON EVERY CORE, UNLESS SOMEONE IS WAITING FOR EACH ANSWER
+        if (!resultOut->interactive) {
+                queryStart(sysconf(_SC_NPROCESSORS_ONLN));
+        }
 
-                                if (pageLinks[0] != 0 && pageLinks[1] != 0) {
-                                        char *srcPage = NULL;
-                                        if (pageLinks[0] != 0) {
-                                                srcPage = strdup(pageLinks[0]);
-                                        }
+        struct token *words = NULL;
+        size_t wordCap = 0;
+        const char *line;
+        size_t len;
+        int pipelined = !resultOut->interactive && !binary && (reader.map == NULL ||
+                        (reader.mapLen >= PARALLEL_MIN_BYTES && sysconf(_SC_NPROCESSORS_ONLN) > 1));
+        int status = 0;
+
+        // STREAMED INPUT IS READ, PARSED AND RUN ON THREE THREADS AT ONCE, AND A LARGE FILE IS PARSED ON ALL CORES
+        if (pipelined && reader.map == NULL) {
+                status = pipelineRun(reader.fd, bulkMode, &errSeen);
+        } else if (pipelined) {
+                status = parallelRun(reader.map, reader.mapLen, bulkMode, &errSeen);
+        } else if (binary) {
+                status = runBinary(&reader, bulkMode, &errSeen);
+        }
 
-                                        int i = 1;
+        while (!pipelined && !binary && (status = readerNext(&reader, &line, &len)) > 0) {
 
-                                        while (pageLinks[i] != 0) {
-                                                errSeen += addLinkToPage(srcPage, pageLinks[i]);
-                                                i++;
-                                        }
-                                } else {
-                                        if (pageLinks[0] == 0) {
-                                                fprintf(stderr, "No Arguments were given in @addLinks");
-                                                errSeen = 1;
-                                        }
-                                }
+                uint64_t start = statsBegin();
+                size_t count = tokenize(line, len, &words, &wordCap);
 
-                        } else if (isConnected == 0) {
+                statsEnd(STAT_PARSE, start);
 
-                                // CHECK HOW MANY ARGS WERE GIVEN < 2 or > 2 -> stderr, dont check if connected
-                                if (pageLinks[0] == 0 || pageLinks[1] == 0 || pageLinks[2] != 0) {
-                                        errSeen += 1;
-                                        fprintf(stderr, "Either too many or too few arguments given.\n");
-                                        // CHECK IF PAGES ARE REAL
-                                } else {
+                if (count > 0) {
+                        errSeen += runCommand(words, count, bulkMode);
+                        outputEndLine(resultOut);
+                }
+        }
+
+        if (status < 0) {
+                fprintf(stderr, "Couldn't read the input.\n");
+                errSeen++;
+        }
 
-                                        int pageOne = findPage(pageLinks[0]);
-                                        int pageTwo = findPage(pageLinks[1]);
+        free(words);
+        errSeen += queryStop();
+        errSeen += readerClose(&reader);
+        return errSeen;
+}
 
-                                        if (pageOne != 0 || pageTwo != 0) {
-                                                errSeen++;
-                                                fprintf(stderr, "Either Page does not Exist.\n");
-                                        } else {
 
-                                                // CALL printConnection(2 strings)
-                                                printConnection(pageLinks[0], pageLinks[1]);
-                                        }
-                                }
 
-                        }
+/*
+* parseCount(text, value) -- stores the whole number 'text' spells in '*value'. Returns 0 on
+* success, 1 if it isn't a whole number of at least 0.
+*/
+static int parseCount(const char *text, long *value) {
+
+        char *end;
+
+        *value = strtol(text, &end, 10);
+        return end == text || *end != 0 || *value < 0;
+}
+
+
+
+/*
+* main(argc, argv) -- the entry point of the program. It processes command-line arguments to either 
+* read from a file (if a file path is provided) or from stdin (if no file is specified), with --bulk 
+* turning on bulk loading, --interactive flushing results after every line (the default when 
+* stdin is a terminal) and --load path starting from the graph in a snapshot written by @save, 
+* or --map path answering queries straight from a mapped snapshot, and --import-edges path adding
+* the links of a TSV, CSV or SNAP edge list to it before the commands run. --share name builds the
+* graph into a shared memory segment once the input is done, and --attach name starts from such a
+* segment the way --map starts from a snapshot. --compress answers
+* queries from packed, gap encoded link lists instead of the list graph, and --k2tree from a
+* k²-tree. The commands themselves are run by runInput(). --journal path logs every change to a
+* write-ahead journal and, when no snapshot is given, recovers from the one it names; it is synced
+* every --journal-group-records records or --journal-group-ms milliseconds. --binary reads
+* the binary command frames of binproto.h instead of text and answers each query with a byte.
+* --serve path keeps the graph once the input is done and serves commands from clients of a Unix
+* domain socket at 'path' until it is stopped with SIGINT or SIGTERM. --no-uring keeps input and
+* output on plain read() and write() even where io_uring is available. --stats times every stage of
+* the work and reports latency percentiles to stderr at exit and on SIGUSR1 (see stats.h). It returns 0 if no 
+* errors are encountered, and 1 if there are errors (such as memory allocation failure, invalid input, 
+* or pages not found).
+*/
+int main(int argc, char* argv[]) {
+
 
+        int errSeen = 0;
+        int bulkMode = 0;
+        int interactive = 0;
+        int binary = 0;
+        char *inputPath = NULL;
+        char *loadPath = NULL;
+        char *mapPath = NULL;
+        char *importPath = NULL;
+        char *journalPath = NULL;
+        char *basePath = NULL;
+        char *servePath = NULL;
+        char *shareName = NULL;
+        char *attachName = NULL;
+
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "--bulk") == 0) {
+                        bulkMode = 1;
+                } else if (strcmp(argv[i], "--interactive") == 0) {
+                        interactive = 1;
+                } else if (strcmp(argv[i], "--binary") == 0) {
+                        binary = 1;
+                } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+                        loadPath = argv[++i];
+                } else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+                        mapPath = argv[++i];
+                } else if (strcmp(argv[i], "--compress") == 0) {
+                        freezeGraph = packGraph;
+                } else if (strcmp(argv[i], "--k2tree") == 0) {
+                        freezeGraph = k2Graph;
+                } else if (strcmp(argv[i], "--import-edges") == 0 && i + 1 < argc) {
+                        importPath = argv[++i];
+                } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+                        journalPath = argv[++i];
+                } else if (strcmp(argv[i], "--journal-group-records") == 0 && i + 1 < argc) {
+                        if (parseCount(argv[++i], &journalGroupRecords) != 0 || journalGroupRecords == 0) {
+                                fprintf(stderr, "--journal-group-records needs a number of records above 0.\n");
+                                return 1;
+                        }
+                } else if (strcmp(argv[i], "--journal-group-ms") == 0 && i + 1 < argc) {
+                        if (parseCount(argv[++i], &journalGroupMs) != 0) {
+                                fprintf(stderr, "--journal-group-ms needs a number of milliseconds.\n");
+                                return 1;
+                        }
+                } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+                        servePath = argv[++i];
+                } else if (strcmp(argv[i], "--share") == 0 && i + 1 < argc) {
+                        shareName = argv[++i];
+                } else if (strcmp(argv[i], "--attach") == 0 && i + 1 < argc) {
+                        attachName = argv[++i];
+                } else if (strcmp(argv[i], "--no-uring") == 0) {
+                        uringDisabled = 1;
+                } else if (strcmp(argv[i], "--stats") == 0) {
+                        statsEnabled = 1;
+                } else if (inputPath == NULL) {
+                        inputPath = argv[i];
+                } else {
+                        fprintf(stderr, "Too many argumnets were given.\n");
+                        errSeen = 1;
                 }
-		free(action);
-		action = NULL;
-		free(pageLinks);
-		pageLinks = NULL;
+        }
 
+        if (servePath != NULL && binary) {
+                fprintf(stderr, "--serve only speaks the text command syntax.\n");
+                return 1;
         }
-	free(line);
-        if (input != stdin) {
-                fclose(input);
+
+        // THE CLOCK STARTS, AND SIGUSR1 IS SET ASIDE FOR REPORTS, BEFORE ANY OTHER THREAD EXISTS
+        if (statsEnabled) {
+                statsStart();
+        }
+
+        // A SNAPSHOT IS THE STARTING GRAPH THE INPUT'S COMMANDS APPLY TO
+        if ((loadPath != NULL) + (mapPath != NULL) + (attachName != NULL) > 1) {
+                fprintf(stderr, "Only one of --load, --map and --attach can be given.\n");
+                return 1;
         }
+
+        // A JOURNAL NAMES THE SNAPSHOT FILE IT GOES ON TOP OF, AND A SHARED GRAPH ISN'T ONE
+        if (journalPath != NULL && attachName != NULL) {
+                fprintf(stderr, "--journal can't be used with --attach.\n");
+                return 1;
+        }
+
+        // WITHOUT ONE, RECOVERY STARTS FROM THE SNAPSHOT THE JOURNAL GOES ON TOP OF
+        if (journalPath != NULL && loadPath == NULL && mapPath == NULL) {
+                basePath = journalBase(journalPath);
+                loadPath = basePath;
+        }
+
+        if ((loadPath != NULL && loadSnapshot(loadPath) != 0) ||
+            (mapPath != NULL && mapSnapshot(mapPath, &frozenView) != 0) ||
+            (attachName != NULL && attachSnapshot(attachName, &frozenView) != 0)) {
+                free(basePath);
+                freeMemory();
+                return 1;
+        }
+
+        // THE JOURNAL'S COMMANDS ARE REPLAYED ON TOP OF IT, AND EVERY LATER CHANGE IS ADDED TO IT
+        if (journalPath != NULL && journalOpen(journalPath, loadPath != NULL ? loadPath : mapPath) != 0) {
+                free(basePath);
+                freeMemory();
+                return 1;
+        }
+        free(basePath);
+
+        // AN IMPORTED EDGE LIST IS ADDED TO THAT GRAPH BEFORE ANY COMMAND RUNS
+        if (importPath != NULL) {
+                struct token importWords[2] = { { "@loadEdges", 10 }, { importPath, strlen(importPath) } };
+                errSeen += runCommand(importWords, 2, 0);
+        }
+
+        // SOMEONE TYPING COMMANDS GETS EACH ANSWER AS SOON AS THEIR LINE IS DONE
+        if (inputPath == NULL && servePath == NULL && isatty(STDIN_FILENO)) {
+                interactive = 1;
+        }
+
+        if (outputInit(&stdoutResults, STDOUT_FILENO, RESULT_BUFFER_SIZE, interactive) != 0) {
+                journalClose();
+                return 1;
+        }
+        stdoutResults.binary = binary;
+
+        // BATCH RESULTS GO OUT THROUGH IO_URING WHERE THE KERNEL HAS IT, AND THROUGH write() OTHERWISE
+        if (!interactive) {
+                outputUseRing(&stdoutResults);
+        }
+
+        // A SERVER WITHOUT AN INPUT FILE TAKES ALL ITS COMMANDS FROM ITS CLIENTS
+        int inputErrors = servePath != NULL && inputPath == NULL ? 0 : runInput(inputPath, bulkMode, binary);
+
+        if (inputErrors < 0) {
+                journalClose();
+                outputFree(&stdoutResults);
+                return 1;
+        }
+        errSeen += inputErrors;
+
+        // THE GRAPH THE INPUT BUILT IS SHARED WITH OTHER PROCESSES BEFORE ANY CLIENT CAN CHANGE IT
+        if (shareName != NULL) {
+                errSeen += bulkFlush();
+                errSeen += viewThaw(&frozenView) != 0 || shareSnapshot(shareName) != 0;
+        }
+
+        if (servePath != NULL) {
+                outputFlush(&stdoutResults);
+                errSeen += serveSocket(servePath, bulkMode);
+        }
+
+        errSeen += queryStop();
+        errSeen += bulkFlush();
+        journalClose();
+        bulkFree();
+        outputFree(&stdoutResults);
+        viewClose(&frozenView);
         freeMemory();
+        statsStop();
         return errSeen >= 1;
 }
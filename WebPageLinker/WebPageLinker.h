@@ -0,0 +1,125 @@
+#ifndef WEBPAGELINKER_H
+#define WEBPAGELINKER_H
+
+#include <stddef.h>
+
+#include "scan.h"
+#include "output.h"
+
+
+/*
+ * File: WebPageLinker.h
+ * Author: Chance Krueger
+ * Purpose: The graph shared by WebPageLinker.c and the modules built around it:
+ *          the page and link structures, their pools, the name index and the
+ *          operations the command loop runs on them.
+ */
+
+
+
+/*
+ * page -- Represents a web page in a directed graph. 
+ * Each page has a unique name and may contain links to other pages. 
+ * It includes a linked list of outgoing links for efficient graph traversal. 
+ * The `next` pointer links to the next page in the list, 
+ * while `edges` points to the list of outgoing links. 
+ * The `removed` flag tombstones a page deleted by @removePages until the next compaction,
+ * `outCount`/`inCount` count its live links, and `hash` is the hashName() of its name,
+ * set when it enters the name dictionary (see dict.h).
+ * `id` is a dense page number assigned when the graph is written out as a snapshot,
+ * packed, or searched by a run of queries (see query.c).
+ */
+struct page {
+
+
+	char *name;
+	struct page *next;
+	struct link *edges;
+	int removed;
+	int outCount;
+	int inCount;
+	unsigned long long hash;
+	unsigned int id;
+};
+
+
+
+/*
+ * link -- Represents a directed edge in a graph, connecting one page to another.  
+ * The `to` pointer references the destination page of the link.  
+ * The `next` pointer links to the next link in the adjacency list,  
+ * allowing multiple outgoing links from a single page to be stored efficiently.
+ * A link removed by @removeLinks is tombstoned by setting `to` to NULL.
+ */
+struct link {
+
+
+	struct page *to;
+	struct link *next;
+};
+
+
+
+/*
+ * pool -- A slab allocator for fixed-size graph nodes; see poolAlloc() in WebPageLinker.c.
+ */
+struct pool {
+
+
+	size_t itemSize;
+	void *freeList;
+	char *bump;
+	size_t bumpLeft;
+	void *slabs;
+};
+
+/*
+ * pageRef -- What a command runner knows about a name before the command runs: its
+ * hashName() and, once it has been looked up or added, the live page it names, which
+ * is only trusted while `pageGeneration` is still `generation` (see refNode()).
+ */
+struct pageRef {
+
+
+	unsigned long long hash;
+	struct page *page;
+	unsigned long generation;
+};
+
+extern struct page *graphHead;
+extern struct page *graphTail;
+extern struct pool pagePool;
+extern struct pool linkPool;
+extern long pageCount;
+extern long linkCount;
+extern unsigned long pageGeneration;
+extern struct outBuf *resultOut;
+
+
+
+void * poolAllocArray(struct pool *pool, size_t count);
+void * poolAlloc(struct pool *pool);
+void poolRelease(struct pool *pool, void *item);
+unsigned long long hashName(struct token name);
+struct token pageToken(struct page *node);
+int reserveIndex(size_t count);
+int indexInsert(struct page *node);
+struct page * findNode(struct token name);
+struct page * findHashed(struct token name, unsigned long long hash);
+struct page * refNode(struct token name, struct pageRef *ref);
+unsigned long long refHash(struct token name, struct pageRef *ref);
+char * internName(struct token name);
+void appendPage(struct page *node);
+struct page * findOrAddPage(struct token name);
+int addPageToGraph(struct token name);
+int addPageRef(struct token name, struct pageRef *ref);
+int addLinkToPage(struct token srcPage, struct token link);
+int linkPages(struct page *src, struct page *linkNode);
+int spliceLinks(struct link *edges, size_t count);
+void freeMemory();
+int bulkFlush();
+int runCommand(struct token *words, size_t count, int bulkMode);
+int runCommandRefs(struct token *words, struct pageRef **refs, size_t count, int bulkMode);
+int growArray(void **array, size_t *cap, size_t itemSize, size_t need);
+
+#endif
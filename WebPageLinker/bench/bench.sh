@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# File: bench.sh
+# Author: Chance Krueger
+# Purpose: Benchmark harness behind `make -f Makefile.txt bench`. For every model
+#          and graph size it generates a seeded graph and a set of queries with
+#          webgen, then times WebPageLinker building the graph (ingest) and
+#          building it and answering the queries (ingest + query), keeping the
+#          best of BENCH_REPEAT runs of each. The query phase is the difference.
+#          One CSV row per model and size goes to stdout and to BENCH_OUT.
+#          Everything can be set from the environment:
+#            BENCH_MODELS   models to run               (rmat ba web)
+#            BENCH_SIZES    page counts                 (10000 100000 1000000)
+#            BENCH_DEGREE   links out of each page      (8)
+#            BENCH_QUERIES  queries per graph           (100)
+#            BENCH_SEED     generator seed              (1)
+#            BENCH_REPEAT   runs of each phase          (3)
+#            BENCH_FLAGS    extra WebPageLinker flags   (none, e.g. --bulk)
+#            BENCH_OUT      where the CSV goes          (bench/results.csv)
+
+set -e
+
+BIN=${BIN:-./WebPageLinker}
+GEN=${GEN:-./bench/webgen}
+MODELS=${BENCH_MODELS:-"rmat ba web"}
+SIZES=${BENCH_SIZES:-"10000 100000 1000000"}
+DEGREE=${BENCH_DEGREE:-8}
+QUERIES=${BENCH_QUERIES:-100}
+SEED=${BENCH_SEED:-1}
+REPEAT=${BENCH_REPEAT:-3}
+FLAGS=${BENCH_FLAGS:-}
+OUT=${BENCH_OUT:-bench/results.csv}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT INT TERM
+
+
+# best FILE -- prints the fewest nanoseconds any of REPEAT runs of WebPageLinker on FILE took.
+best() {
+	fastest=
+	run=0
+	while [ "$run" -lt "$REPEAT" ]; do
+		start=$(date +%s%N)
+		# ERRORS IN THE GENERATED COMMANDS (A QUERY ON A MISSING PAGE) ARE PART OF THE WORK, NOT A FAILURE
+		$BIN $FLAGS "$1" > /dev/null 2>&1 || true
+		took=$(( $(date +%s%N) - start ))
+		if [ -z "$fastest" ] || [ "$took" -lt "$fastest" ]; then
+			fastest=$took
+		fi
+		run=$((run + 1))
+	done
+	echo "$fastest"
+}
+
+
+header="model,pages,links,queries,degree,seed,flags,ingest_ms,query_ms,links_per_s,queries_per_s"
+echo "$header" > "$OUT"
+echo "$header"
+
+for model in $MODELS; do
+	for pages in $SIZES; do
+
+		$GEN -m "$model" -n "$pages" -d "$DEGREE" -s "$SEED" -e graph > "$work/graph.txt" 2> "$work/stats.txt"
+		$GEN -m "$model" -n "$pages" -d "$DEGREE" -s "$SEED" -q "$QUERIES" -e queries > "$work/queries.txt" 2> /dev/null
+		cat "$work/graph.txt" "$work/queries.txt" > "$work/all.txt"
+		links=$(sed -n 's/.* links \([0-9]*\) .*/\1/p' "$work/stats.txt")
+
+		ingest=$(best "$work/graph.txt")
+		total=$(best "$work/all.txt")
+		query=$(( total > ingest ? total - ingest : 0 ))
+
+		row=$(awk -v m="$model" -v p="$pages" -v l="$links" -v q="$QUERIES" -v d="$DEGREE" -v s="$SEED" \
+			  -v f="$FLAGS" -v i="$ingest" -v t="$query" 'BEGIN {
+			printf "%s,%s,%s,%s,%s,%s,%s,%.3f,%.3f,%.0f,%.0f\n", m, p, l, q, d, s, f, i / 1e6, t / 1e6,
+			       (i > 0 ? l / (i / 1e9) : 0), (t > 0 ? q / (t / 1e9) : 0)
+		}')
+		echo "$row" >> "$OUT"
+		echo "$row"
+	done
+done
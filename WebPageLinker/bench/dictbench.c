@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "dict.h"
+
+
+/*
+ * File: dictbench.c
+ * Author: Chance Krueger
+ * Purpose: Microbenchmark for the page name dictionary. For 1, 2, 4 ... 64 threads
+ *          it fills a fresh dictionary with synthetic page names, every name added
+ *          twice by two different threads as two pages so the insert is raced for,
+ *          then has every thread look up random names, and reports millions of
+ *          inserts and lookups per second. Each run checks that every name ended up
+ *          with exactly one of its two pages and that every lookup found it.
+ *          Usage: dictbench [pages] [lookups per thread]
+ */
+
+
+
+#define MAX_THREADS 64
+#define NAME_LEN 64
+
+
+
+/*
+ * benchRun -- What the threads of one run share: the dictionary, the `count` pages
+ * with their names and hashes and a twin page of each, how many threads there are,
+ * how many lookups each makes and a barrier to start each phase together.
+ */
+struct benchRun {
+
+
+	struct nameDict dict;
+	struct page *pages;
+	struct page *twins;
+	size_t threads;
+	unsigned long long *hashes;
+	size_t count;
+	size_t lookups;
+	pthread_barrier_t start;
+};
+
+
+
+/*
+ * benchThread -- One thread of a run: its number, the inserts it won and the lookups
+ * that found one of the two pages of their name.
+ */
+struct benchThread {
+
+
+	pthread_t thread;
+	struct benchRun *run;
+	size_t index;
+	size_t inserted;
+	size_t found;
+};
+
+
+
+/*
+* now() -- returns the monotonic clock in seconds.
+*/
+double now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+/*
+* benchWorker(arg) -- inserts its share of the pages and the twins of the next thread's share,
+* waits for the others, then makes the run's lookups.
+*/
+void * benchWorker(void *arg) {
+
+	struct benchThread *self = arg;
+	struct benchRun *run = self->run;
+	size_t twinOf = (self->index + 1) % run->threads;
+	unsigned int seed = 777 + self->index;
+
+	pthread_barrier_wait(&run->start);
+
+	for (size_t i = 0; i < run->count; i++) {
+		struct page *node = i % run->threads == self->index ? &run->pages[i] :
+				    i % run->threads == twinOf ? &run->twins[i] : NULL;
+		if (node != NULL) {
+			self->inserted += dictInsert(&run->dict, node) == node;
+		}
+	}
+
+	pthread_barrier_wait(&run->start);
+	pthread_barrier_wait(&run->start);
+
+	for (size_t i = 0; i < run->lookups; i++) {
+		seed = seed * 1103515245 + 12345;
+		size_t pick = ((size_t) seed << 15 ^ seed >> 7) % run->count;
+		struct token name = { run->pages[pick].name, strlen(run->pages[pick].name) };
+		struct page *node = dictFind(&run->dict, name, run->hashes[pick]);
+		self->found += node == &run->pages[pick] || node == &run->twins[pick];
+	}
+
+	pthread_barrier_wait(&run->start);
+	return NULL;
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+	size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+	size_t lookups = argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000;
+	char *names = malloc(count * NAME_LEN + 1);
+	unsigned long long *hashes = malloc(count * sizeof(unsigned long long));
+	struct page *pages = malloc(count * sizeof(struct page));
+	struct page *twins = malloc(count * sizeof(struct page));
+	int failed = 0;
+
+	if (names == NULL || hashes == NULL || pages == NULL || twins == NULL || count == 0) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		snprintf(names + i * NAME_LEN, NAME_LEN, "www.site%zu.example/page%zu", i % 5000, i);
+		struct token name = { names + i * NAME_LEN, strlen(names + i * NAME_LEN) };
+		hashes[i] = hashName(name);
+	}
+
+	printf("# %zu pages, %zu lookups per thread\n", count, lookups);
+	printf("%-8s %16s %16s\n", "threads", "inserts M/s", "lookups M/s");
+
+	for (size_t threads = 1; threads <= MAX_THREADS; threads *= 2) {
+
+		struct benchRun run;
+		struct benchThread workers[MAX_THREADS];
+
+		memset(pages, 0, count * sizeof(struct page));
+		memset(twins, 0, count * sizeof(struct page));
+		for (size_t i = 0; i < count; i++) {
+			pages[i].name = names + i * NAME_LEN;
+			twins[i].name = names + i * NAME_LEN;
+		}
+
+		dictInit(&run.dict);
+		run.pages = pages;
+		run.twins = twins;
+		run.threads = threads;
+		run.hashes = hashes;
+		run.count = count;
+		run.lookups = lookups;
+		pthread_barrier_init(&run.start, NULL, threads + 1);
+
+		memset(workers, 0, sizeof(workers));
+		for (size_t t = 0; t < threads; t++) {
+			workers[t].run = &run;
+			workers[t].index = t;
+			pthread_create(&workers[t].thread, NULL, benchWorker, &workers[t]);
+		}
+
+		pthread_barrier_wait(&run.start);
+		double start = now();
+		pthread_barrier_wait(&run.start);
+		double mid = now();
+		pthread_barrier_wait(&run.start);
+		double lookupStart = now();
+		pthread_barrier_wait(&run.start);
+		double end = now();
+
+		size_t inserted = 0;
+		size_t found = 0;
+		for (size_t t = 0; t < threads; t++) {
+			pthread_join(workers[t].thread, NULL);
+			inserted += workers[t].inserted;
+			found += workers[t].found;
+		}
+
+		printf("%-8zu %16.2f %16.2f\n", threads, 2 * count / (mid - start) / 1e6,
+		       threads * lookups / (end - lookupStart) / 1e6);
+
+		if (inserted != count || found != threads * lookups) {
+			fprintf(stderr, "%zu threads: %zu of %zu pages inserted, %zu of %zu lookups found\n",
+				threads, inserted, count, found, threads * lookups);
+			failed = 1;
+		}
+
+		dictFree(&run.dict);
+		pthread_mutex_destroy(&run.dict.lock);
+		pthread_barrier_destroy(&run.start);
+	}
+
+	free(names);
+	free(hashes);
+	free(pages);
+	free(twins);
+	return failed;
+}
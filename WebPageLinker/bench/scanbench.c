@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scan.h"
+
+
+/*
+ * File: scanbench.c
+ * Author: Chance Krueger
+ * Purpose: Microbenchmark for the command scanner. It builds a synthetic command
+ *          file in memory and reports, for every scan level this CPU supports,
+ *          how many GB/s it can split into lines and into tagged words, next to
+ *          the old memchr + strtok approach on a copy of each line.
+ *          Usage: scanbench [megabytes]
+ */
+
+
+
+#define TOKEN_CAP 4096
+#define REPEATS 3
+
+
+
+/*
+* now() -- returns the monotonic clock in seconds.
+*/
+double now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+/*
+* buildInput(size) -- returns 'size' bytes of command lines shaped like real input: mostly
+* @addLinks with several targets, some @addPages and @isConnected, names of varied length
+* and the occasional run of extra spaces or tabs.
+*/
+char * buildInput(size_t size) {
+
+	char *text = malloc(size);
+	size_t used = 0;
+	unsigned int seed = 12345;
+	const char *actions[] = { "@addLinks", "@addLinks", "@addLinks", "@addPages", "@isConnected" };
+
+	if (text == NULL) {
+		return NULL;
+	}
+
+	while (used + 256 < size) {
+		seed = seed * 1103515245 + 12345;
+		int action = (seed >> 16) % 5;
+		int words = action == 4 ? 2 : 1 + (seed >> 8) % 6;
+
+		used += sprintf(text + used, "%s", actions[action]);
+		for (int i = 0; i < words; i++) {
+			seed = seed * 1103515245 + 12345;
+			const char *gap = (seed >> 20) % 8 == 0 ? " \t  " : " ";
+			used += sprintf(text + used, "%swww.site%u.example/page%u", gap, (seed >> 4) % 5000, seed % 100000);
+		}
+		text[used++] = '\n';
+	}
+
+	memset(text + used, '\n', size - used);
+	return text;
+}
+
+
+
+/*
+* scanLines(text, size) -- counts the lines of 'text' with scanNewline().
+*/
+size_t scanLines(const char *text, size_t size) {
+
+	const char *ptr = text;
+	const char *end = text + size;
+	size_t lines = 0;
+
+	while (ptr < end) {
+		ptr = scanNewline(ptr, end) + 1;
+		lines++;
+	}
+	return lines;
+}
+
+
+
+/*
+* scanWords(text, size, tokens) -- splits 'text' into lines and words and tags every line.
+* Returns a checksum of word counts, word lengths and tags so every level can be compared.
+*/
+size_t scanWords(const char *text, size_t size, struct token *tokens) {
+
+	const char *ptr = text;
+	const char *end = text + size;
+	size_t sum = 0;
+
+	while (ptr < end) {
+		const char *newline = scanNewline(ptr, end);
+		size_t count = scanTokens(ptr, newline - ptr, tokens, TOKEN_CAP);
+
+		if (count > 0) {
+			sum += count + commandTag(tokens[0]) + tokens[count - 1].len;
+		}
+		ptr = newline + 1;
+	}
+	return sum;
+}
+
+
+
+/*
+* strtokWords(text, size) -- the old way: each line is copied and split with strtok and
+* compared against the action names. Returns the same checksum as scanWords().
+*/
+size_t strtokWords(const char *text, size_t size) {
+
+	const char *ptr = text;
+	const char *end = text + size;
+	char line[65536];
+	size_t sum = 0;
+
+	while (ptr < end) {
+		const char *newline = memchr(ptr, '\n', end - ptr);
+		size_t len = newline - ptr;
+
+		memcpy(line, ptr, len);
+		line[len] = 0;
+
+		size_t count = 0;
+		size_t lastLen = 0;
+		int tag = 0;
+		for (char *word = strtok(line, " \t\n\v\f\r"); word != NULL; word = strtok(NULL, " \t\n\v\f\r")) {
+			if (count == 0) {
+				tag = strcmp(word, "@addPages") == 0 ? CMD_ADD_PAGES :
+					strcmp(word, "@addLinks") == 0 ? CMD_ADD_LINKS :
+					strcmp(word, "@isConnected") == 0 ? CMD_IS_CONNECTED : CMD_INVALID;
+			}
+			lastLen = strlen(word);
+			count++;
+		}
+
+		if (count > 0) {
+			sum += count + tag + lastLen;
+		}
+		ptr = newline + 1;
+	}
+	return sum;
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+	size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+	size_t size = megabytes << 20;
+	char *text = buildInput(size);
+	struct token *tokens = malloc(TOKEN_CAP * sizeof(struct token));
+
+	if (text == NULL || tokens == NULL || size == 0) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	double best = 1e30;
+	size_t expected = 0;
+	for (int r = 0; r < REPEATS; r++) {
+		double start = now();
+		expected = strtokWords(text, size);
+		double took = now() - start;
+		best = took < best ? took : best;
+	}
+
+	printf("# %zu MB of commands\n", megabytes);
+	printf("%-8s %12s %12s\n", "level", "lines GB/s", "words GB/s");
+	printf("%-8s %12s %12.2f\n", "strtok", "-", size / best / 1e9);
+
+	int top = scanSetLevel(-1);
+	int failed = 0;
+
+	for (int level = SCAN_SCALAR; level <= top; level++) {
+
+		scanSetLevel(level);
+
+		double bestLines = 1e30;
+		double bestWords = 1e30;
+		size_t sum = 0;
+
+		for (int r = 0; r < REPEATS; r++) {
+			double start = now();
+			scanLines(text, size);
+			double mid = now();
+			sum = scanWords(text, size, tokens);
+			double end = now();
+
+			bestLines = mid - start < bestLines ? mid - start : bestLines;
+			bestWords = end - mid < bestWords ? end - mid : bestWords;
+		}
+
+		printf("%-8s %12.2f %12.2f%s\n", scanLevelName(level), size / bestLines / 1e9,
+			size / bestWords / 1e9, sum == expected ? "" : "  MISMATCH");
+		failed |= sum != expected;
+	}
+
+	free(tokens);
+	free(text);
+	return failed;
+}
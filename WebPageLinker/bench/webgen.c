@@ -0,0 +1,495 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+
+/*
+ * File: webgen.c
+ * Author: Chance Krueger
+ * Purpose: Synthetic web graph generator for benchmarks. It writes the command
+ *          stream that builds a seeded random graph (@addPages, then @addLinks
+ *          grouped by source page) and, after it, random @isConnected queries.
+ *          Three models are offered: R-MAT (recursive quadrant matrix, a skewed
+ *          power law graph), Barabási–Albert (preferential attachment, each new
+ *          page linking to pages in proportion to their degree), and a web-like
+ *          model where pages belong to hosts of power law sizes, most links stay
+ *          inside a host, near the page or to its front page, and the rest go to
+ *          popular hosts. The same arguments always produce the same bytes, and
+ *          the summary on stderr gives the number of pages, links and queries.
+ *          Usage: webgen [-m rmat|ba|web] [-n pages] [-d out-degree] [-q queries]
+ *                        [-s seed] [-e all|graph|queries]
+ */
+
+
+
+#define NAMES_PER_LINE 64
+#define LINKS_PER_LINE 64
+#define NAME_LEN 64
+#define RMAT_A 0.57
+#define RMAT_B 0.19
+#define RMAT_C 0.19
+#define WEB_MAX_HOST 5000
+#define WEB_LOCAL 0.75
+#define WEB_FRONT 0.2
+#define WEB_WINDOW 16
+
+
+
+enum model {
+	MODEL_RMAT,
+	MODEL_BA,
+	MODEL_WEB
+};
+
+
+
+/*
+ * generator -- One run: the model, `pages` pages, about `degree` links out of each,
+ * and the state of its random number generator. The web model puts page i on
+ * host `hostOf[i]`, whose pages start at `hostStart[host]`; `hosts` hosts in all.
+ * `emitGraph` and `emitQueries` say which parts go to stdout, and `links` counts
+ * the links generated.
+ */
+struct generator {
+
+
+	enum model model;
+	uint64_t pages;
+	uint64_t degree;
+	uint64_t state;
+	uint32_t *hostOf;
+	uint64_t *hostStart;
+	uint64_t hosts;
+	int emitGraph;
+	int emitQueries;
+	uint64_t links;
+};
+
+
+
+/*
+* nextRandom(gen) -- returns the next 64 random bits of 'gen' (splitmix64).
+*/
+static uint64_t nextRandom(struct generator *gen) {
+
+	uint64_t z = (gen->state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+
+/*
+* randomBelow(gen, bound) -- returns a random number below 'bound'.
+*/
+static uint64_t randomBelow(struct generator *gen, uint64_t bound) {
+
+	return (uint64_t) (((unsigned __int128) nextRandom(gen) * bound) >> 64);
+}
+
+
+
+/*
+* randomUnit(gen) -- returns a random double in [0, 1).
+*/
+static double randomUnit(struct generator *gen) {
+
+	return (nextRandom(gen) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+
+/*
+* pageName(gen, page, name) -- writes the name of 'page' into 'name', NAME_LEN bytes long.
+*/
+static void pageName(const struct generator *gen, uint64_t page, char *name) {
+
+	if (gen->model == MODEL_WEB) {
+		uint32_t host = gen->hostOf[page];
+		snprintf(name, NAME_LEN, "www.host%u.example/page%llu", host,
+			 (unsigned long long) (page - gen->hostStart[host]));
+	} else {
+		snprintf(name, NAME_LEN, "page%llu", (unsigned long long) page);
+	}
+}
+
+
+
+/*
+* emitPages(gen) -- writes the @addPages lines for every page.
+*/
+static void emitPages(const struct generator *gen) {
+
+	char name[NAME_LEN];
+
+	for (uint64_t page = 0; page < gen->pages; page++) {
+		pageName(gen, page, name);
+		fputs(page % NAMES_PER_LINE == 0 ? "@addPages " : " ", stdout);
+		fputs(name, stdout);
+		if (page % NAMES_PER_LINE == NAMES_PER_LINE - 1 || page + 1 == gen->pages) {
+			putchar('\n');
+		}
+	}
+}
+
+
+
+/*
+* compareIds(a, b) -- qsort order for 64-bit page numbers and packed links.
+*/
+static int compareIds(const void *a, const void *b) {
+
+	uint64_t one = *(const uint64_t *) a;
+	uint64_t two = *(const uint64_t *) b;
+
+	return one < two ? -1 : one > two;
+}
+
+
+
+/*
+* emitLinks(gen, src, targets, count) -- sorts and deduplicates the 'count' targets of page 'src',
+* drops links to itself, and writes what is left as @addLinks lines.
+*/
+static void emitLinks(struct generator *gen, uint64_t src, uint64_t *targets, size_t count) {
+
+	char name[NAME_LEN];
+	size_t onLine = 0;
+
+	qsort(targets, count, sizeof(uint64_t), compareIds);
+
+	for (size_t i = 0; i < count; i++) {
+
+		if (targets[i] == src || (i > 0 && targets[i] == targets[i - 1])) {
+			continue;
+		}
+
+		gen->links++;
+		if (!gen->emitGraph) {
+			continue;
+		}
+
+		if (onLine == 0) {
+			pageName(gen, src, name);
+			printf("@addLinks %s", name);
+		}
+		pageName(gen, targets[i], name);
+		printf(" %s", name);
+
+		if (++onLine == LINKS_PER_LINE) {
+			putchar('\n');
+			onLine = 0;
+		}
+	}
+
+	if (onLine > 0) {
+		putchar('\n');
+	}
+}
+
+
+
+/*
+* generateRmat(gen) -- R-MAT: each link picks one quadrant of the link matrix after another,
+* with probabilities RMAT_A, RMAT_B, RMAT_C and the rest, until it is down to one cell. Page
+* numbers are shuffled so the busiest pages aren't simply the first ones. Returns 0 on success,
+* 1 if out of memory.
+*/
+static int generateRmat(struct generator *gen) {
+
+	uint64_t count = gen->pages * gen->degree;
+	uint64_t *edges = malloc((count + 1) * sizeof(uint64_t));
+	uint64_t *shuffle = malloc(gen->pages * sizeof(uint64_t));
+	uint64_t *targets = malloc((count + 1) * sizeof(uint64_t));
+	int scale = 0;
+
+	if (edges == NULL || shuffle == NULL || targets == NULL) {
+		free(edges);
+		free(shuffle);
+		free(targets);
+		return 1;
+	}
+
+	while ((1ULL << scale) < gen->pages) {
+		scale++;
+	}
+
+	for (uint64_t i = 0; i < gen->pages; i++) {
+		shuffle[i] = i;
+	}
+	for (uint64_t i = gen->pages; i > 1; i--) {
+		uint64_t j = randomBelow(gen, i);
+		uint64_t keep = shuffle[i - 1];
+		shuffle[i - 1] = shuffle[j];
+		shuffle[j] = keep;
+	}
+
+	for (uint64_t i = 0; i < count; ) {
+
+		uint64_t src = 0;
+		uint64_t to = 0;
+
+		for (int level = 0; level < scale; level++) {
+			double pick = randomUnit(gen);
+			src = src << 1 | (pick >= RMAT_A + RMAT_B);
+			to = to << 1 | ((pick >= RMAT_A && pick < RMAT_A + RMAT_B) || pick >= RMAT_A + RMAT_B + RMAT_C);
+		}
+
+		// CELLS PAST THE LAST PAGE ARE DRAWN AGAIN
+		if (src < gen->pages && to < gen->pages) {
+			edges[i++] = shuffle[src] << 32 | shuffle[to];
+		}
+	}
+
+	qsort(edges, count, sizeof(uint64_t), compareIds);
+
+	for (uint64_t start = 0; start < count; ) {
+		uint64_t src = edges[start] >> 32;
+		uint64_t end = start;
+		while (end < count && edges[end] >> 32 == src) {
+			targets[end - start] = edges[end] & 0xFFFFFFFFULL;
+			end++;
+		}
+		emitLinks(gen, src, targets, end - start);
+		start = end;
+	}
+
+	free(edges);
+	free(shuffle);
+	free(targets);
+	return 0;
+}
+
+
+
+/*
+* generateBa(gen) -- Barabási–Albert: the first 'degree' + 1 pages link to every page before
+* them, and each later page links to 'degree' pages picked in proportion to their degree so far,
+* by picking a random end of a random link made so far. Returns 0 on success, 1 if out of memory.
+*/
+static int generateBa(struct generator *gen) {
+
+	uint64_t seedPages = gen->degree + 1 < gen->pages ? gen->degree + 1 : gen->pages;
+	uint64_t *ends = malloc((2 * gen->pages * (gen->degree + 1) + 1) * sizeof(uint64_t));
+	uint64_t *targets = malloc((gen->pages + gen->degree + 1) * sizeof(uint64_t));
+	uint64_t endCount = 0;
+
+	if (ends == NULL || targets == NULL) {
+		free(ends);
+		free(targets);
+		return 1;
+	}
+
+	for (uint64_t page = 0; page < gen->pages; page++) {
+
+		size_t count = 0;
+
+		if (page < seedPages) {
+			for (uint64_t to = 0; to < page; to++) {
+				targets[count++] = to;
+			}
+		} else {
+			for (uint64_t i = 0; i < gen->degree; i++) {
+				targets[count++] = ends[randomBelow(gen, endCount)];
+			}
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			ends[endCount++] = page;
+			ends[endCount++] = targets[i];
+		}
+		emitLinks(gen, page, targets, count);
+	}
+
+	free(ends);
+	free(targets);
+	return 0;
+}
+
+
+
+/*
+* placeHosts(gen) -- splits the pages into hosts of power law sizes, at most WEB_MAX_HOST pages
+* each. Returns 0 on success, 1 if out of memory.
+*/
+static int placeHosts(struct generator *gen) {
+
+	gen->hostOf = malloc(gen->pages * sizeof(uint32_t));
+	gen->hostStart = malloc((gen->pages + 1) * sizeof(uint64_t));
+
+	if (gen->hostOf == NULL || gen->hostStart == NULL) {
+		return 1;
+	}
+
+	for (uint64_t page = 0; page < gen->pages; ) {
+
+		uint64_t size = (uint64_t) (4.0 / pow(1.0 - randomUnit(gen), 1 / 1.2));
+
+		size = size < 1 ? 1 : size > WEB_MAX_HOST ? WEB_MAX_HOST : size;
+		size = size > gen->pages - page ? gen->pages - page : size;
+
+		gen->hostStart[gen->hosts] = page;
+		for (uint64_t i = 0; i < size; i++) {
+			gen->hostOf[page + i] = gen->hosts;
+		}
+		gen->hosts++;
+		page += size;
+	}
+	gen->hostStart[gen->hosts] = gen->pages;
+	return 0;
+}
+
+
+
+/*
+* generateWeb(gen) -- the web-like model, on the hosts placeHosts() made: each page makes up to twice 'degree' links. A share
+* WEB_LOCAL of them stay on its host, going to the host's front page WEB_FRONT of the time and
+* otherwise to a page at most WEB_WINDOW away; the rest go to the front page or any page of
+* another host, with hosts picked so low numbered ones are far more popular. Returns 0 on
+* success, 1 if out of memory.
+*/
+static int generateWeb(struct generator *gen) {
+
+	uint64_t *targets = malloc((2 * gen->degree + 1) * sizeof(uint64_t));
+
+	if (targets == NULL) {
+		return 1;
+	}
+
+	for (uint64_t page = 0; page < gen->pages; page++) {
+
+		uint32_t host = gen->hostOf[page];
+		uint64_t first = gen->hostStart[host];
+		uint64_t size = gen->hostStart[host + 1] - first;
+		size_t count = randomBelow(gen, 2 * gen->degree + 1);
+
+		for (size_t i = 0; i < count; i++) {
+
+			if (randomUnit(gen) < WEB_LOCAL) {
+				if (randomUnit(gen) < WEB_FRONT || size == 1) {
+					targets[i] = first;
+				} else {
+					uint64_t low = page - first > WEB_WINDOW ? page - WEB_WINDOW : first;
+					uint64_t high = first + size - page > WEB_WINDOW ? page + WEB_WINDOW : first + size - 1;
+					targets[i] = low + randomBelow(gen, high - low + 1);
+				}
+				continue;
+			}
+
+			double skew = randomUnit(gen);
+			uint64_t other = (uint64_t) (skew * skew * skew * gen->hosts);
+			uint64_t otherFirst = gen->hostStart[other];
+			uint64_t otherSize = gen->hostStart[other + 1] - otherFirst;
+
+			targets[i] = randomUnit(gen) < 0.5 ? otherFirst : otherFirst + randomBelow(gen, otherSize);
+		}
+		emitLinks(gen, page, targets, count);
+	}
+
+	free(targets);
+	return 0;
+}
+
+
+
+/*
+* emitQueries(gen, count) -- writes 'count' @isConnected queries between random pages.
+*/
+static void emitQueries(struct generator *gen, uint64_t count) {
+
+	char from[NAME_LEN];
+	char to[NAME_LEN];
+
+	for (uint64_t i = 0; i < count; i++) {
+		pageName(gen, randomBelow(gen, gen->pages), from);
+		pageName(gen, randomBelow(gen, gen->pages), to);
+		printf("@isConnected %s %s\n", from, to);
+	}
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+	struct generator gen;
+	const char *modelName = "rmat";
+	const char *emit = "all";
+	uint64_t queries = 0;
+	uint64_t seed = 1;
+	int opt;
+
+	memset(&gen, 0, sizeof(gen));
+	gen.pages = 10000;
+	gen.degree = 8;
+
+	while ((opt = getopt(argc, argv, "m:n:d:q:s:e:")) != -1) {
+		switch (opt) {
+		case 'm': modelName = optarg; break;
+		case 'n': gen.pages = strtoull(optarg, NULL, 10); break;
+		case 'd': gen.degree = strtoull(optarg, NULL, 10); break;
+		case 'q': queries = strtoull(optarg, NULL, 10); break;
+		case 's': seed = strtoull(optarg, NULL, 10); break;
+		case 'e': emit = optarg; break;
+		default:
+			fprintf(stderr, "Usage: webgen [-m rmat|ba|web] [-n pages] [-d out-degree] [-q queries] "
+				"[-s seed] [-e all|graph|queries]\n");
+			return 1;
+		}
+	}
+
+	if (strcmp(modelName, "rmat") == 0) {
+		gen.model = MODEL_RMAT;
+	} else if (strcmp(modelName, "ba") == 0) {
+		gen.model = MODEL_BA;
+	} else if (strcmp(modelName, "web") == 0) {
+		gen.model = MODEL_WEB;
+	} else {
+		fprintf(stderr, "Unknown model %s.\n", modelName);
+		return 1;
+	}
+
+	if (gen.pages == 0 || gen.pages >= UINT32_MAX) {
+		fprintf(stderr, "The number of pages must be between 1 and %u.\n", UINT32_MAX - 1);
+		return 1;
+	}
+
+	gen.emitGraph = strcmp(emit, "queries") != 0;
+	gen.emitQueries = strcmp(emit, "graph") != 0;
+	gen.state = seed;
+
+	// PAGE NAMES NAME THEIR HOST, SO THE HOSTS ARE PLACED BEFORE ANY NAME IS WRITTEN
+	if (gen.model == MODEL_WEB && placeHosts(&gen) != 0) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	if (gen.emitGraph) {
+		emitPages(&gen);
+	}
+
+	// THE GRAPH IS ALWAYS GENERATED, SO THE QUERIES DRAW THE SAME NUMBERS WHATEVER IS WRITTEN
+	int failed = gen.model == MODEL_RMAT ? generateRmat(&gen) :
+		     gen.model == MODEL_BA ? generateBa(&gen) : generateWeb(&gen);
+
+	if (failed) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	if (gen.emitQueries) {
+		emitQueries(&gen, queries);
+	}
+
+	fprintf(stderr, "# model %s pages %llu links %llu queries %llu seed %llu\n", modelName,
+		(unsigned long long) gen.pages, (unsigned long long) gen.links,
+		(unsigned long long) (gen.emitQueries ? queries : 0), (unsigned long long) seed);
+
+	free(gen.hostOf);
+	free(gen.hostStart);
+	return fflush(stdout) != 0;
+}
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "binproto.h"
+#include "varint.h"
+
+
+/*
+ * File: binproto.c
+ * Author: Chance Krueger
+ * Purpose: Implements the binary command frames described in binproto.h. Nothing
+ *          here touches the graph, so the converter in tools/ links it on its own.
+ */
+
+
+
+/*
+ * The action word each opcode stands for, so a decoded frame can go through
+ * runCommand() like a text line.
+ */
+static const struct token actionWords[] = {
+	[CMD_ADD_PAGES] = { "@addPages", 9 },
+	[CMD_ADD_LINKS] = { "@addLinks", 9 },
+	[CMD_IS_CONNECTED] = { "@isConnected", 12 },
+	[CMD_REMOVE_PAGES] = { "@removePages", 12 },
+	[CMD_REMOVE_LINKS] = { "@removeLinks", 12 },
+	[CMD_SAVE] = { "@save", 5 },
+	[CMD_LOAD_EDGES] = { "@loadEdges", 10 },
+	[BIN_QUERY_BATCH] = { "@isConnected", 12 }
+};
+
+
+
+/*
+* binActionWord(opcode) -- returns the action word of 'opcode', or an empty word that
+* commandTag() rejects if the opcode is unknown.
+*/
+struct token binActionWord(int opcode) {
+
+	struct token none = { "", 0 };
+
+	if (opcode <= 0 || opcode >= (int) (sizeof(actionWords) / sizeof(actionWords[0])) ||
+	    actionWords[opcode].ptr == NULL) {
+		return none;
+	}
+	return actionWords[opcode];
+}
+
+
+
+/*
+* grow(array, cap, itemSize, need) -- makes room for 'need' items in the array at '*array',
+* doubling its capacity '*cap'. Returns 0 on success, 1 if out of memory.
+*/
+static int grow(void **array, size_t *cap, size_t itemSize, size_t need) {
+
+	if (need <= *cap) {
+		return 0;
+	}
+
+	size_t newCap = *cap == 0 ? 64 : *cap;
+	while (newCap < need) {
+		newCap *= 2;
+	}
+
+	void *grown = realloc(*array, newCap * itemSize);
+	if (grown == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+	*array = grown;
+	*cap = newCap;
+	return 0;
+}
+
+
+
+/*
+* hashBytes(bytes, len) -- 32-bit FNV-1a hash of a name.
+*/
+static uint32_t hashBytes(const char *bytes, size_t len) {
+
+	uint32_t hash = 2166136261U;
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ (unsigned char) bytes[i]) * 16777619U;
+	}
+	return hash;
+}
+
+
+
+/*
+* findSlot(names, bytes, len) -- returns the slot of 'names' holding the name 'bytes', or the
+* empty slot where it belongs.
+*/
+static size_t findSlot(struct binNames *names, const char *bytes, size_t len) {
+
+	size_t mask = names->slotCount - 1;
+	size_t slot = hashBytes(bytes, len) & mask;
+
+	while (names->slots[slot] != 0) {
+		uint32_t id = names->slots[slot] - 1;
+		if (names->lens[id] == len && memcmp(names->bytes + names->offsets[id], bytes, len) == 0) {
+			break;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+
+
+/*
+* addName(names, bytes, len, indexed) -- gives the name 'bytes' the next page id of 'names'. Only
+* an encoder needs to find ids by name, so only with 'indexed' set is the name put in `slots`.
+* Returns 0 on success, 1 if out of memory.
+*/
+static int addName(struct binNames *names, const char *bytes, size_t len, int indexed) {
+
+	if (names->count >= UINT32_MAX - 1) {
+		fprintf(stderr, "Too many pages in the binary input.\n");
+		return 1;
+	}
+
+	if (grow((void **) &names->bytes, &names->cap, 1, names->used + len) != 0) {
+		return 1;
+	}
+
+	size_t oldCap = names->idCap;
+	if (grow((void **) &names->offsets, &names->idCap, sizeof(size_t), names->count + 1) != 0 ||
+	    grow((void **) &names->lens, &oldCap, sizeof(size_t), names->count + 1) != 0) {
+		return 1;
+	}
+
+	// THE TABLE IS KEPT AT MOST HALF FULL, AND REBUILT TWICE AS LARGE WHEN IT GETS THERE
+	if (indexed && (names->count + 1) * 2 > names->slotCount) {
+		size_t slotCount = names->slotCount == 0 ? 256 : names->slotCount * 2;
+		uint32_t *slots = calloc(slotCount, sizeof(uint32_t));
+		if (slots == NULL) {
+			fprintf(stderr, "Ran Out Of Memory.\n");
+			return 1;
+		}
+		free(names->slots);
+		names->slots = slots;
+		names->slotCount = slotCount;
+
+		for (size_t id = 0; id < names->count; id++) {
+			names->slots[findSlot(names, names->bytes + names->offsets[id], names->lens[id])] = id + 1;
+		}
+	}
+
+	memcpy(names->bytes + names->used, bytes, len);
+	names->offsets[names->count] = names->used;
+	names->lens[names->count] = len;
+	if (indexed) {
+		names->slots[findSlot(names, bytes, len)] = names->count + 1;
+	}
+	names->used += len;
+	names->count++;
+	return 0;
+}
+
+
+
+/*
+* binEncode(names, opcode, args, count, frame, len, cap) -- appends the frame for 'opcode' with the
+* 'count' names 'args' to the '*len' bytes of the growable buffer '*frame' (capacity '*cap'). Names
+* 'names' already holds are sent as their page id, and new ones are added to it. Returns 0 on
+* success, 1 if out of memory or the frame would be too large.
+*/
+int binEncode(struct binNames *names, int opcode, const struct token *args, size_t count,
+	      uint8_t **frame, size_t *len, size_t *cap) {
+
+	size_t start = *len;
+	size_t need = start + 4 + 1 + 10;
+
+	for (size_t i = 0; i < count; i++) {
+		need += 10 + args[i].len;
+	}
+
+	if (grow((void **) frame, cap, 1, need) != 0) {
+		return 1;
+	}
+
+	uint8_t *out = *frame;
+	size_t pos = start + 4;
+
+	out[pos++] = (uint8_t) opcode;
+	pos += putVarint(out + pos, count);
+
+	for (size_t i = 0; i < count; i++) {
+
+		size_t slot = names->slotCount == 0 ? 0 : findSlot(names, args[i].ptr, args[i].len);
+
+		if (names->slotCount != 0 && names->slots[slot] != 0) {
+			pos += putVarint(out + pos, (uint64_t) (names->slots[slot] - 1) << 1 | 1);
+			continue;
+		}
+
+		if (addName(names, args[i].ptr, args[i].len, 1) != 0) {
+			return 1;
+		}
+		pos += putVarint(out + pos, (uint64_t) args[i].len << 1);
+		memcpy(out + pos, args[i].ptr, args[i].len);
+		pos += args[i].len;
+	}
+
+	size_t body = pos - start - 4;
+	if (body > BIN_MAX_FRAME) {
+		fprintf(stderr, "A command is too large for the binary format.\n");
+		return 1;
+	}
+
+	out[start] = (uint8_t) body;
+	out[start + 1] = (uint8_t) (body >> 8);
+	out[start + 2] = (uint8_t) (body >> 16);
+	out[start + 3] = (uint8_t) (body >> 24);
+	*len = pos;
+	return 0;
+}
+
+
+
+/*
+* binDecode(names, body, len, opcode, args, count, cap) -- decodes the 'len' byte frame 'body' that
+* followed a length prefix into '*opcode' and '*count' name views in the growable array '*args' of
+* capacity '*cap'. The views point into 'names', which gets the frame's new names, and stay valid
+* until the next call. Returns 0 on success, 1 if the frame is malformed or out of memory.
+*/
+int binDecode(struct binNames *names, const uint8_t *body, size_t len, int *opcode,
+	      struct token **args, size_t *count, size_t *cap) {
+
+	const uint8_t *ptr = body + 1;
+	const uint8_t *end = body + len;
+	uint64_t names64;
+
+	if (len == 0 || readVarint(&ptr, end, &names64) != 0 || names64 > (uint64_t) (end - ptr)) {
+		return 1;
+	}
+
+	if (grow((void **) args, cap, sizeof(struct token), names64) != 0) {
+		return 1;
+	}
+
+	// IDS ARE COLLECTED FIRST, SINCE A NEW NAME CAN MOVE THE BYTES EARLIER ONES POINT INTO
+	for (size_t i = 0; i < names64; i++) {
+
+		uint64_t value;
+
+		if (readVarint(&ptr, end, &value) != 0) {
+			return 1;
+		}
+
+		if (value & 1) {
+			if ((value >> 1) >= names->count) {
+				return 1;
+			}
+			(*args)[i].len = value >> 1;
+			continue;
+		}
+
+		if ((value >> 1) > (uint64_t) (end - ptr) || addName(names, (const char *) ptr, value >> 1, 0) != 0) {
+			return 1;
+		}
+		(*args)[i].len = names->count - 1;
+		ptr += value >> 1;
+	}
+
+	if (ptr != end) {
+		return 1;
+	}
+
+	for (size_t i = 0; i < names64; i++) {
+		size_t id = (*args)[i].len;
+		(*args)[i].ptr = names->bytes + names->offsets[id];
+		(*args)[i].len = names->lens[id];
+	}
+
+	*opcode = body[0];
+	*count = names64;
+	return 0;
+}
+
+
+
+/*
+* binNamesFree(names) -- frees the page ids of a stream.
+*/
+void binNamesFree(struct binNames *names) {
+
+	free(names->bytes);
+	free(names->offsets);
+	free(names->lens);
+	free(names->slots);
+	memset(names, 0, sizeof(struct binNames));
+}
@@ -0,0 +1,70 @@
+#ifndef BINPROTO_H
+#define BINPROTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scan.h"
+
+
+/*
+ * File: binproto.h
+ * Author: Chance Krueger
+ * Purpose: A compact binary form of the command language, read with --binary in
+ *          place of the text syntax. Every command is one length prefixed frame:
+ *
+ *            u32 length    little endian byte count of the rest of the frame
+ *            u8 opcode     an enum commandTag value, or BIN_QUERY_BATCH
+ *            varint count  how many names follow
+ *            count names
+ *
+ *          A name is a varint v. An even v is followed by v / 2 bytes of a name not
+ *          seen before in the stream, which gets the next page id, counting from 0.
+ *          An odd v repeats the name with page id v / 2. BIN_QUERY_BATCH carries
+ *          an array of @isConnected pairs, so count is twice the number of queries.
+ *
+ *          Results are binary too: one byte per query, BIN_CONNECTED or
+ *          BIN_NOT_CONNECTED, or BIN_FAILED where the text syntax prints only an
+ *          error, so answers always line up with the queries that were sent.
+ */
+
+
+
+#define BIN_QUERY_BATCH 16
+#define BIN_NOT_CONNECTED 0
+#define BIN_CONNECTED 1
+#define BIN_FAILED 0xFF
+#define BIN_MAX_FRAME (1U << 30)
+
+
+
+/*
+ * binNames -- The page ids of one binary stream, in the order their names first
+ * appeared. Name i is the `lens[i]` bytes at `bytes + offsets[i]`, and the open
+ * addressing table `slots` (`slotCount` entries, id + 1 or 0 when empty) finds
+ * the id of a name when encoding.
+ */
+struct binNames {
+
+
+	char *bytes;
+	size_t used;
+	size_t cap;
+	size_t *offsets;
+	size_t *lens;
+	size_t count;
+	size_t idCap;
+	uint32_t *slots;
+	size_t slotCount;
+};
+
+
+
+int binEncode(struct binNames *names, int opcode, const struct token *args, size_t count,
+	      uint8_t **frame, size_t *len, size_t *cap);
+int binDecode(struct binNames *names, const uint8_t *body, size_t len, int *opcode,
+	      struct token **args, size_t *count, size_t *cap);
+struct token binActionWord(int opcode);
+void binNamesFree(struct binNames *names);
+
+#endif
@@ -0,0 +1,285 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compressed.h"
+
+
+/*
+ * File: compressed.c
+ * Author: Chance Krueger
+ * Purpose: Implements the decompressing input described in compressed.h.
+ */
+
+
+
+#define OUT_CHUNK_SIZE (1 << 20)
+#define PIPE_SIZE (1 << 20)
+
+enum format {
+	FORMAT_GZIP = 1,
+	FORMAT_ZSTD
+};
+
+
+
+/*
+ * decompressor -- The thread turning the `inLen` compressed bytes at `in` (the
+ * reader's old mapping) into plain input written to the pipe `out`. `failed` is
+ * set if the data turns out to be damaged.
+ */
+struct decompressor {
+
+
+	pthread_t thread;
+	enum format format;
+	unsigned char *in;
+	size_t inLen;
+	int out;
+	int failed;
+};
+
+
+
+/*
+* writeOut(out, bytes, len) -- writes 'len' bytes to the pipe 'out'. Returns 0 on success, or 1
+* if the reader has gone away.
+*/
+static int writeOut(int out, const unsigned char *bytes, size_t len) {
+
+	while (len > 0) {
+		ssize_t wrote = write(out, bytes, len);
+		if (wrote < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return 1;
+		}
+		bytes += wrote;
+		len -= wrote;
+	}
+	return 0;
+}
+
+
+
+/*
+* gunzip(work, buf) -- inflates the gzip members that make up the input of 'work' through the
+* OUT_CHUNK_SIZE byte buffer 'buf'. Returns 0 on success, 1 if the data is damaged, -1 if the
+* reader stopped listening.
+*/
+static int gunzip(struct decompressor *work, unsigned char *buf) {
+
+	z_stream stream;
+	int status = Z_OK;
+
+	memset(&stream, 0, sizeof(z_stream));
+	if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+		return 1;
+	}
+
+	stream.next_in = work->in;
+
+	// A FILE CAN HOLD SEVERAL GZIP MEMBERS BACK TO BACK, AS `cat a.gz b.gz` MAKES
+	do {
+		size_t left = work->in + work->inLen - stream.next_in;
+		stream.avail_in = left > UINT_MAX ? UINT_MAX : left;
+		stream.next_out = buf;
+		stream.avail_out = OUT_CHUNK_SIZE;
+
+		status = inflate(&stream, Z_NO_FLUSH);
+
+		if ((status != Z_OK && status != Z_STREAM_END) || (status == Z_OK && stream.avail_out == OUT_CHUNK_SIZE)) {
+			break;
+		}
+		if (writeOut(work->out, buf, OUT_CHUNK_SIZE - stream.avail_out) != 0) {
+			inflateEnd(&stream);
+			return -1;
+		}
+		if (status == Z_STREAM_END && stream.next_in < work->in + work->inLen) {
+			inflateReset(&stream);
+		}
+	} while (stream.next_in < work->in + work->inLen || stream.avail_out == 0);
+
+	inflateEnd(&stream);
+	return status != Z_STREAM_END;
+}
+
+
+
+#ifdef HAVE_ZSTD
+/*
+* unzstd(work, buf) -- decompresses the zstd frames that make up the input of 'work' through the
+* OUT_CHUNK_SIZE byte buffer 'buf'. Returns 0 on success, 1 if the data is damaged, -1 if the
+* reader stopped listening.
+*/
+static int unzstd(struct decompressor *work, unsigned char *buf) {
+
+	ZSTD_DStream *stream = ZSTD_createDStream();
+	ZSTD_inBuffer in = { work->in, work->inLen, 0 };
+	ZSTD_outBuffer out = { buf, OUT_CHUNK_SIZE, 0 };
+	size_t status = 1;
+
+	if (stream == NULL) {
+		return 1;
+	}
+
+	do {
+		out.pos = 0;
+		status = ZSTD_decompressStream(stream, &out, &in);
+
+		if (ZSTD_isError(status) || (out.pos == 0 && in.pos == in.size)) {
+			break;
+		}
+		if (writeOut(work->out, buf, out.pos) != 0) {
+			ZSTD_freeDStream(stream);
+			return -1;
+		}
+	} while (in.pos < in.size || out.pos == out.size);
+
+	ZSTD_freeDStream(stream);
+	return ZSTD_isError(status) || status != 0;
+}
+#endif
+
+
+
+/*
+* decompressMain(arg) -- the decompression thread. SIGPIPE is blocked so a reader closing its end
+* early shows up as a failed write instead of killing the process.
+*/
+static void * decompressMain(void *arg) {
+
+	struct decompressor *work = arg;
+	unsigned char *buf = malloc(OUT_CHUNK_SIZE);
+	sigset_t pipeSignal;
+	int status = 1;
+
+	sigemptyset(&pipeSignal);
+	sigaddset(&pipeSignal, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipeSignal, NULL);
+
+	if (buf == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+	} else if (work->format == FORMAT_GZIP) {
+		status = gunzip(work, buf);
+#ifdef HAVE_ZSTD
+	} else {
+		status = unzstd(work, buf);
+#endif
+	}
+
+	if (status > 0) {
+		fprintf(stderr, "The compressed input is damaged.\n");
+		work->failed = 1;
+	}
+
+	free(buf);
+	close(work->out);
+	return NULL;
+}
+
+
+
+/*
+* compressedOpen(reader) -- checks whether the file 'reader' has just mapped is compressed, and if
+* so hands the mapping to a decompression thread and points the reader at the read end of a pipe
+* the thread fills. Anything else is left as it is. Returns 0 on success, 1 if the file is in a
+* format this build can't read or the thread can't be started.
+*/
+int compressedOpen(struct lineReader *reader) {
+
+	const unsigned char *magic = (const unsigned char *) reader->map;
+	enum format format;
+
+	if (magic == NULL || reader->mapLen < 4) {
+		return 0;
+	}
+
+	if (magic[0] == 0x1F && magic[1] == 0x8B) {
+		format = FORMAT_GZIP;
+	} else if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) {
+		format = FORMAT_ZSTD;
+	} else {
+		return 0;
+	}
+
+#ifndef HAVE_ZSTD
+	if (format == FORMAT_ZSTD) {
+		fprintf(stderr, "Reading zstd input needs a build with HAVE_ZSTD.\n");
+		return 1;
+	}
+#endif
+
+	struct decompressor *work = calloc(1, sizeof(struct decompressor));
+	int ends[2];
+
+	if (work == NULL || pipe(ends) != 0) {
+		free(work);
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	// A LARGER PIPE LETS THE THREAD GET FURTHER AHEAD OF THE PARSER
+#ifdef F_SETPIPE_SZ
+	fcntl(ends[1], F_SETPIPE_SZ, PIPE_SIZE);
+#endif
+
+	work->format = format;
+	work->in = (unsigned char *) reader->map;
+	work->inLen = reader->mapLen;
+	work->out = ends[1];
+
+	if (pthread_create(&work->thread, NULL, decompressMain, work) != 0) {
+		close(ends[0]);
+		close(ends[1]);
+		free(work);
+		fprintf(stderr, "Couldn't start decompressing the input.\n");
+		return 1;
+	}
+
+	if (reader->fd > STDIN_FILENO) {
+		close(reader->fd);
+	}
+	reader->fd = ends[0];
+	reader->map = NULL;
+	reader->mapLen = 0;
+	reader->decompressor = work;
+	return 0;
+}
+
+
+
+/*
+* compressedClose(reader) -- stops the decompression thread of 'reader', if it has one, and unmaps
+* the compressed file. The pipe's read end must already be closed, so a thread still writing
+* gives up. Returns 0 on success, 1 if the compressed data was damaged.
+*/
+int compressedClose(struct lineReader *reader) {
+
+	struct decompressor *work = reader->decompressor;
+
+	if (work == NULL) {
+		return 0;
+	}
+
+	pthread_join(work->thread, NULL);
+	munmap(work->in, work->inLen);
+
+	int failed = work->failed;
+	free(work);
+	reader->decompressor = NULL;
+	return failed;
+}
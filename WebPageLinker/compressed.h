@@ -0,0 +1,21 @@
+#ifndef COMPRESSED_H
+#define COMPRESSED_H
+
+#include "reader.h"
+
+
+/*
+ * File: compressed.h
+ * Author: Chance Krueger
+ * Purpose: Transparent compressed input. A gzip (or, built with HAVE_ZSTD, a zstd)
+ *          file is recognised by its magic bytes when a lineReader opens it and
+ *          is decompressed on a thread of its own, straight from the mapped file
+ *          into a pipe the reader reads as if the input had been piped in.
+ */
+
+
+
+int compressedOpen(struct lineReader *reader);
+int compressedClose(struct lineReader *reader);
+
+#endif
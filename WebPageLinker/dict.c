@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dict.h"
+
+
+/*
+ * File: dict.c
+ * Author: Chance Krueger
+ * Purpose: Implements the lock-free page name dictionary described in dict.h.
+ */
+
+
+
+#define DICT_MIN_SLOTS 1024
+
+
+
+/*
+ * dictTable -- `mask` + 1 slots, each empty (NULL), a page, a removed page's
+ * tombstone or, once the table is being replaced, the moved mark. `used` counts
+ * the slots that aren't empty; the table is replaced once half of them are.
+ * `next` is the table replacing this one, and `retiredNext` chains retired tables.
+ */
+struct dictTable {
+
+
+	size_t mask;
+	atomic_size_t used;
+	_Atomic(struct dictTable *) next;
+	struct dictTable *retiredNext;
+	_Atomic(struct page *) slots[];
+};
+
+static struct page tombstoneMark;
+static struct page movedMark;
+
+#define TOMBSTONE (&tombstoneMark)
+#define MOVED (&movedMark)
+
+
+
+/*
+* hashName(name) -- returns the 64-bit FNV-1a hash of the bytes of 'name'.
+*/
+unsigned long long hashName(struct token name) {
+
+	unsigned long long hash = 1469598103934665603ULL;
+
+	for (size_t i = 0; i < name.len; i++) {
+		hash ^= (unsigned char) name.ptr[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+
+/*
+* sameName(node, name, hash) -- returns 1 if the page 'node' is called 'name', whose hash is 'hash'.
+*/
+static int sameName(const struct page *node, struct token name, unsigned long long hash) {
+
+	return node->hash == hash && strncmp(node->name, name.ptr, name.len) == 0 && node->name[name.len] == 0;
+}
+
+
+
+/*
+* tableAlloc(slots) -- returns a new table of 'slots' empty slots, or NULL if out of memory.
+*/
+static struct dictTable * tableAlloc(size_t slots) {
+
+	struct dictTable *table = malloc(sizeof(struct dictTable) + slots * sizeof(_Atomic(struct page *)));
+
+	if (table == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return NULL;
+	}
+
+	table->mask = slots - 1;
+	table->retiredNext = NULL;
+	atomic_init(&table->used, 0);
+	atomic_init(&table->next, NULL);
+	for (size_t i = 0; i < slots; i++) {
+		atomic_init(&table->slots[i], NULL);
+	}
+	return table;
+}
+
+
+
+/*
+* dictInit(dict) -- makes 'dict' an empty dictionary. Returns 0 on success, 1 on error.
+*/
+int dictInit(struct nameDict *dict) {
+
+	atomic_init(&dict->table, NULL);
+	atomic_init(&dict->live, 0);
+	dict->retired = NULL;
+	return pthread_mutex_init(&dict->lock, NULL) != 0;
+}
+
+
+
+/*
+* dictFind(dict, name, hash) -- returns the live page called 'name', whose hashName() is 'hash', or
+* NULL if there is none. It never waits: the probe of each table ends at an empty slot or, while a
+* resize is going on, at a moved mark, where it carries on in the table replacing that one.
+*/
+struct page * dictFind(struct nameDict *dict, struct token name, unsigned long long hash) {
+
+	struct dictTable *table = atomic_load_explicit(&dict->table, memory_order_acquire);
+
+	while (table != NULL) {
+
+		size_t slot = hash & table->mask;
+
+		for (size_t probes = 0; probes <= table->mask; probes++) {
+
+			struct page *entry = atomic_load_explicit(&table->slots[slot], memory_order_acquire);
+
+			if (entry == NULL) {
+				return NULL;
+			}
+			if (entry == MOVED) {
+				break;
+			}
+			if (entry != TOMBSTONE && sameName(entry, name, hash)) {
+				return entry;
+			}
+			slot = (slot + 1) & table->mask;
+		}
+		table = atomic_load_explicit(&table->next, memory_order_acquire);
+	}
+	return NULL;
+}
+
+
+
+/*
+* place(table, node) -- puts 'node' in the first empty slot of its probe in 'table', which only the
+* resizing thread writes to.
+*/
+static void place(struct dictTable *table, struct page *node) {
+
+	size_t slot = node->hash & table->mask;
+
+	while (atomic_load_explicit(&table->slots[slot], memory_order_relaxed) != NULL) {
+		slot = (slot + 1) & table->mask;
+	}
+	atomic_store_explicit(&table->slots[slot], node, memory_order_release);
+	atomic_fetch_add_explicit(&table->used, 1, memory_order_relaxed);
+}
+
+
+
+/*
+* resize(dict, old, count) -- with the lock held, replaces the table 'old' (NULL if there is none yet)
+* by one with room for 'count' more pages than are live, copying the live pages across. Inserts that
+* meet a moved mark wait on the lock for the new table. Returns 0 on success, 1 if out of memory.
+*/
+static int resize(struct nameDict *dict, struct dictTable *old, size_t count) {
+
+	size_t slots = DICT_MIN_SLOTS;
+
+	// AT MOST A QUARTER FULL AFTERWARDS, SO THE NEXT RESIZE IS AS MANY INSERTS AWAY AGAIN
+	while (slots < 4 * (atomic_load(&dict->live) + count)) {
+		slots *= 2;
+	}
+
+	struct dictTable *table = tableAlloc(slots);
+
+	if (table == NULL) {
+		return 1;
+	}
+
+	if (old != NULL) {
+
+		atomic_store_explicit(&old->next, table, memory_order_release);
+
+		for (size_t i = 0; i <= old->mask; i++) {
+
+			struct page *entry = NULL;
+
+			// AN INSERT THAT CLAIMS THE SLOT FIRST IS COPIED; ONE THAT COMES LATER FINDS THE MARK
+			if (atomic_compare_exchange_strong(&old->slots[i], &entry, MOVED)) {
+				continue;
+			}
+			if (entry != TOMBSTONE) {
+				place(table, entry);
+			}
+		}
+
+		old->retiredNext = dict->retired;
+		dict->retired = old;
+	}
+
+	atomic_store_explicit(&dict->table, table, memory_order_release);
+	return 0;
+}
+
+
+
+/*
+* dictInsert(dict, node) -- adds the page 'node' under its name unless a live page already has that
+* name, and sets its `hash`. Any number of threads may insert at once. Returns the page that has
+* the name afterwards, 'node' if it was added, or NULL if out of memory.
+*/
+struct page * dictInsert(struct nameDict *dict, struct page *node) {
+
+	struct token name = { node->name, strlen(node->name) };
+
+	node->hash = hashName(name);
+
+	while (1) {
+
+		struct dictTable *table = atomic_load_explicit(&dict->table, memory_order_acquire);
+
+		if (table == NULL) {
+			pthread_mutex_lock(&dict->lock);
+			int failed = atomic_load(&dict->table) == NULL && resize(dict, NULL, 1) != 0;
+			pthread_mutex_unlock(&dict->lock);
+			if (failed) {
+				return NULL;
+			}
+			continue;
+		}
+
+		size_t slot = node->hash & table->mask;
+		size_t probes = 0;
+		struct page *entry = atomic_load_explicit(&table->slots[slot], memory_order_acquire);
+
+		while (entry != MOVED) {
+
+			if (entry == NULL) {
+
+				// ON A LOST RACE 'entry' IS WHAT WON THE SLOT, AND IT IS LOOKED AT AGAIN
+				if (!atomic_compare_exchange_strong_explicit(&table->slots[slot], &entry, node,
+									     memory_order_acq_rel, memory_order_acquire)) {
+					continue;
+				}
+
+				atomic_fetch_add(&dict->live, 1);
+				size_t used = atomic_fetch_add(&table->used, 1) + 1;
+
+				if (2 * used > table->mask + 1) {
+					pthread_mutex_lock(&dict->lock);
+					if (atomic_load(&dict->table) == table) {
+						resize(dict, table, 0);
+					}
+					pthread_mutex_unlock(&dict->lock);
+				}
+				return node;
+			}
+
+			if (entry != TOMBSTONE && sameName(entry, name, node->hash)) {
+				return entry;
+			}
+
+			// ONLY A TABLE THAT COULDN'T GROW FOR LACK OF MEMORY FILLS UP
+			if (++probes > table->mask) {
+				return NULL;
+			}
+			slot = (slot + 1) & table->mask;
+			entry = atomic_load_explicit(&table->slots[slot], memory_order_acquire);
+		}
+
+		// THE TABLE IS BEING REPLACED; THE RESIZE HOLDS THE LOCK UNTIL THE NEW ONE IS IN USE
+		pthread_mutex_lock(&dict->lock);
+		pthread_mutex_unlock(&dict->lock);
+	}
+}
+
+
+
+/*
+* dictRemove(dict, node) -- takes the page 'node' out of the dictionary, leaving a tombstone that
+* lookups step over, so the name can be added again.
+*/
+void dictRemove(struct nameDict *dict, struct page *node) {
+
+	pthread_mutex_lock(&dict->lock);
+
+	struct dictTable *table = atomic_load(&dict->table);
+
+	size_t slot = node->hash & table->mask;
+
+	for (size_t probes = 0; probes <= table->mask; probes++, slot = (slot + 1) & table->mask) {
+
+		struct page *entry = atomic_load(&table->slots[slot]);
+
+		if (entry == node) {
+			atomic_store_explicit(&table->slots[slot], TOMBSTONE, memory_order_release);
+			atomic_fetch_sub(&dict->live, 1);
+			break;
+		}
+		if (entry == NULL) {
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&dict->lock);
+}
+
+
+
+/*
+* dictReserve(dict, count) -- makes room for 'count' more pages up front, so adding them doesn't
+* resize the table part way. Returns 0 on success, 1 if out of memory.
+*/
+int dictReserve(struct nameDict *dict, size_t count) {
+
+	int failed = 0;
+
+	pthread_mutex_lock(&dict->lock);
+
+	struct dictTable *table = atomic_load(&dict->table);
+
+	if (table == NULL || 2 * (atomic_load(&table->used) + count) > table->mask + 1) {
+		failed = resize(dict, table, count);
+	}
+
+	pthread_mutex_unlock(&dict->lock);
+	return failed;
+}
+
+
+
+/*
+* dictCollect(dict) -- frees the tables replaced by resizes. It must only be called while no other
+* thread is using 'dict'.
+*/
+void dictCollect(struct nameDict *dict) {
+
+	while (dict->retired != NULL) {
+		struct dictTable *next = dict->retired->retiredNext;
+		free(dict->retired);
+		dict->retired = next;
+	}
+}
+
+
+
+/*
+* dictFree(dict) -- frees every table of 'dict', leaving it empty. The pages themselves are the
+* caller's. It must only be called while no other thread is using 'dict'.
+*/
+void dictFree(struct nameDict *dict) {
+
+	dictCollect(dict);
+	free(atomic_load(&dict->table));
+	atomic_store(&dict->table, NULL);
+	atomic_store(&dict->live, 0);
+}
@@ -0,0 +1,55 @@
+#ifndef DICT_H
+#define DICT_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "WebPageLinker.h"
+
+
+/*
+ * File: dict.h
+ * Author: Chance Krueger
+ * Purpose: The page name dictionary: a lock-free open addressing hash table from
+ *          name to live page. Lookups never lock or wait and may run on any number
+ *          of threads alongside inserts, which claim an empty slot with a single
+ *          compare-and-swap, so two threads adding the same name agree on one page.
+ *          Growing the table copies it into a bigger one while lookups go on: every
+ *          empty slot of the old table is marked as moved, and a lookup that meets
+ *          the mark carries on in the new table. Only resizes and removals take the
+ *          dictionary's lock.
+ */
+
+
+
+struct dictTable;
+
+
+
+/*
+ * nameDict -- One dictionary. `table` is the table in use; `live` counts the pages
+ * in it. Tables replaced by a resize are chained from `retired` until dictCollect()
+ * frees them, since a lookup may still be reading one. `lock` serializes resizes and
+ * removals.
+ */
+struct nameDict {
+
+
+	_Atomic(struct dictTable *) table;
+	atomic_size_t live;
+	struct dictTable *retired;
+	pthread_mutex_t lock;
+};
+
+
+
+int dictInit(struct nameDict *dict);
+struct page * dictFind(struct nameDict *dict, struct token name, unsigned long long hash);
+struct page * dictInsert(struct nameDict *dict, struct page *node);
+void dictRemove(struct nameDict *dict, struct page *node);
+int dictReserve(struct nameDict *dict, size_t count);
+void dictCollect(struct nameDict *dict);
+void dictFree(struct nameDict *dict);
+
+#endif
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "WebPageLinker.h"
+#include "reader.h"
+#include "import.h"
+#include "journal.h"
+
+
+/*
+ * File: import.c
+ * Author: Chance Krueger
+ * Purpose: Implements the edge list importer described in import.h.
+ */
+
+
+
+/*
+ * edgeFormat -- How the fields of an edge list line are separated.
+ */
+enum edgeFormat {
+	EDGES_UNKNOWN,
+	EDGES_TSV,
+	EDGES_CSV,
+	EDGES_SPACES
+};
+
+
+
+/*
+* isBlank(c) -- returns 1 if 'c' is a space, a tab or a carriage return.
+*/
+static inline int isBlank(char c) {
+
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+
+/*
+* trimField(ptr, len) -- returns the view of 'len' bytes at 'ptr' without its surrounding
+* whitespace and, if the field is quoted, without its double quotes.
+*/
+static struct token trimField(const char *ptr, size_t len) {
+
+	while (len > 0 && isBlank(ptr[0])) {
+		ptr++;
+		len--;
+	}
+	while (len > 0 && isBlank(ptr[len - 1])) {
+		len--;
+	}
+	if (len >= 2 && ptr[0] == '"' && ptr[len - 1] == '"') {
+		ptr++;
+		len -= 2;
+	}
+
+	struct token field = { ptr, len };
+	return field;
+}
+
+
+
+/*
+* detectFormat(line, len) -- picks the format of an edge list from its first data line:
+* a tab means TSV, otherwise a comma means CSV, otherwise fields are split on whitespace.
+*/
+static enum edgeFormat detectFormat(const char *line, size_t len) {
+
+	if (memchr(line, '\t', len) != NULL) {
+		return EDGES_TSV;
+	}
+	if (memchr(line, ',', len) != NULL) {
+		return EDGES_CSV;
+	}
+	return EDGES_SPACES;
+}
+
+
+
+/*
+* splitEdge(line, len, format, fields) -- stores the first two fields of an edge list line in
+* 'fields'; any further columns (weights, timestamps) are ignored. Returns 1 if the line has
+* two non-empty fields, 0 otherwise.
+*/
+static int splitEdge(const char *line, size_t len, enum edgeFormat format, struct token fields[2]) {
+
+	if (format == EDGES_SPACES) {
+		return scanTokens(line, len, fields, 2) >= 2;
+	}
+
+	char delim = format == EDGES_TSV ? '\t' : ',';
+	const char *end = line + len;
+	const char *first = memchr(line, delim, len);
+
+	if (first == NULL) {
+		return 0;
+	}
+
+	const char *second = memchr(first + 1, delim, end - first - 1);
+
+	fields[0] = trimField(line, first - line);
+	fields[1] = trimField(first + 1, (second != NULL ? second : end) - first - 1);
+	return fields[0].len > 0 && fields[1].len > 0;
+}
+
+
+
+/*
+* importPage(name, errors) -- returns the live page called 'name', creating it first if there is
+* none, in which case the new page is journaled as an @addPages record before it is made. Adds a
+* failure to journal it to '*errors'. Returns NULL if out of memory.
+*/
+static struct page * importPage(struct token name, int *errors) {
+
+	struct page *node = findNode(name);
+
+	if (node != NULL) {
+		return node;
+	}
+
+	struct token words[2] = { { "@addPages", 9 }, name };
+	*errors += journalAppend(words, 2);
+	return findOrAddPage(name);
+}
+
+
+
+/*
+* journalEdges(edges, count) -- journals the 'count' edges collected by importEdges() as @addLinks
+* records, one for each run of edges from the same source page, so recovery replays the links that
+* were added instead of reading an edge list that may have changed since. Returns the number of
+* errors.
+*/
+static int journalEdges(const struct link *edges, size_t count) {
+
+	struct token *words = NULL;
+	size_t wordCap = 0;
+	int errors = 0;
+
+	for (size_t first = 0, last; first < count; first = last) {
+
+		struct page *src = (struct page *) edges[first].next;
+
+		for (last = first + 1; last < count && (struct page *) edges[last].next == src; last++) {
+		}
+
+		if (growArray((void **) &words, &wordCap, sizeof(struct token), last - first + 2) != 0) {
+			errors++;
+			break;
+		}
+
+		words[0].ptr = "@addLinks";
+		words[0].len = 9;
+		words[1] = pageToken(src);
+		for (size_t i = first; i < last; i++) {
+			words[i - first + 2] = pageToken(edges[i].to);
+		}
+		errors += journalAppend(words, last - first + 2);
+	}
+
+	free(words);
+	return errors;
+}
+
+
+
+/*
+* importEdges(path) -- reads the edge list at 'path' and adds its links to the graph in one
+* batch. Blank lines and lines starting with '#' or '%' are skipped, and the separator is
+* detected from the first remaining line. Every endpoint is looked up once and created if it
+* is not a page yet, and the collected edges are spliced onto their source pages together, in
+* file order, by spliceLinks(). Pages and links are journaled as @addPages and
+* @addLinks records before they are added. A line without two fields is reported and skipped.
+* Returns the number of errors.
+*/
+int importEdges(const char *path) {
+
+	struct lineReader reader;
+
+	if (readerOpen(&reader, path) != 0) {
+		fprintf(stderr, "Couldn't open the edge list.\n");
+		return 1;
+	}
+
+	int errors = 0;
+	enum edgeFormat format = EDGES_UNKNOWN;
+	struct link *edges = NULL;
+	size_t edgeCap = 0;
+	size_t edgeCount = 0;
+	long lineNumber = 0;
+	const char *line;
+	size_t len;
+	int status;
+
+	while ((status = readerNext(&reader, &line, &len)) > 0) {
+
+		lineNumber++;
+		struct token whole = trimField(line, len);
+
+		if (whole.len == 0 || whole.ptr[0] == '#' || whole.ptr[0] == '%') {
+			continue;
+		}
+
+		if (format == EDGES_UNKNOWN) {
+			format = detectFormat(line, len);
+		}
+
+		struct token fields[2];
+
+		if (!splitEdge(line, len, format, fields)) {
+			fprintf(stderr, "Invalid edge on line %ld of the edge list.\n", lineNumber);
+			errors++;
+			continue;
+		}
+
+		if (growArray((void **) &edges, &edgeCap, sizeof(struct link), edgeCount + 1) != 0) {
+			errors++;
+			break;
+		}
+
+		// `next` temporarily holds the source page, as spliceLinks() expects.
+		struct page *src = importPage(fields[0], &errors);
+		struct page *to = importPage(fields[1], &errors);
+
+		if (src == NULL || to == NULL) {
+			fprintf(stderr, "Ran Out Of Memory.\n");
+			errors++;
+			break;
+		}
+
+		edges[edgeCount].next = (struct link *) src;
+		edges[edgeCount++].to = to;
+	}
+
+	if (status < 0) {
+		fprintf(stderr, "Couldn't read the edge list.\n");
+		errors++;
+	}
+
+	errors += journalEdges(edges, edgeCount);
+	errors += spliceLinks(edges, edgeCount);
+
+	free(edges);
+	errors += readerClose(&reader);
+	return errors;
+}
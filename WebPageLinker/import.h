@@ -0,0 +1,19 @@
+#ifndef IMPORT_H
+#define IMPORT_H
+
+
+/*
+ * File: import.h
+ * Author: Chance Krueger
+ * Purpose: Bulk import of plain edge lists. --import-edges and @loadEdges read
+ *          a file with one "source destination" pair per line, separated by a
+ *          tab (TSV), a comma (CSV) or runs of whitespace (the SNAP format),
+ *          create any page named by an edge that does not exist yet and add all
+ *          the links in one batch instead of one @addLinks command at a time.
+ */
+
+
+
+int importEdges(const char *path);
+
+#endif
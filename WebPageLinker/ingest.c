@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "WebPageLinker.h"
+#include "ingest.h"
+
+
+/*
+ * File: ingest.c
+ * Author: Chance Krueger
+ * Purpose: Implements the sharded link ingestion described in ingest.h.
+ */
+
+
+
+#define MAX_INGEST_THREADS 64
+#define INGEST_PER_THREAD 16384
+
+
+
+/*
+ * ingestWorker -- One thread of a batch, owning one shard. It resolves the links
+ * `begin` to `end` of the batch into `buckets`, one per shard, remembering the ones
+ * that didn't resolve in `failed`. Then it gathers its shard from every worker's
+ * bucket into `shard` (each entry holding its source page in `next`, as for
+ * spliceLinks()), `edgeCount` of them in batch order, and splices those onto their
+ * pages from `links`, `added` links in all.
+ */
+struct ingestWorker {
+
+
+	pthread_t thread;
+	struct ingestBatch *batch;
+	size_t index;
+	size_t begin;
+	size_t end;
+	struct link **buckets;
+	size_t *bucketLen;
+	size_t *bucketCap;
+	size_t *failed;
+	size_t failedCount;
+	size_t failedCap;
+	struct link *shard;
+	size_t edgeCount;
+	struct link *links;
+	long added;
+};
+
+
+
+/*
+ * ingestBatch -- What the workers of one ingestLinks() call share. `outOfMemory` is
+ * set by any worker that runs out, and every later phase is skipped.
+ */
+struct ingestBatch {
+
+
+	struct ingestWorker *workers;
+	size_t workerCount;
+	int (*resolve)(void *arg, size_t i, struct page **src, struct page **to);
+	void *arg;
+	atomic_int outOfMemory;
+};
+
+
+
+/*
+* shardOf(batch, src) -- returns the shard the links of source page 'src' go to.
+*/
+static size_t shardOf(const struct ingestBatch *batch, const struct page *src) {
+
+	uint64_t key = (uintptr_t) src / sizeof(struct page);
+
+	return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) % batch->workerCount;
+}
+
+
+
+/*
+* sortBySource(edges, scratch, count) -- sorts 'count' resolved edges by source page with a merge
+* sort, using 'scratch' for as many. It is stable, so each source's edges keep the order they
+* came in, which is the order one thread would have appended them in.
+*/
+static void sortBySource(struct link *edges, struct link *scratch, size_t count) {
+
+	if (count < 2) {
+		return;
+	}
+
+	size_t half = count / 2;
+
+	sortBySource(edges, scratch, half);
+	sortBySource(edges + half, scratch, count - half);
+
+	// ALREADY IN ORDER ACROSS THE HALVES, AS IT IS FOR A SOURCE WHOSE LINKS CAME IN TOGETHER
+	if ((char *) edges[half - 1].next <= (char *) edges[half].next) {
+		return;
+	}
+
+	memcpy(scratch, edges, half * sizeof(struct link));
+
+	size_t left = 0;
+	size_t right = half;
+	size_t out = 0;
+
+	// TIES TAKE FROM THE LEFT HALF, WHICH CAME IN FIRST
+	while (left < half && right < count) {
+		if ((char *) edges[right].next < (char *) scratch[left].next) {
+			edges[out++] = edges[right++];
+		} else {
+			edges[out++] = scratch[left++];
+		}
+	}
+	memcpy(edges + out, scratch + left, (half - left) * sizeof(struct link));
+}
+
+
+
+/*
+* resolveLinks(arg) -- first phase: resolves the worker's range of the batch into per-shard buckets.
+*/
+static void * resolveLinks(void *arg) {
+
+	struct ingestWorker *worker = arg;
+	struct ingestBatch *batch = worker->batch;
+	struct page *src;
+	struct page *to;
+
+	for (size_t i = worker->begin; i < worker->end && !atomic_load(&batch->outOfMemory); i++) {
+
+		if (batch->resolve(batch->arg, i, &src, &to) != 0) {
+			if (growArray((void **) &worker->failed, &worker->failedCap, sizeof(size_t), worker->failedCount + 1) != 0) {
+				atomic_store(&batch->outOfMemory, 1);
+				break;
+			}
+			worker->failed[worker->failedCount++] = i;
+			continue;
+		}
+
+		size_t shard = shardOf(batch, src);
+
+		if (growArray((void **) &worker->buckets[shard], &worker->bucketCap[shard], sizeof(struct link),
+			      worker->bucketLen[shard] + 1) != 0) {
+			atomic_store(&batch->outOfMemory, 1);
+			break;
+		}
+		struct link *edge = &worker->buckets[shard][worker->bucketLen[shard]++];
+		edge->next = (struct link *) src;
+		edge->to = to;
+	}
+	return NULL;
+}
+
+
+
+/*
+* gatherShard(arg) -- second phase: collects the worker's shard from every bucket, then sorts it by
+* source page. Workers resolved contiguous ranges of the batch in order, so gathering their
+* buckets in worker order keeps the shard in batch order before the stable sort.
+*/
+static void * gatherShard(void *arg) {
+
+	struct ingestWorker *worker = arg;
+	struct ingestBatch *batch = worker->batch;
+	size_t count = 0;
+
+	for (size_t w = 0; w < batch->workerCount; w++) {
+		count += batch->workers[w].bucketLen[worker->index];
+	}
+
+	worker->shard = malloc((count + 1) * sizeof(struct link));
+	struct link *scratch = malloc((count / 2 + 1) * sizeof(struct link));
+	if (worker->shard == NULL || scratch == NULL) {
+		free(scratch);
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		atomic_store(&batch->outOfMemory, 1);
+		return NULL;
+	}
+
+	count = 0;
+	for (size_t w = 0; w < batch->workerCount; w++) {
+		struct ingestWorker *from = &batch->workers[w];
+		if (from->bucketLen[worker->index] == 0) {
+			continue;
+		}
+		memcpy(worker->shard + count, from->buckets[worker->index], from->bucketLen[worker->index] * sizeof(struct link));
+		count += from->bucketLen[worker->index];
+	}
+
+	sortBySource(worker->shard, scratch, count);
+	free(scratch);
+	worker->edgeCount = count;
+	return NULL;
+}
+
+
+
+/*
+* spliceShard(arg) -- third phase: builds the worker's links and splices each source page's run
+* onto the end of its list with a single walk. Only this worker adds links to those pages; the
+* pages they point to can belong to any shard, so their in-counts are bumped atomically.
+*/
+static void * spliceShard(void *arg) {
+
+	struct ingestWorker *worker = arg;
+	struct link *edges = worker->shard;
+	struct link *links = worker->links;
+	size_t count = worker->edgeCount;
+	size_t start = 0;
+
+	while (start < count) {
+		struct page *src = (struct page *) edges[start].next;
+		size_t end = start;
+
+		while (end < count && (struct page *) edges[end].next == src) {
+			links[end].to = edges[end].to;
+			links[end].next = end + 1 < count && (struct page *) edges[end + 1].next == src ? &links[end + 1] : NULL;
+			__atomic_fetch_add(&edges[end].to->inCount, 1, __ATOMIC_RELAXED);
+			end++;
+		}
+
+		struct link **tail = &src->edges;
+		while (*tail != NULL) {
+			tail = &(*tail)->next;
+		}
+		*tail = &links[start];
+
+		src->outCount += end - start;
+		worker->added += end - start;
+		start = end;
+	}
+	return NULL;
+}
+
+
+
+/*
+* runPhase(batch, phase) -- runs 'phase' for every worker of 'batch', on threads of their own when
+* there is more than one. A worker whose thread can't be started runs here instead.
+*/
+static void runPhase(struct ingestBatch *batch, void * (*phase)(void *)) {
+
+	int *started = calloc(batch->workerCount, sizeof(int));
+
+	for (size_t w = 1; started != NULL && w < batch->workerCount; w++) {
+		started[w] = pthread_create(&batch->workers[w].thread, NULL, phase, &batch->workers[w]) == 0;
+	}
+
+	for (size_t w = 0; w < batch->workerCount; w++) {
+		if (started == NULL || !started[w]) {
+			phase(&batch->workers[w]);
+		}
+	}
+
+	for (size_t w = 1; started != NULL && w < batch->workerCount; w++) {
+		if (started[w]) {
+			pthread_join(batch->workers[w].thread, NULL);
+		}
+	}
+	free(started);
+}
+
+
+
+/*
+* allocWorkers(batch, count) -- sets up a worker per shard for a batch of 'count' links, splitting
+* them into even ranges. Returns 0 on success, 1 if out of memory.
+*/
+static int allocWorkers(struct ingestBatch *batch, size_t count) {
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = count / INGEST_PER_THREAD;
+
+	threads = threads > (size_t) cpus ? (size_t) cpus : threads;
+	threads = threads > MAX_INGEST_THREADS ? MAX_INGEST_THREADS : threads;
+	threads = threads < 1 ? 1 : threads;
+
+	batch->workers = calloc(threads, sizeof(struct ingestWorker));
+	if (batch->workers == NULL) {
+		return 1;
+	}
+	batch->workerCount = threads;
+
+	for (size_t w = 0; w < threads; w++) {
+
+		struct ingestWorker *worker = &batch->workers[w];
+
+		worker->batch = batch;
+		worker->index = w;
+		worker->begin = count / threads * w;
+		worker->end = w + 1 == threads ? count : count / threads * (w + 1);
+		worker->buckets = calloc(threads, sizeof(struct link *));
+		worker->bucketLen = calloc(threads, sizeof(size_t));
+		worker->bucketCap = calloc(threads, sizeof(size_t));
+
+		if (worker->buckets == NULL || worker->bucketLen == NULL || worker->bucketCap == NULL) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+
+/*
+* freeWorkers(batch) -- frees the workers of 'batch' and everything they collected.
+*/
+static void freeWorkers(struct ingestBatch *batch) {
+
+	for (size_t w = 0; batch->workers != NULL && w < batch->workerCount; w++) {
+
+		struct ingestWorker *worker = &batch->workers[w];
+
+		for (size_t s = 0; worker->buckets != NULL && s < batch->workerCount; s++) {
+			free(worker->buckets[s]);
+		}
+		free(worker->buckets);
+		free(worker->bucketLen);
+		free(worker->bucketCap);
+		free(worker->failed);
+		free(worker->shard);
+	}
+	free(batch->workers);
+}
+
+
+
+/*
+* ingestLinks(count, resolve, arg, failed, failedCount) -- adds a batch of 'count' links to the
+* graph. resolve(arg, i, &src, &to) is called once for each i below 'count', from any thread, and
+* sets the source and destination pages of link i, or returns nonzero if it doesn't resolve; it
+* must only read the graph. Every link is added, duplicates included, and each source page's new
+* links are appended to its list in batch order, just as addLinkToPage() would. When 'failed' is not NULL
+* it is pointed at an ascending, heap allocated list of the '*failedCount' links that didn't
+* resolve. Returns 0 on success, 1 if out of memory.
+*/
+int ingestLinks(size_t count, int (*resolve)(void *arg, size_t i, struct page **src, struct page **to),
+		void *arg, size_t **failed, size_t *failedCount) {
+
+	struct ingestBatch batch;
+	int status = 0;
+
+	memset(&batch, 0, sizeof(batch));
+	batch.resolve = resolve;
+	batch.arg = arg;
+	atomic_init(&batch.outOfMemory, 0);
+
+	if (failed != NULL) {
+		*failed = NULL;
+		*failedCount = 0;
+	}
+
+	if (allocWorkers(&batch, count) != 0) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		freeWorkers(&batch);
+		return 1;
+	}
+
+	runPhase(&batch, resolveLinks);
+
+	// Workers resolved contiguous ranges in order, so their failures concatenate in order.
+	size_t failures = 0;
+	for (size_t w = 0; w < batch.workerCount; w++) {
+		failures += batch.workers[w].failedCount;
+	}
+
+	if (failed != NULL && failures > 0 && !atomic_load(&batch.outOfMemory)) {
+		*failed = malloc(failures * sizeof(size_t));
+		if (*failed == NULL) {
+			atomic_store(&batch.outOfMemory, 1);
+		}
+		for (size_t w = 0; *failed != NULL && w < batch.workerCount; w++) {
+			memcpy(*failed + *failedCount, batch.workers[w].failed, batch.workers[w].failedCount * sizeof(size_t));
+			*failedCount += batch.workers[w].failedCount;
+		}
+	}
+
+	if (!atomic_load(&batch.outOfMemory)) {
+		runPhase(&batch, gatherShard);
+	}
+
+	// One allocation holds every new link; each shard splices from its own slice of it.
+	size_t total = 0;
+	for (size_t w = 0; w < batch.workerCount; w++) {
+		total += batch.workers[w].edgeCount;
+	}
+
+	struct link *links = !atomic_load(&batch.outOfMemory) && total > 0 ? poolAllocArray(&linkPool, total) : NULL;
+
+	if (atomic_load(&batch.outOfMemory) || (total > 0 && links == NULL)) {
+		status = 1;
+	} else if (total > 0) {
+		for (size_t w = 0, offset = 0; w < batch.workerCount; w++) {
+			batch.workers[w].links = links + offset;
+			offset += batch.workers[w].edgeCount;
+		}
+
+		runPhase(&batch, spliceShard);
+
+		for (size_t w = 0; w < batch.workerCount; w++) {
+			linkCount += batch.workers[w].added;
+		}
+	}
+
+	freeWorkers(&batch);
+	return status;
+}
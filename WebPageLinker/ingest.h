@@ -0,0 +1,25 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stddef.h>
+
+#include "WebPageLinker.h"
+
+
+/*
+ * File: ingest.h
+ * Author: Chance Krueger
+ * Purpose: Sharded link ingestion. A batch of links is resolved to pages on every
+ *          core at once, and each link is handed to the shard its source page
+ *          hashes to. Every shard is then sorted stably by source page and
+ *          spliced onto its own source pages by one thread, so threads add links
+ *          to different pages side by side without sharing a link list or taking
+ *          a lock, and the result is the same as adding the batch on one thread.
+ */
+
+
+
+int ingestLinks(size_t count, int (*resolve)(void *arg, size_t i, struct page **src, struct page **to),
+		void *arg, size_t **failed, size_t *failedCount);
+
+#endif
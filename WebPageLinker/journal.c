@@ -0,0 +1,684 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "WebPageLinker.h"
+#include "snapshot.h"
+#include "journal.h"
+#include "binproto.h"
+#include "varint.h"
+
+
+/*
+ * File: journal.c
+ * Author: Chance Krueger
+ * Purpose: Implements the write-ahead journal described in journal.h. A journal starts
+ *          with the magic JOURNAL_MAGIC and is then a run of records:
+ *
+ *            u32 length    little endian byte count of the body
+ *            u32 check     low 32 bits of the checksum64() of the body
+ *            u8 opcode     an enum commandTag value, or JOURNAL_BASE
+ *            varint count  how many names follow
+ *            count names   each a varint length and that many bytes
+ *
+ *          The first record is JOURNAL_BASE. It names the snapshot the journal goes on
+ *          top of by the 16 hex digits of its snapshotId() and its path, or has no names
+ *          for an empty graph. Every other record is a command, or JOURNAL_SAVING: @save
+ *          writes one naming the snapshot path before it writes the snapshot, and one with
+ *          no names if that fails. A last record cut short or failing its check was torn
+ *          by a crash and is dropped.
+ */
+
+
+
+#define JOURNAL_MAGIC "WPLJRNL1"
+#define JOURNAL_MAGIC_LEN 8
+#define JOURNAL_BASE 0x40
+#define JOURNAL_SAVING 0x41
+#define RECORD_HEADER 8
+#define MAX_HEADER (JOURNAL_MAGIC_LEN + RECORD_HEADER + 64 + 4096)
+
+
+
+long journalGroupRecords = JOURNAL_GROUP_RECORDS;
+long journalGroupMs = JOURNAL_GROUP_MS;
+
+
+
+/*
+ * journalBuffer -- Records waiting to be written.
+ */
+struct journalBuffer {
+
+
+	char *data;
+	size_t len;
+	size_t cap;
+};
+
+
+
+/*
+ * The open journal. The executor appends to `active` under `bufLock`; a commit swaps it
+ * with `spare` and writes and syncs that while appends go on. `commitLock` keeps commits
+ * in order, and the flusher thread commits a group journalGroupMs after its first record.
+ */
+static int journalFd = -1;
+static char *journalPath = NULL;
+static struct journalBuffer active;
+static struct journalBuffer spare;
+static size_t pendingRecords = 0;
+static struct timespec firstPending;
+static int flusherStop = 0;
+static pthread_t flusher;
+static pthread_mutex_t bufLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t commitLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flusherWake = PTHREAD_COND_INITIALIZER;
+
+
+
+/*
+* appendRecord(buf, opcode, names, count) -- adds a record of 'opcode' carrying the 'count' names
+* at 'names' to the end of 'buf'. Returns 0 on success, 1 if out of memory.
+*/
+static int appendRecord(struct journalBuffer *buf, int opcode, const struct token *names, size_t count) {
+
+	size_t need = RECORD_HEADER + 1 + 10;
+	for (size_t i = 0; i < count; i++) {
+		need += 10 + names[i].len;
+	}
+
+	if (growArray((void **) &buf->data, &buf->cap, 1, buf->len + need) != 0) {
+		return 1;
+	}
+
+	uint8_t *record = (uint8_t *) buf->data + buf->len;
+	uint8_t *out = record + RECORD_HEADER;
+
+	*out++ = opcode;
+	out += putVarint(out, count);
+	for (size_t i = 0; i < count; i++) {
+		out += putVarint(out, names[i].len);
+		memcpy(out, names[i].ptr, names[i].len);
+		out += names[i].len;
+	}
+
+	uint32_t len = out - record - RECORD_HEADER;
+	uint32_t check = checksum64(record + RECORD_HEADER, len);
+
+	for (int i = 0; i < 4; i++) {
+		record[i] = len >> (8 * i);
+		record[4 + i] = check >> (8 * i);
+	}
+	buf->len += out - record;
+	return 0;
+}
+
+
+
+/*
+* readRecord(pos, end, opcode, names, count, cap) -- decodes the record at 'pos', storing its opcode
+* in '*opcode' and views of its names in the growable array '*names' of '*cap' entries, '*count' of
+* them, with room left for one more. Returns the record's whole length, or 0 if it runs past 'end', fails its check or can't be
+* decoded (or is out of memory).
+*/
+static size_t readRecord(const uint8_t *pos, const uint8_t *end, int *opcode, struct token **names,
+			 size_t *count, size_t *cap) {
+
+	if (end - pos < RECORD_HEADER) {
+		return 0;
+	}
+
+	uint32_t len = pos[0] | pos[1] << 8 | pos[2] << 16 | (uint32_t) pos[3] << 24;
+	uint32_t check = pos[4] | pos[5] << 8 | pos[6] << 16 | (uint32_t) pos[7] << 24;
+	const uint8_t *body = pos + RECORD_HEADER;
+
+	if (len == 0 || (size_t) (end - body) < len || (uint32_t) checksum64(body, len) != check) {
+		return 0;
+	}
+
+	const uint8_t *bodyEnd = body + len;
+	const uint8_t *p = body + 1;
+	uint64_t words;
+
+	*opcode = body[0];
+	if (readVarint(&p, bodyEnd, &words) != 0 || words > len ||
+	    growArray((void **) names, cap, sizeof(struct token), words + 1) != 0) {
+		return 0;
+	}
+
+	for (uint64_t i = 0; i < words; i++) {
+		uint64_t nameLen;
+		if (readVarint(&p, bodyEnd, &nameLen) != 0 || nameLen > (uint64_t) (bodyEnd - p)) {
+			return 0;
+		}
+		(*names)[i].ptr = (const char *) p;
+		(*names)[i].len = nameLen;
+		p += nameLen;
+	}
+
+	*count = words;
+	return p == bodyEnd ? RECORD_HEADER + len : 0;
+}
+
+
+
+/*
+* readHeader(path, header, cap) -- reads the magic and base record of the journal at 'path' into
+* 'header', which has room for 'cap' bytes. Returns their length, or 0 if there is no journal or
+* it doesn't start with them.
+*/
+static size_t readHeader(const char *path, char *header, size_t cap) {
+
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return 0;
+	}
+
+	ssize_t got = read(fd, header, cap);
+	close(fd);
+
+	struct token *names = NULL;
+	size_t count;
+	size_t nameCap = 0;
+	int opcode;
+	size_t len = 0;
+
+	if (got > JOURNAL_MAGIC_LEN && memcmp(header, JOURNAL_MAGIC, JOURNAL_MAGIC_LEN) == 0) {
+		len = readRecord((const uint8_t *) header + JOURNAL_MAGIC_LEN, (const uint8_t *) header + got,
+				 &opcode, &names, &count, &nameCap);
+	}
+	free(names);
+
+	return len > 0 && opcode == JOURNAL_BASE && (count == 0 || count == 2) ? JOURNAL_MAGIC_LEN + len : 0;
+}
+
+
+
+/*
+* makeHeader(basePath, header) -- writes the magic and base record of a journal on top of the
+* snapshot at 'basePath' (or of an empty graph if it is NULL) into the empty buffer 'header'.
+* Returns 0 on success, 1 if the snapshot can't be read or out of memory.
+*/
+static int makeHeader(const char *basePath, struct journalBuffer *header) {
+
+	struct token magic = { JOURNAL_MAGIC, JOURNAL_MAGIC_LEN };
+	char id[17];
+	uint64_t snapshot;
+
+	if (growArray((void **) &header->data, &header->cap, 1, JOURNAL_MAGIC_LEN) != 0) {
+		return 1;
+	}
+	memcpy(header->data, magic.ptr, magic.len);
+	header->len = magic.len;
+
+	if (basePath == NULL) {
+		return appendRecord(header, JOURNAL_BASE, NULL, 0);
+	}
+	if (snapshotId(basePath, &snapshot) != 0) {
+		return 1;
+	}
+
+	snprintf(id, sizeof(id), "%016" PRIx64, snapshot);
+	struct token names[2] = { { id, 16 }, { basePath, strlen(basePath) } };
+	return appendRecord(header, JOURNAL_BASE, names, 2);
+}
+
+
+
+/*
+* journalBase(path) -- returns a copy of the snapshot path named by the journal at 'path', or NULL
+* if there is no journal or it starts from an empty graph.
+*/
+char * journalBase(const char *path) {
+
+	char header[MAX_HEADER];
+	size_t len = readHeader(path, header, sizeof(header));
+	struct token *names = NULL;
+	size_t count = 0;
+	size_t cap = 0;
+	int opcode;
+	char *base = NULL;
+
+	if (len > 0 && readRecord((const uint8_t *) header + JOURNAL_MAGIC_LEN, (const uint8_t *) header + len,
+				  &opcode, &names, &count, &cap) > 0 && count == 2) {
+		base = internName(names[1]);
+	}
+	free(names);
+	return base;
+}
+
+
+
+/*
+* freshJournal(path, basePath) -- replaces the journal at 'path' with an empty one on top of
+* 'basePath', written to a temporary file, synced and renamed into place. Returns an open
+* descriptor for appending, or -1 on error.
+*/
+static int freshJournal(const char *path, const char *basePath) {
+
+	struct journalBuffer header = { NULL, 0, 0 };
+	size_t pathLen = strlen(path);
+	char *tmpPath = malloc(pathLen + 5);
+
+	if (tmpPath == NULL || makeHeader(basePath, &header) != 0) {
+		free(tmpPath);
+		free(header.data);
+		return -1;
+	}
+	memcpy(tmpPath, path, pathLen);
+	memcpy(tmpPath + pathLen, ".tmp", 5);
+
+	int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	int failed = fd < 0 || writeAll(fd, header.data, header.len) != 0 || fsync(fd) != 0;
+
+	if (fd >= 0) {
+		close(fd);
+	}
+	failed = failed || rename(tmpPath, path) != 0;
+	free(tmpPath);
+	free(header.data);
+
+	return failed ? -1 : open(path, O_WRONLY | O_APPEND);
+}
+
+
+
+/*
+* mapJournal(path, size) -- maps the whole journal at 'path' for reading and stores its size in
+* '*size'. Returns the mapping, or NULL if it is empty or can't be read.
+*/
+static const uint8_t * mapJournal(const char *path, size_t *size) {
+
+	struct stat info;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0 || fstat(fd, &info) != 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return NULL;
+	}
+
+	const uint8_t *map = info.st_size > 0 ? mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	close(fd);
+
+	if (map == MAP_FAILED || map == NULL) {
+		return NULL;
+	}
+	madvise((void *) map, info.st_size, MADV_SEQUENTIAL);
+	*size = info.st_size;
+	return map;
+}
+
+
+
+/*
+* replay(path, skip) -- runs the command records of the journal at 'path' after its first 'skip'
+* bytes (the header), stopping at a torn last record, with error messages silenced: they were
+* reported when the commands first ran. Returns the length of the journal up to its last complete
+* record, or -1 on error.
+*/
+static off_t replay(const char *path, size_t skip) {
+
+	size_t size;
+	const uint8_t *map = mapJournal(path, &size);
+
+	if (map == NULL) {
+		return -1;
+	}
+
+	fflush(stderr);
+	int savedErr = dup(STDERR_FILENO);
+	int devNull = open("/dev/null", O_WRONLY);
+	if (devNull >= 0) {
+		dup2(devNull, STDERR_FILENO);
+		close(devNull);
+	}
+
+	struct token *names = NULL;
+	size_t nameCap = 0;
+	size_t count;
+	int opcode;
+	const uint8_t *end = map + size;
+	off_t complete = skip;
+	size_t len;
+
+	// A DECODED RECORD GOES THROUGH runCommand() LIKE A TEXT LINE, WITH ITS ACTION WORD IN FRONT
+	while ((len = readRecord(map + complete, end, &opcode, &names, &count, &nameCap)) > 0) {
+
+		complete += len;
+		memmove(names + 1, names, count * sizeof(struct token));
+		names[0] = binActionWord(opcode);
+		if (names[0].len > 0) {
+			runCommand(names, count + 1, 0);
+		}
+	}
+
+	free(names);
+	munmap((void *) map, size);
+
+	fflush(stderr);
+	if (savedErr >= 0) {
+		dup2(savedErr, STDERR_FILENO);
+		close(savedErr);
+	}
+	return complete;
+}
+
+
+
+/*
+* savedTo(path, skip, snapshotPath) -- returns 1 if the last complete record of the journal at
+* 'path', after its first 'skip' bytes, says the graph was being saved to 'snapshotPath': a crash
+* then came after the snapshot was written but before its fresh journal was, so the journal is
+* already part of the snapshot. Returns 0 otherwise.
+*/
+static int savedTo(const char *path, size_t skip, const char *snapshotPath) {
+
+	size_t size;
+	const uint8_t *map = mapJournal(path, &size);
+
+	if (map == NULL || snapshotPath == NULL) {
+		if (map != NULL) {
+			munmap((void *) map, size);
+		}
+		return 0;
+	}
+
+	struct token *names = NULL;
+	size_t nameCap = 0;
+	size_t count = 0;
+	int opcode;
+	const uint8_t *pos = map + skip;
+	size_t len;
+	int saved = 0;
+
+	while ((len = readRecord(pos, map + size, &opcode, &names, &count, &nameCap)) > 0) {
+		saved = opcode == JOURNAL_SAVING && count == 1 && names[0].len == strlen(snapshotPath) &&
+			memcmp(names[0].ptr, snapshotPath, names[0].len) == 0;
+		pos += len;
+	}
+
+	free(names);
+	munmap((void *) map, size);
+	return saved;
+}
+
+
+
+/*
+* commit() -- writes the records appended so far to the journal and syncs it. Appends can go on
+* into the other buffer meanwhile. Returns 0 on success, 1 on a write error.
+*/
+static int commit() {
+
+	int failed = 0;
+
+	pthread_mutex_lock(&commitLock);
+	pthread_mutex_lock(&bufLock);
+
+	struct journalBuffer full = active;
+	active = spare;
+	spare = full;
+	pendingRecords = 0;
+
+	pthread_mutex_unlock(&bufLock);
+
+	if (spare.len > 0) {
+		failed = writeAll(journalFd, spare.data, spare.len) != 0 || fdatasync(journalFd) != 0;
+		spare.len = 0;
+	}
+
+	pthread_mutex_unlock(&commitLock);
+	return failed;
+}
+
+
+
+/*
+* flusherMain(arg) -- commits each group of records journalGroupMs after its first one arrived,
+* so a quiet input never leaves records unsynced for long.
+*/
+static void * flusherMain(void *arg) {
+
+	pthread_mutex_lock(&bufLock);
+
+	while (!flusherStop) {
+
+		if (pendingRecords == 0) {
+			pthread_cond_wait(&flusherWake, &bufLock);
+			continue;
+		}
+
+		struct timespec now;
+		struct timespec deadline = firstPending;
+		deadline.tv_sec += journalGroupMs / 1000;
+		deadline.tv_nsec += journalGroupMs % 1000 * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) {
+			pthread_mutex_unlock(&bufLock);
+			if (commit() != 0) {
+				fprintf(stderr, "Couldn't write the journal.\n");
+			}
+			pthread_mutex_lock(&bufLock);
+		} else {
+			pthread_cond_timedwait(&flusherWake, &bufLock, &deadline);
+		}
+	}
+
+	pthread_mutex_unlock(&bufLock);
+	return NULL;
+}
+
+
+
+/*
+* journalOpen(path, basePath) -- opens the journal at 'path' for a graph that was just loaded from
+* the snapshot at 'basePath' (NULL for an empty graph). If the journal goes on top of that same
+* snapshot, its commands are replayed first and new ones are appended after them. A fresh journal
+* is only started when there is none yet, or when the old one ends by saving the graph to
+* 'basePath' and a crash came before its fresh journal was started. A journal on top of anything
+* else would lose its commands, so it is an error. Returns 0 on success, 1 on error.
+*/
+int journalOpen(const char *path, const char *basePath) {
+
+	struct journalBuffer want = { NULL, 0, 0 };
+	char have[MAX_HEADER];
+	struct stat info;
+
+	if (makeHeader(basePath, &want) != 0) {
+		free(want.data);
+		fprintf(stderr, "Couldn't open the journal.\n");
+		return 1;
+	}
+
+	int exists = stat(path, &info) == 0 && info.st_size > 0;
+	size_t haveLen = exists ? readHeader(path, have, sizeof(have)) : 0;
+	int same = haveLen == want.len && memcmp(have, want.data, want.len) == 0;
+	free(want.data);
+
+	if (exists && haveLen == 0) {
+		fprintf(stderr, "%s isn't a journal.\n", path);
+		return 1;
+	}
+
+	if (exists && !same && !savedTo(path, haveLen, basePath)) {
+		char *expected = journalBase(path);
+		if (expected == NULL) {
+			fprintf(stderr, "The journal %s goes on top of an empty graph, not %s.\n", path,
+				basePath != NULL ? basePath : "a snapshot");
+		} else if (basePath != NULL && strcmp(expected, basePath) == 0) {
+			fprintf(stderr, "The journal %s goes on top of an earlier version of %s.\n", path, expected);
+		} else {
+			fprintf(stderr, "The journal %s goes on top of %s, not %s.\n", path, expected,
+				basePath != NULL ? basePath : "an empty graph");
+		}
+		free(expected);
+		return 1;
+	}
+
+	off_t complete = same ? replay(path, haveLen) : -1;
+
+	if (complete >= 0) {
+		journalFd = open(path, O_WRONLY | O_APPEND);
+		if (journalFd >= 0 && ftruncate(journalFd, complete) != 0) {
+			close(journalFd);
+			journalFd = -1;
+		}
+	} else if (!same) {
+		journalFd = freshJournal(path, basePath);
+	}
+
+	journalPath = strdup(path);
+	flusherStop = 0;
+
+	if (journalFd < 0 || journalPath == NULL || pthread_create(&flusher, NULL, flusherMain, NULL) != 0) {
+		if (journalFd >= 0) {
+			close(journalFd);
+		}
+		journalFd = -1;
+		free(journalPath);
+		journalPath = NULL;
+		fprintf(stderr, "Couldn't open the journal.\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* journalAppend(words, count) -- adds the command made of 'words' to the journal as a record,
+* committing the group once journalGroupRecords records are waiting. Does nothing without a
+* journal. Returns 0 on success, 1 on error.
+*/
+int journalAppend(const struct token *words, size_t count) {
+
+	if (journalFd < 0) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&bufLock);
+
+	if (appendRecord(&active, commandTag(words[0]), words + 1, count - 1) != 0) {
+		pthread_mutex_unlock(&bufLock);
+		return 1;
+	}
+
+	if (pendingRecords++ == 0) {
+		clock_gettime(CLOCK_REALTIME, &firstPending);
+		pthread_cond_signal(&flusherWake);
+	}
+	int full = pendingRecords >= (size_t) journalGroupRecords;
+
+	pthread_mutex_unlock(&bufLock);
+
+	if (full && commit() != 0) {
+		fprintf(stderr, "Couldn't write the journal.\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* journalSaving(snapshotPath) -- records, and syncs, that the graph is about to be saved to
+* 'snapshotPath', or with NULL that saving it failed. Does nothing without a journal. Returns 0 on
+* success, 1 on error.
+*/
+int journalSaving(const char *snapshotPath) {
+
+	if (journalFd < 0) {
+		return 0;
+	}
+
+	struct token name = { snapshotPath, snapshotPath != NULL ? strlen(snapshotPath) : 0 };
+
+	pthread_mutex_lock(&bufLock);
+	int failed = appendRecord(&active, JOURNAL_SAVING, &name, snapshotPath != NULL);
+	pthread_mutex_unlock(&bufLock);
+
+	if (failed || commit() != 0) {
+		fprintf(stderr, "Couldn't write the journal.\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* journalCheckpoint(snapshotPath) -- starts a fresh journal on top of the snapshot just written to
+* 'snapshotPath', after syncing what the old one still had waiting. Does nothing without a journal.
+* Returns 0 on success, 1 on error.
+*/
+int journalCheckpoint(const char *snapshotPath) {
+
+	if (journalFd < 0) {
+		return 0;
+	}
+
+	int failed = commit();
+
+	pthread_mutex_lock(&commitLock);
+	int fd = failed ? -1 : freshJournal(journalPath, snapshotPath);
+	if (fd >= 0) {
+		close(journalFd);
+		journalFd = fd;
+	}
+	pthread_mutex_unlock(&commitLock);
+
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't write the journal.\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* journalClose() -- syncs whatever is still waiting, stops the flusher and closes the journal.
+*/
+void journalClose() {
+
+	if (journalFd < 0) {
+		return;
+	}
+
+	if (commit() != 0) {
+		fprintf(stderr, "Couldn't write the journal.\n");
+	}
+
+	pthread_mutex_lock(&bufLock);
+	flusherStop = 1;
+	pthread_cond_signal(&flusherWake);
+	pthread_mutex_unlock(&bufLock);
+	pthread_join(flusher, NULL);
+
+	close(journalFd);
+	journalFd = -1;
+	free(journalPath);
+	free(active.data);
+	free(spare.data);
+	journalPath = NULL;
+	memset(&active, 0, sizeof(active));
+	memset(&spare, 0, sizeof(spare));
+}
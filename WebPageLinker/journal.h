@@ -0,0 +1,44 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+
+#include "scan.h"
+
+
+/*
+ * File: journal.h
+ * Author: Chance Krueger
+ * Purpose: A write-ahead journal for crash recovery. With --journal path every
+ *          command that changes the graph is appended to the journal as a binary
+ *          record before it runs, and the journal is synced to disk in groups: once
+ *          journalGroupRecords records are waiting or journalGroupMs after the
+ *          first of them (--journal-group-records and --journal-group-ms). @save
+ *          starts a fresh journal on top of the new snapshot, so recovering is
+ *          loading the snapshot the journal names and replaying the records after it.
+ *          A journal is never replaced by one on top of a different snapshot unless
+ *          it ends by saving the graph to that snapshot.
+ */
+
+
+
+#define JOURNAL_GROUP_RECORDS 1024
+#define JOURNAL_GROUP_MS 10
+
+
+
+/*
+ * The group commit limits, JOURNAL_GROUP_RECORDS and JOURNAL_GROUP_MS unless
+ * given on the command line.
+ */
+extern long journalGroupRecords;
+extern long journalGroupMs;
+
+char * journalBase(const char *path);
+int journalOpen(const char *path, const char *basePath);
+int journalAppend(const struct token *words, size_t count);
+int journalSaving(const char *snapshotPath);
+int journalCheckpoint(const char *snapshotPath);
+void journalClose();
+
+#endif
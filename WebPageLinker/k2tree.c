@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "WebPageLinker.h"
+#include "packed.h"
+#include "k2tree.h"
+
+
+/*
+ * File: k2tree.c
+ * Author: Chance Krueger
+ * Purpose: Implements the k²-tree view described in k2tree.h.
+ */
+
+
+
+#define RANK_BLOCK_WORDS 8
+
+
+
+/*
+ * bitvector -- `bits` bits packed into 64-bit words, lowest bit first, with `ranks[i]`
+ * holding the number of ones in the words before word RANK_BLOCK_WORDS * i.
+ */
+struct bitvector {
+
+
+	uint64_t *words;
+	uint64_t *ranks;
+	uint64_t bits;
+	size_t wordCap;
+};
+
+
+
+/*
+ * k2Tree -- A link matrix of 2^height by 2^height cells stored as a k²-tree with k = 2.
+ * Every non-empty quadrant has a block of four bits, one per sub-quadrant in the order
+ * (top left, top right, bottom left, bottom right), and blocks are laid out level by level.
+ * `tree` holds the blocks of every level but the last; the children of the one bit at
+ * position p of `tree` start at position 4 * rank1(tree, p) of `tree` followed by `leaves`,
+ * and the bits of `leaves` are the matrix cells themselves.
+ */
+struct k2Tree {
+
+
+	struct nameTable table;
+	uint32_t height;
+	uint64_t edgeCount;
+	struct bitvector tree;
+	struct bitvector leaves;
+};
+
+
+
+/*
+* appendBlock(vector, block) -- appends the 4 bits of 'block' to 'vector'. Blocks never straddle
+* a word. Returns 0 on success, 1 if out of memory.
+*/
+static int appendBlock(struct bitvector *vector, unsigned block) {
+
+	size_t word = vector->bits >> 6;
+
+	if (growArray((void **) &vector->words, &vector->wordCap, sizeof(uint64_t), word + 1) != 0) {
+		return 1;
+	}
+	if ((vector->bits & 63) == 0) {
+		vector->words[word] = 0;
+	}
+	vector->words[word] |= (uint64_t) block << (vector->bits & 63);
+	vector->bits += 4;
+	return 0;
+}
+
+
+
+/*
+* buildRanks(vector) -- fills in the rank samples of 'vector'. Returns 0 on success, 1 if out of memory.
+*/
+static int buildRanks(struct bitvector *vector) {
+
+	size_t words = (vector->bits + 63) >> 6;
+	size_t blocks = words / RANK_BLOCK_WORDS + 1;
+	uint64_t ones = 0;
+
+	vector->ranks = malloc(blocks * sizeof(uint64_t));
+	if (vector->ranks == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < words; i++) {
+		if (i % RANK_BLOCK_WORDS == 0) {
+			vector->ranks[i / RANK_BLOCK_WORDS] = ones;
+		}
+		ones += __builtin_popcountll(vector->words[i]);
+	}
+	if (words % RANK_BLOCK_WORDS == 0) {
+		vector->ranks[words / RANK_BLOCK_WORDS] = ones;
+	}
+	return 0;
+}
+
+
+
+/*
+* bitAt(vector, pos) -- returns bit 'pos' of 'vector'.
+*/
+static inline int bitAt(const struct bitvector *vector, uint64_t pos) {
+
+	return (vector->words[pos >> 6] >> (pos & 63)) & 1;
+}
+
+
+
+/*
+* rank1(vector, pos) -- returns the number of ones in bits 0 through 'pos' of 'vector'.
+*/
+static inline uint64_t rank1(const struct bitvector *vector, uint64_t pos) {
+
+	uint64_t word = pos >> 6;
+	uint64_t ones = vector->ranks[word / RANK_BLOCK_WORDS];
+
+	for (uint64_t i = word - word % RANK_BLOCK_WORDS; i < word; i++) {
+		ones += __builtin_popcountll(vector->words[i]);
+	}
+	uint64_t mask = (pos & 63) == 63 ? ~0ULL : (2ULL << (pos & 63)) - 1;
+	return ones + __builtin_popcountll(vector->words[word] & mask);
+}
+
+
+
+/*
+* spreadBits(value) -- moves bit i of 'value' to bit 2i.
+*/
+static inline uint64_t spreadBits(uint64_t value) {
+
+	value = (value | (value << 16)) & 0x0000FFFF0000FFFFULL;
+	value = (value | (value << 8)) & 0x00FF00FF00FF00FFULL;
+	value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	value = (value | (value << 2)) & 0x3333333333333333ULL;
+	value = (value | (value << 1)) & 0x5555555555555555ULL;
+	return value;
+}
+
+
+
+/*
+* compareCodes(a, b) -- qsort order for cell codes.
+*/
+static int compareCodes(const void *a, const void *b) {
+
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+
+
+/*
+* compareIds(a, b) -- qsort order for page numbers.
+*/
+static int compareIds(const void *a, const void *b) {
+
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+	return (x > y) - (x < y);
+}
+
+
+
+/*
+* k2Free(tree) -- frees a k²-tree and all its arrays.
+*/
+static void k2Free(struct k2Tree *tree) {
+
+	nameTableFree(&tree->table);
+	free(tree->tree.words);
+	free(tree->tree.ranks);
+	free(tree->leaves.words);
+	free(tree->leaves.ranks);
+	free(tree);
+}
+
+
+
+/*
+* k2Lookup(impl, name) -- finds 'name' in a k²-tree's name table.
+*/
+static int64_t k2Lookup(const void *impl, struct token name) {
+
+	const struct k2Tree *tree = impl;
+	return nameTableLookup(&tree->table, name);
+}
+
+
+
+/*
+* k2Collect(tree, pos, level, page, other, byColumn, scratch, count) -- walks the quadrants of the
+* block at 'pos' that lie in row 'page' (or, with 'byColumn' set, in column 'page'), and appends
+* the column (row) of every link found below them to 'scratch->buf'. 'other' holds the bits of
+* that column (row) chosen on the way down. Returns 0 on success, 1 if out of memory.
+*/
+static int k2Collect(const struct k2Tree *tree, uint64_t pos, uint32_t level, uint32_t page, uint32_t other,
+                     int byColumn, struct viewScratch *scratch, uint32_t *count) {
+
+	unsigned fixed = (page >> (tree->height - 1 - level)) & 1;
+
+	for (unsigned bit = 0; bit < 2; bit++) {
+
+		uint64_t cell = pos + (byColumn ? 2 * bit + fixed : 2 * fixed + bit);
+		uint32_t next = (other << 1) | bit;
+
+		if (level + 1 < tree->height) {
+			if (bitAt(&tree->tree, cell) &&
+			    k2Collect(tree, 4 * rank1(&tree->tree, cell), level + 1, page, next, byColumn, scratch, count) != 0) {
+				return 1;
+			}
+		} else if (bitAt(&tree->leaves, cell - tree->tree.bits)) {
+			if (scratchReserveBuf(scratch, *count + 1) != 0) {
+				return 1;
+			}
+			scratch->buf[(*count)++] = next;
+		}
+	}
+	return 0;
+}
+
+
+
+/*
+* k2Successors(impl, page, scratch, out) -- lists the pages 'page' links to in 'scratch->buf',
+* in page number order, and points '*out' at them. Returns how many there are.
+*/
+static uint32_t k2Successors(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out) {
+
+	const struct k2Tree *tree = impl;
+	uint32_t count = 0;
+
+	if (tree->edgeCount == 0 || k2Collect(tree, 0, 0, page, 0, 0, scratch, &count) != 0) {
+		return 0;
+	}
+	*out = scratch->buf;
+	return count;
+}
+
+
+
+/*
+* k2Predecessors(impl, page, scratch, out) -- lists the pages linking to 'page' in 'scratch->buf',
+* in page number order, and points '*out' at them. Returns how many there are.
+*/
+static uint32_t k2Predecessors(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out) {
+
+	const struct k2Tree *tree = impl;
+	uint32_t count = 0;
+
+	if (tree->edgeCount == 0 || k2Collect(tree, 0, 0, page, 0, 1, scratch, &count) != 0) {
+		return 0;
+	}
+	*out = scratch->buf;
+	return count;
+}
+
+
+
+/*
+* k2Expand(tree, pos, level, rows, count, col, to, scratch, next) -- follows the links of all the
+* sorted frontier 'rows' through the block at 'pos' together, so each quadrant is decoded once per
+* frontier rather than once per row. 'col' holds the column bits chosen on the way down. Newly seen
+* pages are appended to 'scratch->buf' at '*next'. Returns 1 if 'to' was reached, 0 if not, and
+* -1 if out of memory.
+*/
+static int k2Expand(const struct k2Tree *tree, uint64_t pos, uint32_t level, const uint32_t *rows, size_t count,
+                    uint32_t col, uint32_t to, struct viewScratch *scratch, size_t *next) {
+
+	// The rows share their bits above this level, so the ones with a 0 here come first.
+	uint32_t shift = tree->height - 1 - level;
+	size_t split = 0;
+	size_t high = count;
+
+	while (split < high) {
+		size_t mid = split + (high - split) / 2;
+		if ((rows[mid] >> shift) & 1) {
+			high = mid;
+		} else {
+			split = mid + 1;
+		}
+	}
+
+	for (unsigned rowBit = 0; rowBit < 2; rowBit++) {
+
+		const uint32_t *sub = rowBit ? rows + split : rows;
+		size_t subCount = rowBit ? count - split : split;
+
+		for (unsigned colBit = 0; colBit < 2 && subCount > 0; colBit++) {
+
+			uint64_t cell = pos + 2 * rowBit + colBit;
+			uint32_t page = (col << 1) | colBit;
+
+			if (level + 1 < tree->height) {
+				if (bitAt(&tree->tree, cell)) {
+					int found = k2Expand(tree, 4 * rank1(&tree->tree, cell), level + 1, sub, subCount, page, to, scratch, next);
+					if (found != 0) {
+						return found;
+					}
+				}
+			} else if (bitAt(&tree->leaves, cell - tree->tree.bits)) {
+				if (page == to) {
+					return 1;
+				}
+				if (scratch->seen[page] != scratch->epoch) {
+					if (scratchReserveBuf(scratch, *next + 1) != 0) {
+						return -1;
+					}
+					scratch->seen[page] = scratch->epoch;
+					scratch->buf[(*next)++] = page;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+
+
+/*
+* k2Reachable(impl, from, to, scratch) -- a breadth-first search that expands a whole frontier per
+* pass: the frontier is sorted by page number and handed to k2Expand(), which walks the tree once
+* for all of it. Per-row successor queries would decode the dense upper quadrants again for every
+* page. Returns 1 if 'to' can be reached from 'from', 0 if not, and -1 if out of memory.
+*/
+static int k2Reachable(const void *impl, uint32_t from, uint32_t to, struct viewScratch *scratch) {
+
+	const struct k2Tree *tree = impl;
+	size_t count = 1;
+
+	if (tree->edgeCount == 0) {
+		return 0;
+	}
+
+	scratch->stack[0] = from;
+	scratch->seen[from] = scratch->epoch;
+
+	while (count > 0) {
+
+		size_t next = 0;
+		int found = k2Expand(tree, 0, 0, scratch->stack, count, 0, to, scratch, &next);
+
+		if (found != 0) {
+			return found;
+		}
+
+		// The pages found become the next frontier.
+		uint32_t *frontier = scratch->buf;
+		size_t frontierCap = scratch->bufCap;
+		scratch->buf = scratch->stack;
+		scratch->bufCap = scratch->stackCap;
+		scratch->stack = frontier;
+		scratch->stackCap = frontierCap;
+		count = next;
+
+		if (count > 1) {
+			qsort(scratch->stack, count, sizeof(uint32_t), compareIds);
+		}
+	}
+	return 0;
+}
+
+
+
+/*
+* k2Thaw(impl) -- adds the pages and links of a k²-tree to the graph, every link from one pool
+* allocation. Returns 0 on success, 1 on error.
+*/
+static int k2Thaw(const void *impl) {
+
+	const struct k2Tree *tree = impl;
+	uint32_t pages = tree->table.count;
+
+	if (pages == 0) {
+		return 0;
+	}
+
+	struct page *batch = nameTableThaw(&tree->table);
+	struct link *links = tree->edgeCount > 0 ? poolAllocArray(&linkPool, tree->edgeCount) : NULL;
+
+	if (batch == NULL || (tree->edgeCount > 0 && links == NULL)) {
+		fprintf(stderr, "Couldn't unpack the graph.\n");
+		return 1;
+	}
+
+	struct viewScratch scratch = { 0 };
+	uint64_t next = 0;
+
+	for (uint32_t i = 0; i < pages && next < tree->edgeCount; i++) {
+
+		const uint32_t *targets;
+		uint32_t count = k2Successors(tree, i, &scratch, &targets);
+
+		for (uint32_t e = 0; e < count; e++) {
+			links[next + e].to = &batch[targets[e]];
+			links[next + e].next = e + 1 < count ? &links[next + e + 1] : NULL;
+			batch[targets[e]].inCount++;
+		}
+		batch[i].edges = count > 0 ? &links[next] : NULL;
+		batch[i].outCount = count;
+		next += count;
+	}
+
+	scratchFree(&scratch);
+	linkCount += next;
+	return 0;
+}
+
+
+
+/*
+* k2Close(impl) -- frees a k²-tree.
+*/
+static void k2Close(void *impl) {
+
+	k2Free(impl);
+}
+
+
+
+static const struct viewOps k2Ops = { "k2-tree", k2Lookup, k2Successors, k2Predecessors, k2Reachable, k2Thaw, k2Close };
+
+
+
+/*
+* k2Graph(view) -- builds a k²-tree of the live pages and links of the list graph, opens 'view' on
+* it and frees the list graph. Each link becomes the cell code of its (source, target) pair with
+* the two numbers' bits interleaved, so sorting the codes puts the cells in quadrant order: one
+* pass over the sorted codes per level then emits that level's blocks. Duplicate links collapse
+* into one cell. If building fails the list graph is left as it was. Returns 0 on success, 1 on error.
+*/
+int k2Graph(struct graphView *view) {
+
+	struct k2Tree *tree = calloc(1, sizeof(struct k2Tree));
+	uint64_t *codes = NULL;
+	size_t codeCap = 0;
+	size_t codeCount = 0;
+
+	if (tree == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	if (nameTableBuild(&tree->table) != 0) {
+		free(tree);
+		return 1;
+	}
+
+	tree->height = 1;
+	while (tree->height < 32 && (1ULL << tree->height) < tree->table.count) {
+		tree->height++;
+	}
+
+	for (struct page *cur = graphHead; cur != NULL; cur = cur->next) {
+
+		if (cur->removed) {
+			continue;
+		}
+
+		for (struct link *edge = cur->edges; edge != NULL; edge = edge->next) {
+			if (edge->to == NULL || edge->to->removed) {
+				continue;
+			}
+			if (growArray((void **) &codes, &codeCap, sizeof(uint64_t), codeCount + 1) != 0) {
+				free(codes);
+				k2Free(tree);
+				return 1;
+			}
+			codes[codeCount++] = (spreadBits(cur->id) << 1) | spreadBits(edge->to->id);
+		}
+	}
+
+	if (codeCount > 1) {
+		qsort(codes, codeCount, sizeof(uint64_t), compareCodes);
+	}
+
+	size_t unique = 0;
+	for (size_t i = 0; i < codeCount; i++) {
+		if (unique == 0 || codes[unique - 1] != codes[i]) {
+			codes[unique++] = codes[i];
+		}
+	}
+	tree->edgeCount = unique;
+
+	// Level l groups the codes by their top 2l bits; each group is one non-empty quadrant.
+	int failed = 0;
+	for (uint32_t level = 0; level < tree->height && !failed; level++) {
+
+		uint32_t below = 2 * (tree->height - 1 - level);
+		struct bitvector *out = level + 1 < tree->height ? &tree->tree : &tree->leaves;
+		size_t i = 0;
+
+		while (i < unique && !failed) {
+			uint64_t quadrant = (codes[i] >> below) >> 2;
+			unsigned block = 0;
+
+			while (i < unique && (codes[i] >> below) >> 2 == quadrant) {
+				block |= 1u << ((codes[i] >> below) & 3);
+				i++;
+			}
+			failed = appendBlock(out, block);
+		}
+	}
+
+	free(codes);
+
+	if (failed || buildRanks(&tree->tree) != 0 || buildRanks(&tree->leaves) != 0) {
+		k2Free(tree);
+		return 1;
+	}
+
+	freeMemory();
+
+	view->ops = &k2Ops;
+	view->impl = tree;
+	view->pageCount = tree->table.count;
+	return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef K2TREE_H
+#define K2TREE_H
+
+#include "view.h"
+
+
+/*
+ * File: k2tree.h
+ * Author: Chance Krueger
+ * Purpose: A succinct k²-tree (k = 2) view of the link matrix for the largest graphs.
+ *          With --k2tree the list graph is frozen into one the first time it is
+ *          queried: the adjacency matrix is split into quadrants recursively, and
+ *          only the non-empty ones are kept, one bit each, in two bitvectors with
+ *          rank support. A link typically costs a few bits, and the same structure
+ *          answers both successor and predecessor queries.
+ */
+
+
+
+int k2Graph(struct graphView *view);
+
+#endif
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "output.h"
+#include "uring.h"
+
+
+/*
+ * File: output.c
+ * Author: Chance Krueger
+ * Purpose: Implements the batched result writer declared in output.h.
+ */
+
+
+
+/*
+ * outRing -- The io_uring behind an outBuf. `buffers` are the two registered
+ * buffers the outBuf fills in turn; `pending` bytes at `writing`, in buffer
+ * `writingIndex`, are being written while the other one fills. `failed` is set
+ * when a write fails, and reported by the next flush.
+ */
+struct outRing {
+
+
+	struct uring uring;
+	char *buffers[2];
+	const char *writing;
+	size_t pending;
+	int writingIndex;
+	int failed;
+};
+
+
+
+/*
+* outputInit(out, fd, cap, interactive) -- sets up 'out' to write to 'fd' through a buffer of
+* 'cap' bytes. Returns 0 on success, 1 if out of memory.
+*/
+int outputInit(struct outBuf *out, int fd, size_t cap, int interactive) {
+
+	out->fd = fd;
+	out->len = 0;
+	out->cap = cap;
+	out->interactive = interactive;
+	out->binary = 0;
+	out->ring = NULL;
+	out->buf = malloc(cap);
+
+	if (out->buf == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* outputUseRing(out) -- has 'out' write through io_uring from now on, into a second buffer of the
+* same size while the first is being written. Returns 0 on success, 1 if io_uring can't be used,
+* in which case 'out' goes on with write().
+*/
+int outputUseRing(struct outBuf *out) {
+
+	struct outRing *ring = calloc(1, sizeof(struct outRing));
+	char *spare = malloc(out->cap);
+
+	if (ring == NULL || spare == NULL || uringInit(&ring->uring, 2) != 0) {
+		free(ring);
+		free(spare);
+		return 1;
+	}
+
+	struct iovec buffers[2] = { { out->buf, out->cap }, { spare, out->cap } };
+
+	if (uringRegister(&ring->uring, buffers, 2) != 0) {
+		uringFree(&ring->uring);
+		free(ring);
+		free(spare);
+		return 1;
+	}
+
+	ring->buffers[0] = out->buf;
+	ring->buffers[1] = spare;
+	out->ring = ring;
+	return 0;
+}
+
+
+
+/*
+* finishWrite(out) -- waits until the write the ring of 'out' has going is done, carrying on after
+* the kernel takes part of it. Returns 0 on success, 1 if it or an earlier write failed.
+*/
+static int finishWrite(struct outBuf *out) {
+
+	struct outRing *ring = out->ring;
+
+	while (ring->pending > 0) {
+
+		uint64_t tag;
+		int result;
+
+		if (uringSubmit(&ring->uring, 1) != 0) {
+			ring->failed = 1;
+			break;
+		}
+		if (!uringReap(&ring->uring, &tag, &result)) {
+			continue;
+		}
+
+		if (result == -EINTR) {
+			result = 0;
+		} else if (result < 0) {
+			ring->failed = 1;
+			break;
+		}
+
+		ring->writing += result;
+		ring->pending -= result;
+		if (ring->pending > 0) {
+			uringWrite(&ring->uring, out->fd, ring->writing, ring->pending, ring->writingIndex, -1, 0);
+		}
+	}
+
+	int failed = ring->failed;
+	ring->pending = 0;
+	ring->failed = 0;
+	return failed;
+}
+
+
+
+/*
+* writeBehind(out) -- starts writing what 'out' has buffered through its ring and switches it to
+* the other buffer, once the write before is done, so results go on while this one is written.
+*/
+static void writeBehind(struct outBuf *out) {
+
+	struct outRing *ring = out->ring;
+
+	ring->failed = finishWrite(out);
+
+	if (out->len == 0) {
+		return;
+	}
+
+	ring->writingIndex = out->buf == ring->buffers[1];
+	ring->writing = out->buf;
+	ring->pending = out->len;
+
+	if (uringWrite(&ring->uring, out->fd, out->buf, out->len, ring->writingIndex, -1, 0) != 0 ||
+	    uringSubmit(&ring->uring, 0) != 0) {
+		ring->failed = 1;
+		ring->pending = 0;
+	}
+
+	out->buf = ring->buffers[!ring->writingIndex];
+	out->len = 0;
+}
+
+
+
+/*
+* makeRoom(out) -- empties the buffer of 'out': in the background when it writes through a ring.
+*/
+static void makeRoom(struct outBuf *out) {
+
+	if (out->ring != NULL) {
+		writeBehind(out);
+	} else {
+		outputFlush(out);
+	}
+}
+
+
+
+/*
+* outputFlush(out) -- writes everything buffered in 'out' with one write() call, looping only
+* if the kernel takes part of it, or through its ring and waits for that. Returns 0 on success, 1
+* if the write fails.
+*/
+int outputFlush(struct outBuf *out) {
+
+	if (out->ring != NULL) {
+		writeBehind(out);
+		return finishWrite(out);
+	}
+
+	size_t done = 0;
+
+	while (done < out->len) {
+		ssize_t wrote = write(out->fd, out->buf + done, out->len - done);
+		if (wrote < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			out->len = 0;
+			return 1;
+		}
+		done += wrote;
+	}
+	out->len = 0;
+	return 0;
+}
+
+
+
+/*
+* outputBytes(out, bytes, len) -- appends 'len' bytes to 'out', flushing first if they don't fit.
+* Anything larger than the whole buffer is written straight through.
+*/
+void outputBytes(struct outBuf *out, const char *bytes, size_t len) {
+
+	if (len > out->cap) {
+		outputFlush(out);
+		struct outBuf direct = { out->fd, (char *) bytes, len, len, 0 };
+		outputFlush(&direct);
+		return;
+	}
+
+	if (out->len + len > out->cap) {
+		makeRoom(out);
+	}
+
+	memcpy(out->buf + out->len, bytes, len);
+	out->len += len;
+}
+
+
+
+/*
+* outputInt(out, value) -- appends 'value' in decimal followed by a newline to 'out', or as a
+* single byte if 'out' is binary. The digits are produced back to front into a small scratch
+* array, without printf.
+*/
+void outputInt(struct outBuf *out, long value) {
+
+	if (out->binary) {
+		char byte = (char) value;
+		outputBytes(out, &byte, 1);
+		return;
+	}
+
+	char digits[24];
+	char *cur = digits + sizeof(digits);
+	unsigned long magnitude = value < 0 ? 0UL - (unsigned long) value : (unsigned long) value;
+
+	*--cur = '\n';
+	do {
+		*--cur = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (value < 0) {
+		*--cur = '-';
+	}
+
+	size_t len = digits + sizeof(digits) - cur;
+
+	if (out->len + len > out->cap) {
+		makeRoom(out);
+	}
+	memcpy(out->buf + out->len, cur, len);
+	out->len += len;
+}
+
+
+
+/*
+* outputEndLine(out) -- marks the end of one input line; interactive buffers are flushed here
+* so a person typing commands sees each answer right away.
+*/
+void outputEndLine(struct outBuf *out) {
+
+	if (out->interactive && out->len > 0) {
+		outputFlush(out);
+	}
+}
+
+
+
+/*
+* outputFree(out) -- flushes 'out' and frees its buffer.
+*/
+void outputFree(struct outBuf *out) {
+
+	outputFlush(out);
+
+	if (out->ring != NULL) {
+		uringFree(&out->ring->uring);
+		free(out->ring->buffers[0]);
+		free(out->ring->buffers[1]);
+		free(out->ring);
+		out->ring = NULL;
+	} else {
+		free(out->buf);
+	}
+	out->buf = NULL;
+}
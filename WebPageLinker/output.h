@@ -0,0 +1,48 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+
+/*
+ * File: output.h
+ * Author: Chance Krueger
+ * Purpose: Batched result output. Results are formatted by hand into one large
+ *          reusable buffer that goes out with a single write() per batch: when the
+ *          buffer fills, at EOF, or after every line in interactive mode. With
+ *          outputUseRing() a full buffer is written through io_uring while results
+ *          go on into a second one.
+ */
+
+
+
+/*
+ * outBuf -- A result buffer for the file descriptor `fd`. `len` bytes of the
+ * `cap` byte buffer `buf` are waiting to be written. With `interactive` set,
+ * outputEndLine() flushes after every input line. With `binary` set, each result is
+ * one byte instead of a line of decimal digits. `ring` is set while the buffer is
+ * written through io_uring.
+ */
+struct outBuf {
+
+
+	int fd;
+	char *buf;
+	size_t len;
+	size_t cap;
+	int interactive;
+	int binary;
+	struct outRing *ring;
+};
+
+
+
+int outputInit(struct outBuf *out, int fd, size_t cap, int interactive);
+int outputUseRing(struct outBuf *out);
+int outputFlush(struct outBuf *out);
+void outputInt(struct outBuf *out, long value);
+void outputBytes(struct outBuf *out, const char *bytes, size_t len);
+void outputEndLine(struct outBuf *out);
+void outputFree(struct outBuf *out);
+
+#endif
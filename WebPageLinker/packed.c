@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "WebPageLinker.h"
+#include "packed.h"
+#include "varint.h"
+
+
+/*
+ * File: packed.c
+ * Author: Chance Krueger
+ * Purpose: Implements the packed adjacency view and the name table described in packed.h.
+ */
+
+
+
+/*
+ * packedGraph -- A graph packed by packGraph(). The link list of page i takes the bytes
+ * of `lists` from `listOffsets[i]` to `listOffsets[i + 1]`: a varint link count, the
+ * zigzag-encoded distance from i to the first (smallest) target, then the varint gap to
+ * each following target. Duplicate links are kept as gaps of 0.
+ */
+struct packedGraph {
+
+
+	struct nameTable table;
+	uint64_t edgeCount;
+	uint64_t *listOffsets;
+	uint8_t *lists;
+};
+
+
+
+/*
+* nameTableBuild(table) -- numbers the live pages of the list graph in list order, storing each
+* number in the page's `id`, and copies their names into 'table'. Returns 0 on success, 1 on error.
+*/
+int nameTableBuild(struct nameTable *table) {
+
+	uint64_t pages = 0;
+	uint64_t nameBytes = 0;
+
+	memset(table, 0, sizeof(struct nameTable));
+
+	for (struct page *cur = graphHead; cur != NULL; cur = cur->next) {
+		if (!cur->removed) {
+			cur->id = pages++;
+			nameBytes += strlen(cur->name) + 1;
+		}
+	}
+
+	table->bucketCount = 16;
+	while (table->bucketCount < 2 * pages) {
+		table->bucketCount *= 2;
+	}
+
+	table->names = malloc(nameBytes + 1);
+	table->offsets = malloc((pages + 1) * sizeof(uint64_t));
+	table->buckets = calloc(table->bucketCount, sizeof(uint32_t));
+
+	if (pages >= UINT32_MAX || table->names == NULL || table->offsets == NULL || table->buckets == NULL) {
+		fprintf(stderr, "Couldn't pack the graph.\n");
+		nameTableFree(table);
+		return 1;
+	}
+
+	uint64_t nameOff = 0;
+	uint64_t mask = table->bucketCount - 1;
+
+	for (struct page *cur = graphHead; cur != NULL; cur = cur->next) {
+
+		if (cur->removed) {
+			continue;
+		}
+
+		size_t nameLen = strlen(cur->name) + 1;
+		memcpy(table->names + nameOff, cur->name, nameLen);
+		table->offsets[cur->id] = nameOff;
+		nameOff += nameLen;
+
+		uint64_t slot = hashName(pageToken(cur)) & mask;
+		while (table->buckets[slot] != 0) {
+			slot = (slot + 1) & mask;
+		}
+		table->buckets[slot] = cur->id + 1;
+	}
+
+	table->count = pages;
+	return 0;
+}
+
+
+
+/*
+* nameTableLookup(table, name) -- finds 'name' in 'table' by linear probing. Returns its page
+* number, or -1 if there is no such page.
+*/
+int64_t nameTableLookup(const struct nameTable *table, struct token name) {
+
+	uint64_t mask = table->bucketCount - 1;
+	uint64_t slot = hashName(name) & mask;
+
+	while (table->buckets[slot] != 0) {
+
+		uint32_t page = table->buckets[slot] - 1;
+		const char *stored = table->names + table->offsets[page];
+
+		if (strncmp(stored, name.ptr, name.len) == 0 && stored[name.len] == 0) {
+			return page;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+
+
+/*
+* nameTableThaw(table) -- adds a page for every name in 'table' to the (empty) list graph, all
+* from one pool allocation and in page number order. Returns the first page, so page i is at
+* index i, or NULL on error or when there are no pages.
+*/
+struct page * nameTableThaw(const struct nameTable *table) {
+
+	if (table->count == 0) {
+		return NULL;
+	}
+
+	struct page *batch = poolAllocArray(&pagePool, table->count);
+
+	if (batch == NULL || reserveIndex(table->count) != 0) {
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < table->count; i++) {
+
+		const char *name = table->names + table->offsets[i];
+		struct token nameToken = { name, strlen(name) };
+		struct page *node = &batch[i];
+
+		node->name = internName(nameToken);
+		node->id = i;
+		if (node->name == NULL || indexInsert(node) != 0) {
+			return NULL;
+		}
+		appendPage(node);
+	}
+	return batch;
+}
+
+
+
+/*
+* nameTableFree(table) -- frees the arrays of 'table'.
+*/
+void nameTableFree(struct nameTable *table) {
+
+	free(table->names);
+	free(table->offsets);
+	free(table->buckets);
+	memset(table, 0, sizeof(struct nameTable));
+}
+
+
+
+/*
+* compareIds(a, b) -- qsort order for page numbers.
+*/
+static int compareIds(const void *a, const void *b) {
+
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+	return (x > y) - (x < y);
+}
+
+
+
+/*
+* packedFree(packed) -- frees a packed graph and all its arrays.
+*/
+static void packedFree(struct packedGraph *packed) {
+
+	nameTableFree(&packed->table);
+	free(packed->listOffsets);
+	free(packed->lists);
+	free(packed);
+}
+
+
+
+/*
+* packedLookup(impl, name) -- finds 'name' in a packed graph's name table.
+*/
+static int64_t packedLookup(const void *impl, struct token name) {
+
+	const struct packedGraph *packed = impl;
+	return nameTableLookup(&packed->table, name);
+}
+
+
+
+/*
+* packedSuccessors(impl, page, scratch, out) -- decodes the link list of 'page' into
+* 'scratch->buf' and points '*out' at it. Returns the number of links.
+*/
+static uint32_t packedSuccessors(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out) {
+
+	const struct packedGraph *packed = impl;
+	const uint8_t *ptr = packed->lists + packed->listOffsets[page];
+	uint32_t count = getVarint(&ptr);
+
+	if (count == 0 || scratchReserveBuf(scratch, count) != 0) {
+		return 0;
+	}
+
+	uint32_t *buf = scratch->buf;
+	uint64_t first = getVarint(&ptr);
+	uint32_t target = page + (uint32_t) ((first >> 1) ^ -(first & 1));
+
+	buf[0] = target;
+	for (uint32_t i = 1; i < count; i++) {
+		if (*ptr < 0x80) {
+			target += *ptr++;
+		} else {
+			target += getVarint(&ptr);
+		}
+		buf[i] = target;
+	}
+
+	*out = buf;
+	return count;
+}
+
+
+
+/*
+* packedThaw(impl) -- adds the pages and links of a packed graph to the graph, every link from
+* one pool allocation. Returns 0 on success, 1 on error.
+*/
+static int packedThaw(const void *impl) {
+
+	const struct packedGraph *packed = impl;
+	uint32_t pages = packed->table.count;
+
+	if (pages == 0) {
+		return 0;
+	}
+
+	struct page *batch = nameTableThaw(&packed->table);
+	struct link *links = packed->edgeCount > 0 ? poolAllocArray(&linkPool, packed->edgeCount) : NULL;
+
+	if (batch == NULL || (packed->edgeCount > 0 && links == NULL)) {
+		fprintf(stderr, "Couldn't unpack the graph.\n");
+		return 1;
+	}
+
+	struct viewScratch scratch = { 0 };
+	uint64_t next = 0;
+
+	for (uint32_t i = 0; i < pages; i++) {
+
+		const uint32_t *targets;
+		uint32_t count = packedSuccessors(packed, i, &scratch, &targets);
+
+		for (uint32_t e = 0; e < count; e++) {
+			links[next + e].to = &batch[targets[e]];
+			links[next + e].next = e + 1 < count ? &links[next + e + 1] : NULL;
+			batch[targets[e]].inCount++;
+		}
+		batch[i].edges = count > 0 ? &links[next] : NULL;
+		batch[i].outCount = count;
+		next += count;
+	}
+
+	scratchFree(&scratch);
+	linkCount += next;
+	return 0;
+}
+
+
+
+/*
+* packedClose(impl) -- frees a packed graph.
+*/
+static void packedClose(void *impl) {
+
+	packedFree(impl);
+}
+
+
+
+static const struct viewOps packedOps = { "packed graph", packedLookup, packedSuccessors, NULL, NULL, packedThaw, packedClose };
+
+
+
+/*
+* packPages(view) -- packs the live pages and links of the list graph into a new packed graph and
+* opens 'view' on it, leaving the list graph as it is. Pages are numbered in list order; each
+* page's live links are sorted by target number and gap encoded. Returns 0 on success, 1 on error.
+*/
+int packPages(struct graphView *view) {
+
+	struct packedGraph *packed = calloc(1, sizeof(struct packedGraph));
+	uint32_t *targets = NULL;
+	size_t targetCap = 0;
+	size_t listCap = 0;
+	uint64_t listBytes = 0;
+
+	if (packed == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	if (nameTableBuild(&packed->table) != 0) {
+		free(packed);
+		return 1;
+	}
+
+	uint32_t pages = packed->table.count;
+	packed->listOffsets = malloc(((uint64_t) pages + 1) * sizeof(uint64_t));
+
+	if (packed->listOffsets == NULL) {
+		fprintf(stderr, "Couldn't pack the graph.\n");
+		packedFree(packed);
+		return 1;
+	}
+
+	for (struct page *cur = graphHead; cur != NULL; cur = cur->next) {
+
+		if (cur->removed) {
+			continue;
+		}
+
+		// Gather, sort and gap encode the live links; each takes at most 5 bytes plus the count.
+		size_t count = 0;
+		int failed = 0;
+		for (struct link *edge = cur->edges; edge != NULL; edge = edge->next) {
+			if (edge->to == NULL || edge->to->removed) {
+				continue;
+			}
+			if (growArray((void **) &targets, &targetCap, sizeof(uint32_t), count + 1) != 0) {
+				failed = 1;
+				break;
+			}
+			targets[count++] = edge->to->id;
+		}
+		if (count > 1) {
+			qsort(targets, count, sizeof(uint32_t), compareIds);
+		}
+
+		if (failed || growArray((void **) &packed->lists, &listCap, 1, listBytes + 5 * count + 20) != 0) {
+			free(targets);
+			packedFree(packed);
+			return 1;
+		}
+
+		uint32_t page = cur->id;
+		packed->listOffsets[page] = listBytes;
+		listBytes += putVarint(packed->lists + listBytes, count);
+
+		if (count > 0) {
+			int64_t first = (int64_t) targets[0] - (int64_t) page;
+			listBytes += putVarint(packed->lists + listBytes, ((uint64_t) first << 1) ^ (uint64_t) (first >> 63));
+		}
+		for (size_t i = 1; i < count; i++) {
+			listBytes += putVarint(packed->lists + listBytes, targets[i] - targets[i - 1]);
+		}
+
+		packed->edgeCount += count;
+	}
+
+	free(targets);
+	packed->listOffsets[pages] = listBytes;
+
+	// Give back the slack of the doubling buffer.
+	uint8_t *shrunk = realloc(packed->lists, listBytes + 1);
+	if (shrunk != NULL) {
+		packed->lists = shrunk;
+	}
+
+	view->ops = &packedOps;
+	view->impl = packed;
+	view->pageCount = pages;
+	return 0;
+}
+
+
+
+/*
+* packGraph(view) -- packs the list graph with packPages() and frees it. If packing fails the list
+* graph is left as it was. Returns 0 on success, 1 on error.
+*/
+int packGraph(struct graphView *view) {
+
+	if (packPages(view) != 0) {
+		return 1;
+	}
+
+	freeMemory();
+	return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <stdint.h>
+
+#include "view.h"
+
+
+/*
+ * File: packed.h
+ * Author: Chance Krueger
+ * Purpose: Compressed adjacency for read-mostly graphs. With --compress the list
+ *          graph is packed into a view the first time it is queried: each page's
+ *          links are sorted by target and stored as varint-encoded gaps, the first
+ *          one relative to the page itself, so a typical link costs one to three
+ *          bytes instead of a 16-byte `struct link` plus allocator overhead. Lists
+ *          are decoded on the fly as the traversal reaches them. The name table
+ *          built here is shared with the other packed backends.
+ */
+
+
+
+/*
+ * nameTable -- The page names of a packed graph. Page i is named `names + offsets[i]`,
+ * and `buckets` is a power-of-two table of page number + 1 (0 when empty), placed by
+ * hashName() with linear probing, as in a snapshot.
+ */
+struct nameTable {
+
+
+	uint32_t count;
+	char *names;
+	uint64_t *offsets;
+	uint32_t *buckets;
+	uint64_t bucketCount;
+};
+
+
+
+int nameTableBuild(struct nameTable *table);
+int64_t nameTableLookup(const struct nameTable *table, struct token name);
+struct page * nameTableThaw(const struct nameTable *table);
+void nameTableFree(struct nameTable *table);
+int packPages(struct graphView *view);
+int packGraph(struct graphView *view);
+
+#endif
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "WebPageLinker.h"
+#include "reader.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+/*
+ * File: parallel.c
+ * Author: Chance Krueger
+ * Purpose: Implements the parallel chunked parser described in parallel.h.
+ */
+
+
+
+#define CHUNKS_PER_THREAD 4
+#define MAX_PARSE_THREADS 64
+
+
+
+/*
+ * parsedChunk -- One newline-aligned piece of the input and what a worker made of it.
+ * `records` holds each non-blank line as its word count followed by a local name number
+ * per word, and `names` maps those numbers back to word views into the mapped file.
+ * `refs` holds each name's hashName(), worked out by the worker, and the page it names
+ * once the executor has looked it up, so a name repeated within the chunk is hashed and
+ * found once. `slots` is the worker's open-addressing table of name number + 1 by hash.
+ * `done` is set when parsing ends.
+ */
+struct parsedChunk {
+
+
+	const char *start;
+	const char *end;
+	uint32_t *records;
+	size_t recordLen;
+	size_t recordCap;
+	struct token *names;
+	struct pageRef *refs;
+	size_t nameCount;
+	size_t nameCap;
+	size_t refCap;
+	uint32_t *slots;
+	size_t slotCount;
+	int failed;
+	int done;
+};
+
+
+
+/*
+ * parallelParse -- The state the workers and the executor share. Workers claim chunks
+ * in order through `nextChunk`; `lock` and `cond` guard the chunks' `done` flags.
+ */
+struct parallelParse {
+
+
+	struct parsedChunk *chunks;
+	size_t chunkCount;
+	atomic_size_t nextChunk;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+
+
+/*
+* internLocal(chunk, word) -- returns the chunk-local number of 'word', adding it to the chunk's
+* names the first time it is seen. Returns UINT32_MAX if out of memory.
+*/
+static uint32_t internLocal(struct parsedChunk *chunk, struct token word) {
+
+	if (2 * (chunk->nameCount + 1) > chunk->slotCount) {
+
+		size_t newCount = chunk->slotCount == 0 ? 1024 : chunk->slotCount * 2;
+		uint32_t *grown = calloc(newCount, sizeof(uint32_t));
+
+		if (grown == NULL) {
+			return UINT32_MAX;
+		}
+		for (size_t i = 0; i < chunk->nameCount; i++) {
+			size_t slot = chunk->refs[i].hash & (newCount - 1);
+			while (grown[slot] != 0) {
+				slot = (slot + 1) & (newCount - 1);
+			}
+			grown[slot] = i + 1;
+		}
+		free(chunk->slots);
+		chunk->slots = grown;
+		chunk->slotCount = newCount;
+	}
+
+	unsigned long long hash = hashName(word);
+	size_t mask = chunk->slotCount - 1;
+	size_t slot = hash & mask;
+
+	while (chunk->slots[slot] != 0) {
+		struct token *seen = &chunk->names[chunk->slots[slot] - 1];
+		if (seen->len == word.len && memcmp(seen->ptr, word.ptr, word.len) == 0) {
+			return chunk->slots[slot] - 1;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (growArray((void **) &chunk->names, &chunk->nameCap, sizeof(struct token), chunk->nameCount + 1) != 0 ||
+	    growArray((void **) &chunk->refs, &chunk->refCap, sizeof(struct pageRef), chunk->nameCount + 1) != 0) {
+		return UINT32_MAX;
+	}
+	chunk->names[chunk->nameCount] = word;
+	chunk->refs[chunk->nameCount].hash = hash;
+	chunk->refs[chunk->nameCount].page = NULL;
+	chunk->slots[slot] = ++chunk->nameCount;
+	return chunk->nameCount - 1;
+}
+
+
+
+/*
+* parseChunk(chunk) -- tokenizes every line of 'chunk' and stores it as a record of local name
+* numbers. Returns 0 on success, 1 if out of memory.
+*/
+static int parseChunk(struct parsedChunk *chunk) {
+
+	struct token *words = NULL;
+	size_t wordCap = 0;
+	const char *pos = chunk->start;
+
+	while (pos < chunk->end) {
+
+		const char *newline = scanNewline(pos, chunk->end);
+		uint64_t start = statsBegin();
+		size_t count = tokenize(pos, newline - pos, &words, &wordCap);
+
+		statsEnd(STAT_PARSE, start);
+		pos = newline + 1;
+		if (count == 0) {
+			continue;
+		}
+
+		if (growArray((void **) &chunk->records, &chunk->recordCap, sizeof(uint32_t), chunk->recordLen + count + 1) != 0) {
+			free(words);
+			return 1;
+		}
+
+		chunk->records[chunk->recordLen++] = count;
+		for (size_t i = 0; i < count; i++) {
+			uint32_t id = internLocal(chunk, words[i]);
+			if (id == UINT32_MAX) {
+				free(words);
+				return 1;
+			}
+			chunk->records[chunk->recordLen++] = id;
+		}
+	}
+
+	free(words);
+	return 0;
+}
+
+
+
+/*
+* parseWorker(arg) -- claims chunks in input order and parses them until none are left, marking
+* each one done as it finishes.
+*/
+static void * parseWorker(void *arg) {
+
+	struct parallelParse *parse = arg;
+	size_t index;
+
+	while ((index = atomic_fetch_add(&parse->nextChunk, 1)) < parse->chunkCount) {
+
+		struct parsedChunk *chunk = &parse->chunks[index];
+		int failed = parseChunk(chunk);
+
+		pthread_mutex_lock(&parse->lock);
+		chunk->failed = failed;
+		chunk->done = 1;
+		pthread_cond_broadcast(&parse->cond);
+		pthread_mutex_unlock(&parse->lock);
+	}
+	return NULL;
+}
+
+
+
+/*
+* freeChunk(chunk) -- frees what a worker built for 'chunk'.
+*/
+static void freeChunk(struct parsedChunk *chunk) {
+
+	free(chunk->records);
+	free(chunk->names);
+	free(chunk->refs);
+	free(chunk->slots);
+	chunk->records = NULL;
+	chunk->names = NULL;
+	chunk->refs = NULL;
+	chunk->slots = NULL;
+}
+
+
+
+/*
+* parallelRun(map, len, bulkMode, errSeen) -- runs the commands in the 'len' mapped bytes at 'map'.
+* The input is cut into a few chunks per online CPU, each ending at a newline, and worker threads
+* parse them while this thread runs the finished chunks in order with runCommandRefs(), adding their
+* errors to '*errSeen' and freeing each chunk once it has run. Each command gets the chunk's refs
+* of its names, so a name is never hashed again and a page is found once per chunk. Returns 0 on success and -1 if a
+* chunk could not be parsed.
+*/
+int parallelRun(const char *map, size_t len, int bulkMode, int *errSeen) {
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = cpus > 1 ? (cpus < MAX_PARSE_THREADS ? cpus : MAX_PARSE_THREADS) : 1;
+	size_t chunkCount = threads * CHUNKS_PER_THREAD;
+	struct parallelParse parse;
+	pthread_t workers[MAX_PARSE_THREADS];
+
+	memset(&parse, 0, sizeof(parse));
+	parse.chunks = calloc(chunkCount, sizeof(struct parsedChunk));
+
+	if (parse.chunks == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return -1;
+	}
+
+	// Cut at the first newline after each even split point; a chunk may end up empty.
+	const char *end = map + len;
+	const char *start = map;
+
+	for (size_t i = 0; i < chunkCount; i++) {
+		const char *cut = i + 1 == chunkCount ? end : map + len / chunkCount * (i + 1);
+		if (cut < start) {
+			cut = start;
+		}
+		if (cut < end) {
+			cut = scanNewline(cut, end);
+			cut += cut < end;
+		}
+		parse.chunks[i].start = start;
+		parse.chunks[i].end = cut;
+		start = cut;
+	}
+
+	parse.chunkCount = chunkCount;
+	atomic_init(&parse.nextChunk, 0);
+	pthread_mutex_init(&parse.lock, NULL);
+	pthread_cond_init(&parse.cond, NULL);
+
+	// Pick the scanner before the workers start sharing it.
+	scanSetLevel(-1);
+
+	size_t started = 0;
+	while (started < threads && pthread_create(&workers[started], NULL, parseWorker, &parse) == 0) {
+		started++;
+	}
+	if (started == 0) {
+		parseWorker(&parse);
+	}
+
+	struct token *words = NULL;
+	size_t wordCap = 0;
+	struct pageRef **wordRefs = NULL;
+	size_t wordRefCap = 0;
+	int status = 0;
+
+	for (size_t i = 0; i < chunkCount; i++) {
+
+		struct parsedChunk *chunk = &parse.chunks[i];
+
+		pthread_mutex_lock(&parse.lock);
+		while (!chunk->done) {
+			pthread_cond_wait(&parse.cond, &parse.lock);
+		}
+		pthread_mutex_unlock(&parse.lock);
+
+		if (chunk->failed) {
+			fprintf(stderr, "Ran Out Of Memory.\n");
+			status = -1;
+		}
+
+		size_t pos = 0;
+		while (status == 0 && pos < chunk->recordLen) {
+
+			uint32_t count = chunk->records[pos++];
+
+			if (growArray((void **) &words, &wordCap, sizeof(struct token), count) != 0 ||
+			    growArray((void **) &wordRefs, &wordRefCap, sizeof(struct pageRef *), count) != 0) {
+				status = -1;
+				break;
+			}
+			for (uint32_t w = 0; w < count; w++) {
+				uint32_t id = chunk->records[pos++];
+				words[w] = chunk->names[id];
+				wordRefs[w] = &chunk->refs[id];
+			}
+
+			*errSeen += runCommandRefs(words, wordRefs, count, bulkMode);
+			outputEndLine(resultOut);
+		}
+		freeChunk(chunk);
+	}
+
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	pthread_mutex_destroy(&parse.lock);
+	pthread_cond_destroy(&parse.cond);
+	free(words);
+	free(wordRefs);
+	free(parse.chunks);
+	return status;
+}
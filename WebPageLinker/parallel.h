@@ -0,0 +1,24 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+
+/*
+ * File: parallel.h
+ * Author: Chance Krueger
+ * Purpose: Parallel parsing of large command files. A mapped input file is split
+ *          at newlines into chunks that worker threads parse at the same time into
+ *          compact records, each chunk interning its own names, while the calling
+ *          thread applies the chunks' commands in their original order.
+ */
+
+
+
+#define PARALLEL_MIN_BYTES (8 << 20)
+
+
+
+int parallelRun(const char *map, size_t len, int bulkMode, int *errSeen);
+
+#endif
@@ -0,0 +1,680 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "WebPageLinker.h"
+#include "reader.h"
+#include "pipeline.h"
+#include "uring.h"
+#include "stats.h"
+
+
+/*
+ * File: pipeline.c
+ * Author: Chance Krueger
+ * Purpose: Implements the reader/parser/executor pipeline described in pipeline.h.
+ */
+
+
+
+#define CHUNK_SIZE (1 << 20)
+#define CHUNK_COUNT 8
+#define RECORD_RING_SIZE (1 << 22)
+#define RECORD_ALIGN 16
+#define SPIN_LIMIT 2048
+
+
+
+/*
+ * waiter -- Lets a ring's consumer or producer sleep once spinning has not paid off.
+ * The rings themselves are lock-free; the mutex and condition variable are only
+ * touched by a side that has to wait and by the other side when `sleepers` says
+ * someone is waiting.
+ */
+struct waiter {
+
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	atomic_int sleepers;
+};
+
+
+
+/*
+ * chunk -- A buffer of raw input handed from the reader to the parser. `status` is
+ * 0 for data, 1 at the end of the input and -1 after a read error.
+ */
+struct chunk {
+
+
+	char *data;
+	size_t len;
+	int status;
+};
+
+
+
+/*
+ * chunkQueue -- A single-producer/single-consumer queue of chunks. `head` and `tail`
+ * only grow; slot i lives at i % CHUNK_COUNT. Only CHUNK_COUNT buffers exist, so a
+ * queue never has to wait for room.
+ */
+struct chunkQueue {
+
+
+	struct chunk slots[CHUNK_COUNT];
+	atomic_size_t head;
+	atomic_size_t tail;
+	struct waiter wait;
+};
+
+
+
+/*
+ * Record kinds in the command ring.
+ */
+enum recordKind {
+	RECORD_COMMAND,
+	RECORD_SKIP,
+	RECORD_END
+};
+
+
+
+/*
+ * commandRecord -- One parsed command in the record ring: this header, `count` word
+ * views, then the bytes of the line they point into, `size` bytes in all (a multiple
+ * of RECORD_ALIGN). A line too long for the ring is kept in the heap block `large`
+ * instead, which the executor frees. A RECORD_SKIP pads out the end of the ring and
+ * RECORD_END carries the input's final status.
+ */
+struct commandRecord {
+
+
+	uint32_t size;
+	uint32_t kind;
+	uint32_t count;
+	int32_t status;
+	void *large;
+	void *pad;
+};
+
+
+
+/*
+ * recordRing -- A single-producer/single-consumer ring of variable-sized command
+ * records. `head` and `tail` are byte counts that only grow; byte i lives at
+ * i % RECORD_RING_SIZE.
+ */
+struct recordRing {
+
+
+	char *data;
+	atomic_size_t head;
+	atomic_size_t tail;
+	struct waiter wait;
+};
+
+
+
+/*
+ * pipeline -- Everything the three threads share. `empty` returns used buffers to
+ * the reader and `full` passes filled ones to the parser. With `ringReady` set the
+ * reader reads through `ring`, in which the chunk buffers at `buffers` are
+ * registered; input that can seek (`seekable`) is read from `offset` on.
+ */
+struct pipeline {
+
+
+	int fd;
+	char *buffers;
+	struct uring ring;
+	int ringReady;
+	int seekable;
+	off_t offset;
+	struct chunkQueue empty;
+	struct chunkQueue full;
+	struct recordRing records;
+	char *carry;
+	size_t carryLen;
+	size_t carryCap;
+	struct token *words;
+	size_t wordCap;
+};
+
+
+
+/*
+* waitChange(wait, word, seen) -- returns once '*word' no longer holds 'seen', spinning for a
+* while before sleeping on 'wait'.
+*/
+static void waitChange(struct waiter *wait, atomic_size_t *word, size_t seen) {
+
+	for (int i = 0; i < SPIN_LIMIT; i++) {
+		if (atomic_load_explicit(word, memory_order_acquire) != seen) {
+			return;
+		}
+	}
+
+	pthread_mutex_lock(&wait->lock);
+	atomic_fetch_add(&wait->sleepers, 1);
+	while (atomic_load(word) == seen) {
+		pthread_cond_wait(&wait->cond, &wait->lock);
+	}
+	atomic_fetch_sub(&wait->sleepers, 1);
+	pthread_mutex_unlock(&wait->lock);
+}
+
+
+
+/*
+* publish(wait, word, value) -- stores 'value' in '*word' and wakes anyone sleeping on 'wait'.
+*/
+static void publish(struct waiter *wait, atomic_size_t *word, size_t value) {
+
+	atomic_store(word, value);
+
+	if (atomic_load(&wait->sleepers) > 0) {
+		pthread_mutex_lock(&wait->lock);
+		pthread_cond_broadcast(&wait->cond);
+		pthread_mutex_unlock(&wait->lock);
+	}
+}
+
+
+
+/*
+* initWaiter(wait) -- prepares 'wait' for use.
+*/
+static void initWaiter(struct waiter *wait) {
+
+	pthread_mutex_init(&wait->lock, NULL);
+	pthread_cond_init(&wait->cond, NULL);
+	atomic_init(&wait->sleepers, 0);
+}
+
+
+
+/*
+* destroyWaiter(wait) -- releases what initWaiter() set up.
+*/
+static void destroyWaiter(struct waiter *wait) {
+
+	pthread_mutex_destroy(&wait->lock);
+	pthread_cond_destroy(&wait->cond);
+}
+
+
+
+/*
+* queuePush(queue, item) -- appends 'item' to 'queue'.
+*/
+static void queuePush(struct chunkQueue *queue, struct chunk item) {
+
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+	queue->slots[tail % CHUNK_COUNT] = item;
+	publish(&queue->wait, &queue->tail, tail + 1);
+}
+
+
+
+/*
+* queueTryPop(queue, item) -- removes the oldest chunk in 'queue' into '*item' without waiting.
+* Returns 1 if there was one, 0 if the queue is empty.
+*/
+static int queueTryPop(struct chunkQueue *queue, struct chunk *item) {
+
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+	if (atomic_load_explicit(&queue->tail, memory_order_acquire) == head) {
+		return 0;
+	}
+
+	*item = queue->slots[head % CHUNK_COUNT];
+	publish(&queue->wait, &queue->head, head + 1);
+	return 1;
+}
+
+
+
+/*
+* queuePop(queue) -- removes and returns the oldest chunk in 'queue', waiting for one if needed.
+*/
+static struct chunk queuePop(struct chunkQueue *queue) {
+
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+	if (atomic_load_explicit(&queue->tail, memory_order_acquire) == head) {
+		waitChange(&queue->wait, &queue->tail, head);
+	}
+
+	struct chunk item = queue->slots[head % CHUNK_COUNT];
+	publish(&queue->wait, &queue->head, head + 1);
+	return item;
+}
+
+
+
+/*
+* readerThread(arg) -- reads the input a chunk at a time into the buffers the parser has handed
+* back, until the end of the input or a read error, which it passes on as the last chunk.
+*/
+static void * readerThread(void *arg) {
+
+	struct pipeline *pipe = arg;
+
+	while (1) {
+
+		struct chunk item = queuePop(&pipe->empty);
+		ssize_t got;
+
+		do {
+			got = read(pipe->fd, item.data, CHUNK_SIZE);
+		} while (got < 0 && errno == EINTR);
+
+		item.len = got > 0 ? got : 0;
+		item.status = got > 0 ? 0 : (got == 0 ? 1 : -1);
+		queuePush(&pipe->full, item);
+
+		if (item.status != 0) {
+			return NULL;
+		}
+	}
+}
+
+
+
+/*
+* ringReaderThread(arg) -- the reader thread when io_uring is available: reads the input into the
+* registered chunk buffers and passes them on in input order, ending as readerThread() does. Input
+* that can seek keeps a read going into every buffer the parser has handed back, each at its own
+* offset; a pipe has no offsets, so it has one read going at a time. New reads are submitted with
+* the same system call that waits for the next one to finish.
+*/
+static void * ringReaderThread(void *arg) {
+
+	struct pipeline *pipe = arg;
+	struct chunk reads[CHUNK_COUNT];
+	int done[CHUNK_COUNT] = { 0 };
+	size_t submitted = 0;
+	size_t passed = 0;
+	off_t offset = pipe->offset;
+	int ended = 0;
+	int shortRead = 0;
+
+	// READS ARE NUMBERED AS SUBMITTED, AND PASSED ON BY NUMBER WHATEVER ORDER THEY FINISH IN
+	while (passed < submitted || !ended) {
+
+		while (!ended && submitted - passed < CHUNK_COUNT && (pipe->seekable || submitted == passed)) {
+
+			struct chunk item;
+
+			if (submitted == passed) {
+				item = queuePop(&pipe->empty);
+			} else if (!queueTryPop(&pipe->empty, &item)) {
+				break;
+			}
+
+			reads[submitted % CHUNK_COUNT] = item;
+			uringRead(&pipe->ring, pipe->fd, item.data, CHUNK_SIZE, (item.data - pipe->buffers) / CHUNK_SIZE,
+				  pipe->seekable ? offset : -1, submitted);
+			offset += CHUNK_SIZE;
+			submitted++;
+		}
+
+		uint64_t tag;
+		int result;
+
+		if (uringSubmit(&pipe->ring, 1) != 0) {
+			if (!ended) {
+				struct chunk failed = { NULL, 0, -1 };
+				queuePush(&pipe->full, failed);
+			}
+			return NULL;
+		}
+
+		while (uringReap(&pipe->ring, &tag, &result)) {
+			struct chunk *item = &reads[tag % CHUNK_COUNT];
+			item->len = result > 0 ? result : 0;
+			item->status = result > 0 ? 0 : (result == 0 ? 1 : -1);
+			done[tag % CHUNK_COUNT] = 1;
+		}
+
+		while (passed < submitted && done[passed % CHUNK_COUNT]) {
+
+			struct chunk item = reads[passed % CHUNK_COUNT];
+
+			done[passed % CHUNK_COUNT] = 0;
+			passed++;
+
+			// ONCE THE LAST CHUNK IS PASSED ON, READS STILL GOING ARE ONLY WAITED FOR
+			if (ended) {
+				continue;
+			}
+
+			// A FILE ONLY READS SHORT AT ITS END, SO DATA AFTER A SHORT READ WOULD LEAVE A GAP
+			if (item.status == 0 && shortRead) {
+				item.status = -1;
+			}
+			shortRead = shortRead || (pipe->seekable && item.len < CHUNK_SIZE);
+
+			queuePush(&pipe->full, item);
+			ended = item.status != 0;
+		}
+	}
+	return NULL;
+}
+
+
+
+/*
+* reserveRecord(ring, size) -- returns room for a 'size' byte record at the ring's tail, waiting
+* for the executor to free space and padding out the end of the ring with a RECORD_SKIP when the
+* record would not fit before it wraps.
+*/
+static struct commandRecord * reserveRecord(struct recordRing *ring, size_t size) {
+
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t room = RECORD_RING_SIZE - tail % RECORD_RING_SIZE;
+
+	if (room < size) {
+		size_t head;
+		while (tail + room - (head = atomic_load_explicit(&ring->head, memory_order_acquire)) > RECORD_RING_SIZE) {
+			waitChange(&ring->wait, &ring->head, head);
+		}
+
+		struct commandRecord *skip = (struct commandRecord *) (ring->data + tail % RECORD_RING_SIZE);
+		skip->size = room;
+		skip->kind = RECORD_SKIP;
+		tail += room;
+		publish(&ring->wait, &ring->tail, tail);
+	}
+
+	size_t head;
+	while (tail + size - (head = atomic_load_explicit(&ring->head, memory_order_acquire)) > RECORD_RING_SIZE) {
+		waitChange(&ring->wait, &ring->head, head);
+	}
+	return (struct commandRecord *) (ring->data + tail % RECORD_RING_SIZE);
+}
+
+
+
+/*
+* commitRecord(ring, size) -- hands the record just written at the ring's tail to the executor.
+*/
+static void commitRecord(struct recordRing *ring, size_t size) {
+
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	publish(&ring->wait, &ring->tail, tail + size);
+}
+
+
+
+/*
+* emitLine(pipe, line, len) -- tokenizes one input line and, unless it is blank, packs it into a
+* command record. The line's bytes are copied after the word views, which are rebased onto the
+* copy. Returns 0 on success, 1 if out of memory.
+*/
+static int emitLine(struct pipeline *pipe, const char *line, size_t len) {
+
+	uint64_t start = statsBegin();
+	size_t count = tokenize(line, len, &pipe->words, &pipe->wordCap);
+
+	statsEnd(STAT_PARSE, start);
+	if (count == 0) {
+		return 0;
+	}
+
+	size_t body = count * sizeof(struct token) + len;
+	size_t size = (sizeof(struct commandRecord) + body + RECORD_ALIGN - 1) & ~(size_t) (RECORD_ALIGN - 1);
+	int large = size > RECORD_RING_SIZE / 4;
+	struct commandRecord *record = reserveRecord(&pipe->records, large ? sizeof(struct commandRecord) : size);
+	char *words = large ? malloc(body) : (char *) (record + 1);
+
+	if (words == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	struct token *views = (struct token *) words;
+	char *bytes = words + count * sizeof(struct token);
+
+	memcpy(bytes, line, len);
+	for (size_t i = 0; i < count; i++) {
+		views[i].ptr = bytes + (pipe->words[i].ptr - line);
+		views[i].len = pipe->words[i].len;
+	}
+
+	record->kind = RECORD_COMMAND;
+	record->count = count;
+	record->large = large ? words : NULL;
+	record->size = large ? sizeof(struct commandRecord) : size;
+	commitRecord(&pipe->records, record->size);
+	return 0;
+}
+
+
+
+/*
+* carryAppend(pipe, bytes, len) -- adds 'len' bytes to the partial line carried over from the last
+* chunk. Returns 0 on success, 1 if out of memory.
+*/
+static int carryAppend(struct pipeline *pipe, const char *bytes, size_t len) {
+
+	if (growArray((void **) &pipe->carry, &pipe->carryCap, 1, pipe->carryLen + len) != 0) {
+		return 1;
+	}
+	memcpy(pipe->carry + pipe->carryLen, bytes, len);
+	pipe->carryLen += len;
+	return 0;
+}
+
+
+
+/*
+* parseChunk(pipe, data, len) -- emits every complete line in a chunk. A line started in an
+* earlier chunk is finished from the carry buffer first, and the unfinished line at the end is
+* carried into the next one. Returns 0 on success, 1 if out of memory.
+*/
+static int parseChunk(struct pipeline *pipe, const char *data, size_t len) {
+
+	const char *pos = data;
+	const char *end = data + len;
+
+	while (pos < end) {
+
+		const char *newline = scanNewline(pos, end);
+
+		if (newline == end) {
+			return carryAppend(pipe, pos, end - pos);
+		}
+
+		if (pipe->carryLen > 0) {
+			if (carryAppend(pipe, pos, newline - pos) != 0 || emitLine(pipe, pipe->carry, pipe->carryLen) != 0) {
+				return 1;
+			}
+			pipe->carryLen = 0;
+		} else if (emitLine(pipe, pos, newline - pos) != 0) {
+			return 1;
+		}
+		pos = newline + 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* parserThread(arg) -- turns the chunks from the reader into command records until the input ends,
+* then sends a RECORD_END holding 0, or -1 after a read error or running out of memory.
+*/
+static void * parserThread(void *arg) {
+
+	struct pipeline *pipe = arg;
+	int status = 0;
+
+	while (1) {
+
+		struct chunk item = queuePop(&pipe->full);
+
+		if (item.status != 0) {
+			status = item.status < 0 ? -1 : status;
+			break;
+		}
+
+		int failed = parseChunk(pipe, item.data, item.len);
+		queuePush(&pipe->empty, item);
+
+		if (failed) {
+			status = -1;
+			break;
+		}
+	}
+
+	// After a failure keep handing buffers back until the reader has finished, so it can be joined.
+	while (status < 0) {
+		struct chunk item = queuePop(&pipe->full);
+		if (item.status != 0) {
+			break;
+		}
+		queuePush(&pipe->empty, item);
+	}
+
+	// The last line needs no newline, as with the ordinary reader.
+	if (status == 0 && pipe->carryLen > 0 && emitLine(pipe, pipe->carry, pipe->carryLen) != 0) {
+		status = -1;
+	}
+
+	struct commandRecord *record = reserveRecord(&pipe->records, sizeof(struct commandRecord));
+	record->size = sizeof(struct commandRecord);
+	record->kind = RECORD_END;
+	record->status = status;
+	commitRecord(&pipe->records, record->size);
+	return NULL;
+}
+
+
+
+/*
+* pipelineRun(fd, bulkMode, errSeen) -- runs every command read from 'fd' through the reader and
+* parser threads, executing them on the calling thread in input order with runCommand() and adding
+* their errors to '*errSeen'. Returns 0 at the end of the input and -1 on a read error or if the
+* pipeline could not be started.
+*/
+int pipelineRun(int fd, int bulkMode, int *errSeen) {
+
+	struct pipeline *pipe = calloc(1, sizeof(struct pipeline));
+	char *buffers = malloc((size_t) CHUNK_COUNT * CHUNK_SIZE);
+	char *ring = malloc(RECORD_RING_SIZE);
+
+	if (pipe == NULL || buffers == NULL || ring == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		free(pipe);
+		free(buffers);
+		free(ring);
+		return -1;
+	}
+
+	pipe->fd = fd;
+	pipe->buffers = buffers;
+	pipe->records.data = ring;
+	initWaiter(&pipe->empty.wait);
+	initWaiter(&pipe->full.wait);
+	initWaiter(&pipe->records.wait);
+
+	struct iovec chunks[CHUNK_COUNT];
+
+	for (int i = 0; i < CHUNK_COUNT; i++) {
+		struct chunk item = { buffers + (size_t) i * CHUNK_SIZE, 0, 0 };
+		queuePush(&pipe->empty, item);
+		chunks[i].iov_base = item.data;
+		chunks[i].iov_len = CHUNK_SIZE;
+	}
+
+	// WITHOUT IO_URING, OR IF THE BUFFERS CAN'T BE REGISTERED, THE READER USES PLAIN read()
+	if (uringInit(&pipe->ring, CHUNK_COUNT) == 0) {
+		pipe->ringReady = uringRegister(&pipe->ring, chunks, CHUNK_COUNT) == 0;
+		if (!pipe->ringReady) {
+			uringFree(&pipe->ring);
+		}
+	}
+	pipe->offset = lseek(fd, 0, SEEK_CUR);
+	pipe->seekable = pipe->offset >= 0;
+
+	// Pick the scanner before the parser thread starts sharing it.
+	scanSetLevel(-1);
+
+	pthread_t reader;
+	pthread_t parser;
+	int started = 0;
+	int status = 0;
+
+	if (pthread_create(&reader, NULL, pipe->ringReady ? ringReaderThread : readerThread, pipe) == 0) {
+		started++;
+		if (pthread_create(&parser, NULL, parserThread, pipe) == 0) {
+			started++;
+		}
+	}
+
+	if (started < 2) {
+		fprintf(stderr, "Couldn't start the input threads.\n");
+		status = -1;
+		if (started == 1) {
+			pthread_cancel(reader);
+		}
+	}
+
+	while (status == 0) {
+
+		struct recordRing *records = &pipe->records;
+		size_t head = atomic_load_explicit(&records->head, memory_order_relaxed);
+
+		if (atomic_load_explicit(&records->tail, memory_order_acquire) == head) {
+			waitChange(&records->wait, &records->tail, head);
+		}
+
+		struct commandRecord *record = (struct commandRecord *) (records->data + head % RECORD_RING_SIZE);
+
+		if (record->kind == RECORD_END) {
+			status = record->status;
+			break;
+		}
+
+		if (record->kind == RECORD_COMMAND) {
+			struct token *words = record->large != NULL ? record->large : (struct token *) (record + 1);
+			*errSeen += runCommand(words, record->count, bulkMode);
+			outputEndLine(resultOut);
+			free(record->large);
+		}
+
+		publish(&records->wait, &records->head, head + record->size);
+	}
+
+	if (started == 2) {
+		pthread_join(parser, NULL);
+	}
+	if (started >= 1) {
+		pthread_join(reader, NULL);
+	}
+
+	if (pipe->ringReady) {
+		uringFree(&pipe->ring);
+	}
+	destroyWaiter(&pipe->empty.wait);
+	destroyWaiter(&pipe->full.wait);
+	destroyWaiter(&pipe->records.wait);
+	free(pipe->carry);
+	free(pipe->words);
+	free(pipe);
+	free(buffers);
+	free(ring);
+	return status;
+}
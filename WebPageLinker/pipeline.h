@@ -0,0 +1,22 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+
+/*
+ * File: pipeline.h
+ * Author: Chance Krueger
+ * Purpose: Pipelined execution of streamed input. When commands arrive through a
+ *          pipe, one thread reads the input in large chunks, a second splits it
+ *          into lines and tokens and packs each command into a compact record in
+ *          a lock-free single-producer/single-consumer ring, and the calling thread
+ *          runs the records in order. Reading, parsing and graph work overlap, while
+ *          results and errors come out exactly as from the one-line-at-a-time loop.
+ *          Where io_uring is available the reader keeps reads going into registered
+ *          chunk buffers ahead of the parser instead of calling read().
+ */
+
+
+
+int pipelineRun(int fd, int bulkMode, int *errSeen);
+
+#endif
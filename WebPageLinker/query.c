@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "WebPageLinker.h"
+#include "binproto.h"
+#include "query.h"
+
+
+/*
+ * File: query.c
+ * Author: Chance Krueger
+ * Purpose: Implements the batched, multi-threaded @isConnected execution described
+ *          in query.h.
+ */
+
+
+
+#define MAX_QUERY_THREADS 64
+#define QUERY_BATCH_MAX 8192
+#define QUERY_PARALLEL_MIN 64
+#define QUERY_BLOCK 16
+
+enum queryKind {
+	QUERY_PAGES,
+	QUERY_VIEW,
+	QUERY_FAILED
+};
+
+
+
+/*
+ * pendingQuery -- One query waiting for the next flush. A QUERY_PAGES query names
+ * its pages in the list graph by pointer until the flush numbers them; a QUERY_VIEW
+ * one holds page numbers of the open view. `result` is filled in by the search.
+ */
+struct pendingQuery {
+
+
+	enum queryKind kind;
+	union {
+		struct page *page;
+		uint32_t id;
+	} from, to;
+	int result;
+};
+
+
+
+/*
+ * listGraph -- The list graph seen as a view, for the length of one flush: `pages[i]`
+ * is the page numbered i in `id`, tombstones included.
+ */
+struct listGraph {
+
+
+	struct page **pages;
+	size_t cap;
+};
+
+
+
+/*
+ * queryPool -- The worker threads and the batch they share. A flush fills `batch`,
+ * bumps `generation` and wakes the workers; each claims QUERY_BLOCK queries at a time
+ * through `next`, searching with its own entry of `scratch`, and the last one to
+ * finish signals `finished`.
+ */
+struct queryPool {
+
+
+	pthread_t threads[MAX_QUERY_THREADS];
+	struct viewScratch scratch[MAX_QUERY_THREADS];
+	size_t threadCount;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t finished;
+	unsigned long generation;
+	size_t running;
+	int stopping;
+	atomic_size_t next;
+	const struct graphView *view;
+};
+
+static struct pendingQuery *batch = NULL;
+static size_t batchCount = 0;
+static size_t batchCap = 0;
+static const struct graphView *batchView = NULL;
+static int batching = 0;
+static struct queryPool pool;
+static struct viewScratch queryScratch;
+static struct listGraph list;
+
+
+
+/*
+* listLookup(impl, name) -- viewOps lookup for the list graph.
+*/
+static int64_t listLookup(const void *impl, struct token name) {
+
+	struct page *node = findNode(name);
+
+	return node == NULL ? -1 : node->id;
+}
+
+
+
+/*
+* listSuccessors(impl, page, scratch, out) -- viewOps successors for the list graph: copies the
+* numbers of the live pages that 'page' links to into `scratch->buf`.
+*/
+static uint32_t listSuccessors(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out) {
+
+	const struct listGraph *graph = impl;
+	uint32_t count = 0;
+
+	if (scratchReserveBuf(scratch, graph->pages[page]->outCount) != 0) {
+		return 0;
+	}
+
+	for (struct link *edge = graph->pages[page]->edges; edge != NULL; edge = edge->next) {
+		if (edge->to == NULL || edge->to->removed) {
+			continue;
+		}
+		if (count == scratch->bufCap && scratchReserveBuf(scratch, count + 1) != 0) {
+			return 0;
+		}
+		scratch->buf[count++] = edge->to->id;
+	}
+
+	*out = scratch->buf;
+	return count;
+}
+
+static const struct viewOps listOps = { "list graph", listLookup, listSuccessors, NULL, NULL, NULL, NULL };
+
+
+
+/*
+* numberPages(view) -- numbers every page of the list graph in list order and makes 'view' a view
+* of it. Returns 0 on success, 1 if out of memory.
+*/
+static int numberPages(struct graphView *view) {
+
+	size_t count = 0;
+
+	if (growArray((void **) &list.pages, &list.cap, sizeof(struct page *), pageCount) != 0) {
+		return 1;
+	}
+
+	for (struct page *cur = graphHead; cur != NULL; cur = cur->next) {
+		cur->id = count;
+		list.pages[count++] = cur;
+	}
+
+	view->ops = &listOps;
+	view->impl = &list;
+	view->pageCount = count;
+	return 0;
+}
+
+
+
+/*
+* searchBlocks(view, scratch) -- answers blocks of the batch until none are left unclaimed.
+*/
+static void searchBlocks(const struct graphView *view, struct viewScratch *scratch) {
+
+	size_t start;
+
+	while ((start = atomic_fetch_add(&pool.next, QUERY_BLOCK)) < batchCount) {
+
+		size_t end = start + QUERY_BLOCK < batchCount ? start + QUERY_BLOCK : batchCount;
+
+		for (size_t i = start; i < end; i++) {
+			if (batch[i].kind != QUERY_FAILED) {
+				batch[i].result = viewReachable(view, batch[i].from.id, batch[i].to.id, scratch);
+			}
+		}
+	}
+}
+
+
+
+/*
+* queryWorker(arg) -- a pool thread: waits for each new batch and helps search it.
+*/
+static void * queryWorker(void *arg) {
+
+	struct viewScratch *scratch = arg;
+	unsigned long seen = 0;
+
+	while (1) {
+
+		pthread_mutex_lock(&pool.lock);
+		while (!pool.stopping && pool.generation == seen) {
+			pthread_cond_wait(&pool.start, &pool.lock);
+		}
+		if (pool.stopping) {
+			pthread_mutex_unlock(&pool.lock);
+			return NULL;
+		}
+		seen = pool.generation;
+		pthread_mutex_unlock(&pool.lock);
+
+		searchBlocks(pool.view, scratch);
+
+		pthread_mutex_lock(&pool.lock);
+		if (--pool.running == 0) {
+			pthread_cond_signal(&pool.finished);
+		}
+		pthread_mutex_unlock(&pool.lock);
+	}
+}
+
+
+
+/*
+* queryStart(threads) -- starts collecting runs of queries, to be searched by up to 'threads'
+* threads counting this one. Returns 0 on success; if no worker can be started the queries are
+* still collected and searched by this thread alone.
+*/
+int queryStart(int threads) {
+
+	memset(&pool, 0, sizeof(pool));
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.start, NULL);
+	pthread_cond_init(&pool.finished, NULL);
+
+	threads = threads > MAX_QUERY_THREADS ? MAX_QUERY_THREADS : threads;
+
+	while ((int) pool.threadCount + 1 < threads &&
+	       pthread_create(&pool.threads[pool.threadCount], NULL, queryWorker,
+			      &pool.scratch[pool.threadCount]) == 0) {
+		pool.threadCount++;
+	}
+
+	batching = 1;
+	return 0;
+}
+
+
+
+/*
+* queryFlush() -- searches every query collected so far, on the pool when there are enough of them,
+* and writes their results in order. A query that failed writes nothing, or BIN_FAILED to binary
+* output. Returns the number of errors.
+*/
+int queryFlush(void) {
+
+	struct graphView pagesView;
+	const struct graphView *view = batchView;
+	int errSeen = 0;
+
+	if (batchCount == 0) {
+		return 0;
+	}
+
+	// PAGES ARE NUMBERED ONCE PER BATCH, NOT UNMARKED AFTER EVERY SEARCH
+	for (size_t i = 0; view == NULL && i < batchCount; i++) {
+		if (batch[i].kind == QUERY_PAGES && numberPages(&pagesView) == 0) {
+			view = &pagesView;
+		}
+	}
+
+	for (size_t i = 0; view == &pagesView && i < batchCount; i++) {
+		if (batch[i].kind == QUERY_PAGES) {
+			batch[i].from.id = batch[i].from.page->id;
+			batch[i].to.id = batch[i].to.page->id;
+		}
+	}
+
+	atomic_store(&pool.next, 0);
+
+	if (view != NULL && pool.threadCount > 0 && batchCount >= QUERY_PARALLEL_MIN) {
+		pthread_mutex_lock(&pool.lock);
+		pool.view = view;
+		pool.generation++;
+		pool.running = pool.threadCount;
+		pthread_cond_broadcast(&pool.start);
+		pthread_mutex_unlock(&pool.lock);
+
+		searchBlocks(view, &queryScratch);
+
+		pthread_mutex_lock(&pool.lock);
+		while (pool.running > 0) {
+			pthread_cond_wait(&pool.finished, &pool.lock);
+		}
+		pthread_mutex_unlock(&pool.lock);
+	} else if (view != NULL) {
+		searchBlocks(view, &queryScratch);
+	}
+
+	for (size_t i = 0; i < batchCount; i++) {
+
+		if (batch[i].kind != QUERY_FAILED && batch[i].result >= 0) {
+			outputInt(resultOut, batch[i].result);
+			continue;
+		}
+		if (batch[i].kind != QUERY_FAILED) {
+			errSeen++;
+		}
+		if (resultOut->binary) {
+			outputInt(resultOut, BIN_FAILED);
+		}
+	}
+
+	batchCount = 0;
+	batchView = NULL;
+	return errSeen;
+}
+
+
+
+/*
+* addQuery(kind) -- appends a query of 'kind' to the batch and returns it, or NULL if out of memory.
+*/
+static struct pendingQuery * addQuery(enum queryKind kind) {
+
+	if (growArray((void **) &batch, &batchCap, sizeof(struct pendingQuery), batchCount + 1) != 0) {
+		return NULL;
+	}
+
+	struct pendingQuery *query = &batch[batchCount++];
+	query->kind = kind;
+	query->result = -1;
+	return query;
+}
+
+
+
+/*
+* finishQuery() -- answers the batch right away when queries aren't being collected, or once it
+* is full. Returns the number of errors.
+*/
+static int finishQuery(void) {
+
+	if (!batching || batchCount >= QUERY_BATCH_MAX) {
+		return queryFlush();
+	}
+	return 0;
+}
+
+
+
+/*
+* queryPages(from, to) -- asks whether page 'to' of the list graph can be reached from page 'from'.
+* Returns the number of errors.
+*/
+int queryPages(struct page *from, struct page *to) {
+
+	int errSeen = batchView != NULL ? queryFlush() : 0;
+	struct pendingQuery *query = addQuery(QUERY_PAGES);
+
+	if (query == NULL) {
+		return errSeen + 1;
+	}
+	query->from.page = from;
+	query->to.page = to;
+	return errSeen + finishQuery();
+}
+
+
+
+/*
+* queryView(view, from, to) -- asks whether the page named 'to' can be reached from the page named
+* 'from' in the read-only 'view', reporting names the view doesn't have. Returns the number of errors.
+*/
+int queryView(const struct graphView *view, struct token from, struct token to) {
+
+	int errSeen = 0;
+
+	for (size_t i = 0; view != batchView && i < batchCount; i++) {
+		if (batch[i].kind != QUERY_FAILED) {
+			errSeen += queryFlush();
+			break;
+		}
+	}
+
+	int64_t nodeOne = view->ops->lookup(view->impl, from);
+	int64_t nodeTwo = view->ops->lookup(view->impl, to);
+
+	if (nodeOne < 0 || nodeTwo < 0) {
+		fprintf(stderr, "Either Page does not Exist.\n");
+		return errSeen + 1 + queryFailed();
+	}
+
+	struct pendingQuery *query = addQuery(QUERY_VIEW);
+
+	if (query == NULL) {
+		return errSeen + 1;
+	}
+	query->from.id = nodeOne;
+	query->to.id = nodeTwo;
+	batchView = view;
+	return errSeen + finishQuery();
+}
+
+
+
+/*
+* queryFailed() -- records a query that was rejected, so binary output still gets its result byte
+* in the right place. Returns the number of errors.
+*/
+int queryFailed(void) {
+
+	if (addQuery(QUERY_FAILED) == NULL) {
+		return 1;
+	}
+	return finishQuery();
+}
+
+
+
+/*
+* queryStop() -- answers the queries still collected, stops the pool and frees what the searches
+* used. It may be called without queryStart(). Returns the number of errors.
+*/
+int queryStop(void) {
+
+	int errSeen = queryFlush();
+
+	if (batching) {
+		pthread_mutex_lock(&pool.lock);
+		pool.stopping = 1;
+		pthread_cond_broadcast(&pool.start);
+		pthread_mutex_unlock(&pool.lock);
+
+		for (size_t i = 0; i < pool.threadCount; i++) {
+			pthread_join(pool.threads[i], NULL);
+			scratchFree(&pool.scratch[i]);
+		}
+
+		pthread_mutex_destroy(&pool.lock);
+		pthread_cond_destroy(&pool.start);
+		pthread_cond_destroy(&pool.finished);
+		pool.threadCount = 0;
+		batching = 0;
+	}
+
+	free(batch);
+	free(list.pages);
+	scratchFree(&queryScratch);
+	batch = NULL;
+	batchCap = 0;
+	list.pages = NULL;
+	list.cap = 0;
+	return errSeen;
+}
@@ -0,0 +1,29 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "WebPageLinker.h"
+#include "view.h"
+
+
+/*
+ * File: query.h
+ * Author: Chance Krueger
+ * Purpose: @isConnected execution. Between queryStart() and queryStop(), runs of
+ *          consecutive queries are collected instead of answered one by one, and
+ *          queryFlush() (called by the next command that isn't a query) spreads
+ *          the run over a pool of threads. Every thread searches with visited
+ *          marks of its own, so the graph is only read, and the results are
+ *          written in the order the queries came in. Outside a run, each query
+ *          is answered as soon as it is made.
+ */
+
+
+
+int queryStart(int threads);
+int queryPages(struct page *from, struct page *to);
+int queryView(const struct graphView *view, struct token from, struct token to);
+int queryFailed(void);
+int queryFlush(void);
+int queryStop(void);
+
+#endif
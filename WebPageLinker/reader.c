@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "compressed.h"
+
+
+/*
+ * File: reader.c
+ * Author: Chance Krueger
+ * Purpose: Implements the zero-copy line reader and tokenizer declared in reader.h.
+ *          Steady-state parsing does no heap allocation: lines are views into the
+ *          mapped file or the read buffer, and the token array is reused.
+ */
+
+
+
+#define READ_BUFFER_SIZE (1 << 20)
+
+
+
+/*
+* readerOpen(reader, path) -- prepares 'reader' to read the file at 'path', or stdin if 'path' is NULL.
+* A non-empty regular file is mapped read-only in one piece; anything else (pipes, terminals)
+* falls back to read() into a reusable buffer, and so does a gzip or zstd file, through the pipe its
+* decompression thread fills. Returns 0 on success, 1 if the file can't be opened or decompressed.
+*/
+int readerOpen(struct lineReader *reader, const char *path) {
+
+	memset(reader, 0, sizeof(struct lineReader));
+	reader->fd = path == NULL ? STDIN_FILENO : open(path, O_RDONLY);
+
+	if (reader->fd < 0) {
+		return 1;
+	}
+
+	struct stat info;
+
+	if (fstat(reader->fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+		void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, info.st_size, MADV_SEQUENTIAL);
+			reader->map = map;
+			reader->mapLen = info.st_size;
+		}
+	}
+
+	if (compressedOpen(reader) != 0) {
+		readerClose(reader);
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* fillBuffer(reader) -- moves the unread tail of the read buffer to its front, growing the
+* buffer if a single line fills it, and reads more input after it. Sets `eof` when the
+* input is exhausted. Returns 0 on success, 1 on a read error or if out of memory.
+*/
+int fillBuffer(struct lineReader *reader) {
+
+	if (reader->start > 0) {
+		memmove(reader->buf, reader->buf + reader->start, reader->end - reader->start);
+		reader->end -= reader->start;
+		reader->start = 0;
+	}
+
+	if (reader->end == reader->bufCap) {
+		size_t newCap = reader->bufCap == 0 ? READ_BUFFER_SIZE : reader->bufCap * 2;
+		char *grown = realloc(reader->buf, newCap);
+		if (grown == NULL) {
+			fprintf(stderr, "Ran Out Of Memory.\n");
+			return 1;
+		}
+		reader->buf = grown;
+		reader->bufCap = newCap;
+	}
+
+	ssize_t got = read(reader->fd, reader->buf + reader->end, reader->bufCap - reader->end);
+
+	if (got < 0) {
+		return 1;
+	}
+	if (got == 0) {
+		reader->eof = 1;
+	}
+	reader->end += got;
+	return 0;
+}
+
+
+
+/*
+* readerNext(reader, line, len) -- stores a view of the next input line, without its newline,
+* in '*line' and '*len'. Returns 1 if a line was produced, 0 at end of input and -1 on error.
+*/
+int readerNext(struct lineReader *reader, const char **line, size_t *len) {
+
+	if (reader->map != NULL) {
+
+		if (reader->pos >= reader->mapLen) {
+			return 0;
+		}
+
+		const char *begin = reader->map + reader->pos;
+		const char *newline = scanNewline(begin, reader->map + reader->mapLen);
+
+		*line = begin;
+		*len = newline - begin;
+		reader->pos += *len + 1;
+		return 1;
+	}
+
+	while (1) {
+
+		char *begin = reader->buf + reader->start;
+		char *end = reader->buf + reader->end;
+		const char *newline = scanNewline(begin, end);
+
+		if (newline < end || (reader->eof && end > begin)) {
+			*line = begin;
+			*len = newline - begin;
+			reader->start += *len + (newline < end);
+			return 1;
+		}
+
+		if (reader->eof) {
+			return 0;
+		}
+
+		if (fillBuffer(reader) != 0) {
+			return -1;
+		}
+	}
+}
+
+
+
+/*
+* readerTake(reader, len, bytes) -- stores a view of the next 'len' input bytes, wherever the line
+* breaks fall, in '*bytes'. Returns 1 if they were produced, 0 at the end of input and -1 on error
+* or if the input ends part way through them.
+*/
+int readerTake(struct lineReader *reader, size_t len, const char **bytes) {
+
+	if (reader->map != NULL) {
+
+		if (reader->pos >= reader->mapLen) {
+			return 0;
+		}
+		if (reader->mapLen - reader->pos < len) {
+			return -1;
+		}
+
+		*bytes = reader->map + reader->pos;
+		reader->pos += len;
+		return 1;
+	}
+
+	while (reader->end - reader->start < len && !reader->eof) {
+		if (fillBuffer(reader) != 0) {
+			return -1;
+		}
+	}
+
+	if (reader->end - reader->start < len) {
+		return reader->end == reader->start ? 0 : -1;
+	}
+
+	*bytes = reader->buf + reader->start;
+	reader->start += len;
+	return 1;
+}
+
+
+
+/*
+* readerClose(reader) -- unmaps or frees the reader's input and closes its file. Returns 0, or 1 if
+* it was compressed and turned out to be damaged.
+*/
+int readerClose(struct lineReader *reader) {
+
+	if (reader->map != NULL) {
+		munmap(reader->map, reader->mapLen);
+	}
+	free(reader->buf);
+
+	if (reader->fd > STDIN_FILENO) {
+		close(reader->fd);
+	}
+	return compressedClose(reader);
+}
+
+
+
+/*
+* tokenize(line, len, tokens, cap) -- splits the 'len' bytes at 'line' into whitespace separated
+* words with scanTokens(), storing a view of each into the array '*tokens' of capacity '*cap'.
+* The array is grown (and kept for the next call) only when a line has more words than fit.
+* Returns the number of words, or 0 if the line is blank or the array could not be grown.
+*/
+size_t tokenize(const char *line, size_t len, struct token **tokens, size_t *cap) {
+
+	size_t count = scanTokens(line, len, *tokens, *cap);
+
+	if (count > *cap) {
+		size_t newCap = *cap == 0 ? 64 : *cap;
+		while (newCap < count) {
+			newCap *= 2;
+		}
+
+		struct token *grown = realloc(*tokens, newCap * sizeof(struct token));
+		if (grown == NULL) {
+			fprintf(stderr, "Ran Out Of Memory.\n");
+			return 0;
+		}
+		*tokens = grown;
+		*cap = newCap;
+		scanTokens(line, len, *tokens, *cap);
+	}
+	return count;
+}
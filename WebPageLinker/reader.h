@@ -0,0 +1,49 @@
+#ifndef READER_H
+#define READER_H
+
+#include <stddef.h>
+
+#include "scan.h"
+
+
+/*
+ * File: reader.h
+ * Author: Chance Krueger
+ * Purpose: Zero-copy command input. A lineReader hands out each input line as a
+ *          view into either the mmapped input file or one reusable read buffer,
+ *          and tokenize() splits a line into views without copying any bytes.
+ *          The byte scanning itself lives in scan.c.
+ */
+
+
+
+/*
+ * lineReader -- Input state for one command stream. Regular files are mapped
+ * whole into `map`; pipes and terminals are read into the growable buffer `buf`,
+ * whose bytes between `start` and `end` have not been handed out yet. A compressed
+ * file is read from the pipe its `decompressor` thread fills (see compressed.h).
+ */
+struct lineReader {
+
+
+	int fd;
+	char *map;
+	size_t mapLen;
+	size_t pos;
+	char *buf;
+	size_t bufCap;
+	size_t start;
+	size_t end;
+	int eof;
+	struct decompressor *decompressor;
+};
+
+
+
+int readerOpen(struct lineReader *reader, const char *path);
+int readerNext(struct lineReader *reader, const char **line, size_t *len);
+int readerTake(struct lineReader *reader, size_t len, const char **bytes);
+int readerClose(struct lineReader *reader);
+size_t tokenize(const char *line, size_t len, struct token **tokens, size_t *cap);
+
+#endif
@@ -0,0 +1,398 @@
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+#include "scan.h"
+
+
+/*
+ * File: scan.c
+ * Author: Chance Krueger
+ * Purpose: Implements the block-at-a-time scanners declared in scan.h. The SIMD
+ *          instruction sets share one token driver that works on 64-byte blocks:
+ *          each block is turned into a bitmask of whitespace bytes, and word
+ *          boundaries are the bit transitions of that mask.
+ */
+
+
+
+/*
+* isBlank(c) -- returns 1 for the whitespace characters that separate words (spaces, tabs,
+* newlines, vertical tabs, form feeds and carriage returns), otherwise 0.
+*/
+static inline int isBlank(unsigned char c) {
+
+	return c == ' ' || (unsigned char) (c - '\t') <= '\r' - '\t';
+}
+
+
+
+/*
+* blankMaskScalar(ptr, len) -- returns a bitmask with bit i set if byte i of the block at 'ptr'
+* is whitespace. Only 'len' (at most 64) bytes are read; the bits past them are set, so a word
+* running to the end of a line ends there.
+*/
+static inline uint64_t blankMaskScalar(const char *ptr, size_t len) {
+
+	uint64_t mask = len < 64 ? ~0ULL << len : 0;
+
+	for (size_t i = 0; i < len; i++) {
+		mask |= (uint64_t) isBlank(ptr[i]) << i;
+	}
+	return mask;
+}
+
+
+
+/*
+* sameBlockPage(ptr) -- returns 1 if the 64 bytes at 'ptr' lie in one 4 KiB page. Reading a
+* short line's tail as a whole block is then safe even past the end of the buffer, since memory
+* protection works on whole pages; the bytes past the line are masked off afterwards.
+*/
+static inline int sameBlockPage(const char *ptr) {
+
+	return ((uintptr_t) ptr & 4095) <= 4096 - 64;
+}
+
+
+
+/*
+* SCAN_TOKENS(name, blockMask, attr) -- defines the token driver 'name' on top of the 64-byte
+* mask function 'blockMask'. Word starts are clear bits whose previous bit is set and word ends
+* are the reverse; since they alternate, one pass over their union in position order yields
+* every word. `carry` holds the last bit of the previous block and `inWord` whether a word is open.
+*/
+#define SCAN_TOKENS(name, blockMask, attr)							\
+attr __attribute__((no_sanitize_address))						\
+static size_t name(const char *line, size_t len, struct token *tokens, size_t cap) {		\
+												\
+	size_t count = 0;									\
+	size_t start = 0;									\
+	uint64_t carry = 1;									\
+	int inWord = 0;										\
+												\
+	for (size_t base = 0; base < len; base += 64) {						\
+		uint64_t blank;									\
+		if (len - base >= 64) {								\
+			blank = blockMask(line + base);						\
+		} else if (sameBlockPage(line + base)) {					\
+			blank = blockMask(line + base) | ~0ULL << (len - base);			\
+		} else {									\
+			blank = blankMaskScalar(line + base, len - base);			\
+		}										\
+		uint64_t edges = blank ^ ((blank << 1) | carry);				\
+		carry = blank >> 63;								\
+												\
+		while (edges != 0) {								\
+			size_t pos = base + __builtin_ctzll(edges);				\
+			if (inWord) {								\
+				if (count < cap) {						\
+					tokens[count].ptr = line + start;			\
+					tokens[count].len = pos - start;			\
+				}								\
+				count++;							\
+			} else {								\
+				start = pos;							\
+			}									\
+			inWord ^= 1;								\
+			edges &= edges - 1;							\
+		}										\
+	}											\
+												\
+	if (inWord) {										\
+		if (count < cap) {								\
+			tokens[count].ptr = line + start;					\
+			tokens[count].len = len - start;					\
+		}										\
+		count++;									\
+	}											\
+	return count;										\
+}
+
+
+
+/*
+* scanTokensScalar(line, len, tokens, cap) -- the scalar fallback: a plain byte loop that
+* produces the same words as the block drivers.
+*/
+static size_t scanTokensScalar(const char *line, size_t len, struct token *tokens, size_t cap) {
+
+	size_t count = 0;
+	size_t i = 0;
+
+	while (i < len) {
+
+		while (i < len && isBlank(line[i])) {
+			i++;
+		}
+		if (i == len) {
+			break;
+		}
+
+		size_t start = i;
+		while (i < len && !isBlank(line[i])) {
+			i++;
+		}
+
+		if (count < cap) {
+			tokens[count].ptr = line + start;
+			tokens[count].len = i - start;
+		}
+		count++;
+	}
+	return count;
+}
+
+
+
+/*
+* newlineScalar(ptr, end) -- returns the first newline in [ptr, end), or 'end' if there is none.
+*/
+static const char * newlineScalar(const char *ptr, const char *end) {
+
+	while (ptr < end && *ptr != '\n') {
+		ptr++;
+	}
+	return ptr;
+}
+
+
+
+#ifdef SCAN_X86
+
+/*
+* blankBlockSse2(ptr) -- the SSE2 64-byte mask function. A byte is whitespace if it equals
+* a space, or if subtracting '\t' leaves it at most '\r' - '\t' (unsigned).
+*/
+__attribute__((target("sse2"), no_sanitize_address)) static inline uint64_t blankBlockSse2(const char *ptr) {
+
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i span = _mm_set1_epi8('\r' - '\t');
+	uint64_t mask = 0;
+
+	for (int i = 0; i < 4; i++) {
+		__m128i bytes = _mm_loadu_si128((const __m128i *) (ptr + 16 * i));
+		__m128i shifted = _mm_sub_epi8(bytes, tab);
+		__m128i blank = _mm_or_si128(_mm_cmpeq_epi8(bytes, space),
+			_mm_cmpeq_epi8(_mm_min_epu8(shifted, span), shifted));
+		mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(blank) << (16 * i);
+	}
+	return mask;
+}
+
+SCAN_TOKENS(scanTokensSse2, blankBlockSse2, __attribute__((target("sse2"))))
+
+
+
+/*
+* newlineSse2(ptr, end) -- newlineScalar() 16 bytes at a time.
+*/
+__attribute__((target("sse2"))) static const char * newlineSse2(const char *ptr, const char *end) {
+
+	const __m128i newline = _mm_set1_epi8('\n');
+
+	while (end - ptr >= 16) {
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) ptr), newline));
+		if (mask != 0) {
+			return ptr + __builtin_ctz(mask);
+		}
+		ptr += 16;
+	}
+	return newlineScalar(ptr, end);
+}
+
+
+
+/*
+* blankBlockAvx2(ptr) -- blankBlockSse2() on two 32-byte vectors.
+*/
+__attribute__((target("avx2"), no_sanitize_address)) static inline uint64_t blankBlockAvx2(const char *ptr) {
+
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i span = _mm256_set1_epi8('\r' - '\t');
+	uint64_t mask = 0;
+
+	for (int i = 0; i < 2; i++) {
+		__m256i bytes = _mm256_loadu_si256((const __m256i *) (ptr + 32 * i));
+		__m256i shifted = _mm256_sub_epi8(bytes, tab);
+		__m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space),
+			_mm256_cmpeq_epi8(_mm256_min_epu8(shifted, span), shifted));
+		mask |= (uint64_t) (uint32_t) _mm256_movemask_epi8(blank) << (32 * i);
+	}
+	return mask;
+}
+
+SCAN_TOKENS(scanTokensAvx2, blankBlockAvx2, __attribute__((target("avx2"))))
+
+
+
+/*
+* newlineAvx2(ptr, end) -- newlineScalar() 32 bytes at a time.
+*/
+__attribute__((target("avx2"))) static const char * newlineAvx2(const char *ptr, const char *end) {
+
+	const __m256i newline = _mm256_set1_epi8('\n');
+
+	while (end - ptr >= 32) {
+		__m256i bytes = _mm256_loadu_si256((const __m256i *) ptr);
+		unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline));
+		if (mask != 0) {
+			return ptr + __builtin_ctz(mask);
+		}
+		ptr += 32;
+	}
+	return newlineSse2(ptr, end);
+}
+
+#endif
+
+
+
+/*
+ * The scanner in use; scanSetLevel() switches it and the first scan picks the best one.
+ */
+static int scanLevel = -1;
+static const char * (*newlineImpl)(const char *, const char *) = newlineScalar;
+static size_t (*tokensImpl)(const char *, size_t, struct token *, size_t) = scanTokensScalar;
+
+
+
+/*
+* scanSetLevel(level) -- selects the scanner for 'level' (an enum scanLevel), or the best one
+* this CPU supports if 'level' is -1 or not supported. Returns the level actually selected.
+*/
+int scanSetLevel(int level) {
+
+	int best = SCAN_SCALAR;
+
+#ifdef SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		best = SCAN_SSE2;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		best = SCAN_AVX2;
+	}
+#endif
+
+	if (level < 0 || level > best) {
+		level = best;
+	}
+
+	newlineImpl = newlineScalar;
+	tokensImpl = scanTokensScalar;
+
+#ifdef SCAN_X86
+	if (level == SCAN_SSE2) {
+		newlineImpl = newlineSse2;
+		tokensImpl = scanTokensSse2;
+	} else if (level == SCAN_AVX2) {
+		newlineImpl = newlineAvx2;
+		tokensImpl = scanTokensAvx2;
+	}
+#endif
+
+	scanLevel = level;
+	return level;
+}
+
+
+
+/*
+* scanLevelName(level) -- returns a printable name for the scan level 'level'.
+*/
+const char * scanLevelName(int level) {
+
+	return level == SCAN_AVX2 ? "avx2" : level == SCAN_SSE2 ? "sse2" : "scalar";
+}
+
+
+
+/*
+* scanNewline(ptr, end) -- returns a pointer to the first newline in [ptr, end), or 'end' if there is none.
+*/
+const char * scanNewline(const char *ptr, const char *end) {
+
+	if (scanLevel < 0) {
+		scanSetLevel(-1);
+	}
+	return newlineImpl(ptr, end);
+}
+
+
+
+/*
+* scanTokens(line, len, tokens, cap) -- splits the 'len' bytes at 'line' into whitespace separated
+* words and stores views of the first 'cap' of them in 'tokens'. Returns the total number of words,
+* which is larger than 'cap' when the caller needs a bigger array.
+*/
+size_t scanTokens(const char *line, size_t len, struct token *tokens, size_t cap) {
+
+	if (scanLevel < 0) {
+		scanSetLevel(-1);
+	}
+	return tokensImpl(line, len, tokens, cap);
+}
+
+
+
+/*
+* load64(ptr) -- returns the 8 bytes at 'ptr' as one integer.
+*/
+static inline uint64_t load64(const char *ptr) {
+
+	uint64_t value;
+	memcpy(&value, ptr, 8);
+	return value;
+}
+
+
+
+/*
+* commandTag(word) -- returns the enum commandTag for the action word 'word', or CMD_INVALID.
+* The word's length picks the candidates and each is compared as one 8-byte load plus its tail,
+* so a line costs one or two integer compares instead of a strcmp per known action.
+*/
+int commandTag(struct token word) {
+
+	const char *ptr = word.ptr;
+
+	switch (word.len) {
+	case 5:
+		if (memcmp(ptr, "@save", 5) == 0) {
+			return CMD_SAVE;
+		}
+		break;
+	case 9:
+		if (load64(ptr) == load64("@addPage") && ptr[8] == 's') {
+			return CMD_ADD_PAGES;
+		}
+		if (load64(ptr) == load64("@addLink") && ptr[8] == 's') {
+			return CMD_ADD_LINKS;
+		}
+		break;
+	case 10:
+		if (load64(ptr) == load64("@loadEdg") && ptr[8] == 'e' && ptr[9] == 's') {
+			return CMD_LOAD_EDGES;
+		}
+		break;
+	case 12:
+		if (load64(ptr + 4) == load64("onnected") && load64(ptr) == load64("@isConne")) {
+			return CMD_IS_CONNECTED;
+		}
+		if (load64(ptr) == load64("@removeP") && load64(ptr + 4) == load64("ovePages")) {
+			return CMD_REMOVE_PAGES;
+		}
+		if (load64(ptr) == load64("@removeL") && load64(ptr + 4) == load64("oveLinks")) {
+			return CMD_REMOVE_LINKS;
+		}
+		break;
+	}
+	return CMD_INVALID;
+}
@@ -0,0 +1,64 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+
+/*
+ * File: scan.h
+ * Author: Chance Krueger
+ * Purpose: Vectorized scanning of command input. Newline and whitespace
+ *          boundaries are found a block of bytes at a time with AVX2 or SSE2
+ *          (picked at runtime, with a scalar fallback), and the action word of
+ *          a line is turned into a command tag once instead of compared by name.
+ */
+
+
+
+/*
+ * token -- A view of `len` bytes starting at `ptr`. It is not null-terminated and
+ * stays valid only as long as the buffer it points into.
+ */
+struct token {
+
+
+	const char *ptr;
+	size_t len;
+};
+
+
+
+/*
+ * commandTag -- The actions a command line can start with.
+ */
+enum commandTag {
+	CMD_INVALID,
+	CMD_ADD_PAGES,
+	CMD_ADD_LINKS,
+	CMD_IS_CONNECTED,
+	CMD_REMOVE_PAGES,
+	CMD_REMOVE_LINKS,
+	CMD_SAVE,
+	CMD_LOAD_EDGES
+};
+
+
+
+/*
+ * scanLevel -- The instruction sets the scanner can run on.
+ */
+enum scanLevel {
+	SCAN_SCALAR,
+	SCAN_SSE2,
+	SCAN_AVX2
+};
+
+
+
+int scanSetLevel(int level);
+const char * scanLevelName(int level);
+const char * scanNewline(const char *ptr, const char *end);
+size_t scanTokens(const char *line, size_t len, struct token *tokens, size_t cap);
+int commandTag(struct token word);
+
+#endif
@@ -0,0 +1,928 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "WebPageLinker.h"
+#include "reader.h"
+#include "server.h"
+#include "version.h"
+#include "stats.h"
+
+
+/*
+ * File: server.c
+ * Author: Chance Krueger
+ * Purpose: Implements the Unix domain socket server described in server.h.
+ */
+
+
+
+#define MAX_EVENTS 64
+#define READ_CHUNK (64 << 10)
+#define CLIENT_LINE_LIMIT (64 << 20)
+#define CLIENT_OUT_LIMIT (4 << 20)
+#define CLIENT_QUERY_LIMIT 4096
+#define RESULT_SCRATCH 4096
+#define MIN_READERS 4
+#define MAX_READERS 64
+
+
+
+/*
+ * client -- One connection. `in` holds `inLen` bytes read but not yet run, the
+ * last of them possibly an unfinished line; `out` holds results from `outSent`
+ * to `outLen` not yet taken by the socket. Once `peerDone` is set the client has
+ * sent everything, and the connection closes when its results are out. `jobs` to
+ * `jobsTail` are its queries without a request ID, oldest first, and `tagged` the
+ * ones with one; `pending` counts both. `nextReady` chains it while some of them
+ * have just been answered, and `lostReply` is set if a reply couldn't be queued. `prev` and `next` chain every open connection in
+ * `clients`.
+ */
+struct client {
+
+
+	int fd;
+	char *in;
+	size_t inLen;
+	size_t inCap;
+	char *out;
+	size_t outLen;
+	size_t outCap;
+	size_t outSent;
+	int peerDone;
+	int watching;
+	struct queryJob *jobs;
+	struct queryJob *jobsTail;
+	struct queryJob *tagged;
+	size_t pending;
+	int lostReply;
+	int ready;
+	struct client *nextReady;
+	struct client *prev;
+	struct client *next;
+};
+
+
+
+/*
+ * queryJob -- One @isConnected from `client`, searched by a reader thread in `version`,
+ * the version published when the query was read, so it sees every command read
+ * before it. `from`, `to` and the request ID `id` point into `names`. Once a reader
+ * has set `result` the job is `done`. A job without an ID (`id.len` 0) is chained
+ * by `next` and its result is sent when every such query the client sent before it
+ * is done too; one with an ID is chained by `prev` and `next` in the client's
+ * `tagged` list and answered as soon as it is done. `nextQueued` chains it in the
+ * readers' queue and then in `finished`. A job whose client has gone has `client`
+ * NULL and is freed when it comes back.
+ */
+struct queryJob {
+
+
+	struct client *client;
+	const struct graphVersion *version;
+	struct token from;
+	struct token to;
+	struct token id;
+	int result;
+	int done;
+	struct queryJob *prev;
+	struct queryJob *next;
+	struct queryJob *nextQueued;
+	char names[];
+};
+
+
+
+/*
+ * readerPool -- The threads that answer queries. The event loop thread, the only one
+ * that changes the graph, queues jobs from `queued` to `queuedTail`; a reader takes
+ * the oldest, searches it with its own entry of `scratch`, puts it on `finished` and
+ * wakes the event loop through the eventfd `doneFd`.
+ */
+struct readerPool {
+
+
+	pthread_t threads[MAX_READERS];
+	struct viewScratch scratch[MAX_READERS];
+	size_t threadCount;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int stopping;
+	struct queryJob *queued;
+	struct queryJob *queuedTail;
+	struct queryJob *finished;
+	int doneFd;
+};
+
+
+
+/*
+ * The signal handler's end of a pipe the event loop watches, so SIGINT and SIGTERM
+ * stop the server between commands whichever thread they land on.
+ */
+static int stopPipe[2] = { -1, -1 };
+static int stopTag;
+static int doneTag;
+
+static struct client *clients = NULL;
+static struct token *words = NULL;
+static size_t wordCap = 0;
+static struct outBuf scratchOut;
+static struct readerPool pool;
+static const struct graphVersion *published = NULL;
+
+
+
+/*
+* onStop(sig) -- asks the event loop to stop.
+*/
+static void onStop(int sig) {
+
+	int saved = errno;
+	ssize_t ignored = write(stopPipe[1], "", 1);
+	(void) ignored;
+	errno = saved;
+}
+
+
+
+/*
+* openListener(path) -- binds a listening, non-blocking socket to 'path'. A socket file left behind
+* by a server that is no longer running is replaced. Returns the socket, or -1 on failure.
+*/
+static int openListener(const char *path) {
+
+	struct sockaddr_un addr;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "The socket path is too long.\n");
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't create the socket.\n");
+		return -1;
+	}
+
+	// A SOCKET NOBODY ANSWERS ON IS STALE; ONE SOMEBODY ANSWERS ON IS ANOTHER SERVER'S
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+
+		struct stat info;
+		int probe = errno == EADDRINUSE ? socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) : -1;
+		int stale = probe >= 0 && connect(probe, (struct sockaddr *) &addr, sizeof(addr)) != 0 &&
+			    errno == ECONNREFUSED && stat(path, &info) == 0 && S_ISSOCK(info.st_mode);
+
+		if (probe >= 0) {
+			close(probe);
+		}
+		if (!stale || unlink(path) != 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+			fprintf(stderr, "Couldn't listen on %s.\n", path);
+			close(fd);
+			return -1;
+		}
+	}
+
+	if (listen(fd, SOMAXCONN) != 0) {
+		fprintf(stderr, "Couldn't listen on %s.\n", path);
+		close(fd);
+		unlink(path);
+		return -1;
+	}
+	return fd;
+}
+
+
+
+/*
+* backedUp(client) -- returns 1 while 'client' has too many results waiting to be sent or too
+* many queries waiting to be answered to run any more of its commands, otherwise 0.
+*/
+static int backedUp(const struct client *client) {
+
+	return client->outLen - client->outSent >= CLIENT_OUT_LIMIT || client->pending >= CLIENT_QUERY_LIMIT;
+}
+
+
+
+/*
+* watch(epoll, client) -- asks for the events 'client' is waiting on: more commands unless it is
+* backed up, and room to write while it has results waiting.
+*/
+static void watch(int epoll, struct client *client) {
+
+	struct epoll_event event;
+	int waiting = client->outLen > client->outSent;
+
+	event.events = (waiting ? EPOLLOUT : 0) |
+		       (!client->peerDone && !backedUp(client) ? EPOLLIN | EPOLLRDHUP : 0);
+	event.data.ptr = client;
+
+	if (event.events != (unsigned) client->watching) {
+		epoll_ctl(epoll, EPOLL_CTL_MOD, client->fd, &event);
+		client->watching = event.events;
+	}
+}
+
+
+
+/*
+* dropClient(epoll, client) -- closes the connection to 'client' and frees it. Its queries that
+* readers still hold are left for them to finish.
+*/
+static void dropClient(int epoll, struct client *client) {
+
+	while (client->jobs != NULL) {
+		struct queryJob *job = client->jobs;
+		client->jobs = job->next;
+		if (job->done) {
+			free(job);
+		} else {
+			job->client = NULL;
+		}
+	}
+
+	// TAGGED JOBS LEAVE THE LIST AS SOON AS THEY ARE DONE, SO EVERY ONE LEFT IS WITH A READER
+	for (struct queryJob *job = client->tagged; job != NULL; job = job->next) {
+		job->client = NULL;
+	}
+
+	if (client->prev != NULL) {
+		client->prev->next = client->next;
+	} else {
+		clients = client->next;
+	}
+	if (client->next != NULL) {
+		client->next->prev = client->prev;
+	}
+
+	epoll_ctl(epoll, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	free(client->in);
+	free(client->out);
+	free(client);
+}
+
+
+
+/*
+* sendResults(client) -- writes as many waiting results of 'client' as the socket takes.
+* Returns 0 on success, 1 if the connection is gone.
+*/
+static int sendResults(struct client *client) {
+
+	while (client->outSent < client->outLen) {
+		ssize_t sent = send(client->fd, client->out + client->outSent, client->outLen - client->outSent, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno != EAGAIN && errno != EWOULDBLOCK;
+		}
+		client->outSent += sent;
+	}
+	client->outLen = 0;
+	client->outSent = 0;
+	return 0;
+}
+
+
+
+/*
+* takeResults(client) -- moves what was written to the scratch buffer to the results waiting for
+* 'client'. Returns 0 on success, 1 if out of memory.
+*/
+static int takeResults(struct client *client) {
+
+	// ONE COMMAND WRITES ONE SHORT LINE AT MOST, SO THE SCRATCH BUFFER NEVER FILLS
+	if (scratchOut.len > 0) {
+		if (growArray((void **) &client->out, &client->outCap, 1, client->outLen + scratchOut.len) != 0) {
+			scratchOut.len = 0;
+			return 1;
+		}
+		memcpy(client->out + client->outLen, scratchOut.buf, scratchOut.len);
+		client->outLen += scratchOut.len;
+		scratchOut.len = 0;
+	}
+	return 0;
+}
+
+
+
+/*
+* replyTagged(client, id, answer) -- queues the reply line "#'id' 'answer'" for 'client'. Returns 0
+* on success, 1 if out of memory.
+*/
+static int replyTagged(struct client *client, struct token id, const char *answer) {
+
+	size_t answerLen = strlen(answer);
+	size_t len = id.len + answerLen + 3;
+
+	if (growArray((void **) &client->out, &client->outCap, 1, client->outLen + len) != 0) {
+		return 1;
+	}
+
+	char *cur = client->out + client->outLen;
+	*cur++ = '#';
+	memcpy(cur, id.ptr, id.len);
+	cur += id.len;
+	*cur++ = ' ';
+	memcpy(cur, answer, answerLen);
+	cur[answerLen] = '\n';
+	client->outLen += len;
+	return 0;
+}
+
+
+
+/*
+* reclaimVersions() -- frees the replaced versions no reader and no queued query can still use.
+*/
+static void reclaimVersions(void) {
+
+	pthread_mutex_lock(&pool.lock);
+	unsigned long oldest = pool.queued != NULL ? pool.queued->version->seq : ULONG_MAX;
+	pthread_mutex_unlock(&pool.lock);
+
+	versionReclaim(oldest);
+}
+
+
+
+/*
+* queueQuery(client, from, to, id, bulkMode) -- hands @isConnected 'from' 'to' from 'client' to
+* the readers, to be searched in a version that includes every change made so far. 'id' is the
+* request ID it is answered under, or empty to answer it in order. Returns 0 on success, 1 if out
+* of memory.
+*/
+static int queueQuery(struct client *client, struct token from, struct token to, struct token id, int bulkMode) {
+
+	if (bulkMode) {
+		bulkFlush();
+	}
+
+	const struct graphVersion *version = versionPublish();
+	struct queryJob *job = version == NULL ? NULL : malloc(sizeof(struct queryJob) + from.len + to.len + id.len);
+
+	if (job == NULL) {
+		return 1;
+	}
+
+	memcpy(job->names, from.ptr, from.len);
+	memcpy(job->names + from.len, to.ptr, to.len);
+	memcpy(job->names + from.len + to.len, id.ptr, id.len);
+	job->client = client;
+	job->version = version;
+	job->from.ptr = job->names;
+	job->from.len = from.len;
+	job->to.ptr = job->names + from.len;
+	job->to.len = to.len;
+	job->id.ptr = job->names + from.len + to.len;
+	job->id.len = id.len;
+	job->result = -1;
+	job->done = 0;
+	job->prev = NULL;
+	job->next = NULL;
+	job->nextQueued = NULL;
+
+	if (id.len > 0) {
+		job->next = client->tagged;
+		if (client->tagged != NULL) {
+			client->tagged->prev = job;
+		}
+		client->tagged = job;
+	} else if (client->jobsTail != NULL) {
+		client->jobsTail->next = job;
+		client->jobsTail = job;
+	} else {
+		client->jobs = job;
+		client->jobsTail = job;
+	}
+	client->pending++;
+
+	pthread_mutex_lock(&pool.lock);
+	if (pool.queuedTail != NULL) {
+		pool.queuedTail->nextQueued = job;
+	} else {
+		pool.queued = job;
+	}
+	pool.queuedTail = job;
+	pthread_cond_signal(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	// A NEW VERSION MAY HAVE LEFT THE ONE BEFORE IT UNUSED
+	if (version != published) {
+		published = version;
+		reclaimVersions();
+	}
+	return 0;
+}
+
+
+
+/*
+* runLine(client, line, len, bulkMode) -- runs one command line from 'client' and queues its result.
+* A query goes to the readers; any other command is run here, while they keep searching the
+* versions published before it. A line whose first word is #ID is a tagged request: its query is
+* answered "#ID 1" or "#ID 0" as soon as it is done, ahead of queries sent before it, and any other
+* command is answered "#ID ok" once it has run, or "#ID error" if it failed. Returns 0 on success,
+* 1 if out of memory.
+*/
+static int runLine(struct client *client, const char *line, size_t len, int bulkMode) {
+
+	uint64_t start = statsBegin();
+	size_t count = tokenize(line, len, &words, &wordCap);
+	struct token id = { NULL, 0 };
+	struct token *command = words;
+
+	statsEnd(STAT_PARSE, start);
+
+	if (count > 0 && words[0].ptr[0] == '#') {
+		id.ptr = words[0].ptr + 1;
+		id.len = words[0].len - 1;
+		command++;
+		count--;
+
+		if (count == 0) {
+			fprintf(stderr, "Invalid Input.");
+			return replyTagged(client, id, "error");
+		}
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	int tag = commandTag(command[0]);
+
+	if (tag == CMD_IS_CONNECTED && count == 3) {
+		return queueQuery(client, command[1], command[2], id, bulkMode);
+	}
+
+	int errSeen = versionChange(tag, command + 1, count - 1) != 0;
+
+	if (!errSeen) {
+		errSeen = runCommand(command, count, bulkMode);
+	}
+	if (takeResults(client) != 0) {
+		return 1;
+	}
+	return id.ptr != NULL ? replyTagged(client, id, errSeen ? "error" : "ok") : 0;
+}
+
+
+
+/*
+* runLines(client, bulkMode) -- runs the complete lines 'client' has sent, and the last unfinished
+* one too once it has sent everything, until it is backed up. Returns
+* 0 on success, 1 if out of memory.
+*/
+static int runLines(struct client *client, int bulkMode) {
+
+	const char *begin = client->in;
+	const char *end = client->in + client->inLen;
+
+	while (begin < end && !backedUp(client)) {
+
+		const char *newline = scanNewline(begin, end);
+
+		if (newline == end && !client->peerDone) {
+			break;
+		}
+		if (runLine(client, begin, newline - begin, bulkMode) != 0) {
+			return 1;
+		}
+		begin = newline + (newline < end);
+	}
+
+	client->inLen = end - begin;
+	memmove(client->in, begin, client->inLen);
+	return 0;
+}
+
+
+
+/*
+* readCommands(client, bulkMode) -- reads what 'client' has sent and runs the lines in it.
+* Returns 0 on success, 1 if the connection should be closed.
+*/
+static int readCommands(struct client *client, int bulkMode) {
+
+	while (!client->peerDone && !backedUp(client)) {
+
+		if (client->inLen > CLIENT_LINE_LIMIT) {
+			fprintf(stderr, "A client sent a command line that is too long.\n");
+			return 1;
+		}
+		if (growArray((void **) &client->in, &client->inCap, 1, client->inLen + READ_CHUNK) != 0) {
+			return 1;
+		}
+
+		ssize_t got = recv(client->fd, client->in + client->inLen, READ_CHUNK, 0);
+
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		}
+		if (got <= 0) {
+			client->peerDone = 1;
+		} else {
+			client->inLen += got;
+		}
+
+		if (runLines(client, bulkMode) != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+
+/*
+* acceptClients(epoll, listener) -- accepts every connection waiting on 'listener'.
+*/
+static void acceptClients(int epoll, int listener) {
+
+	int fd;
+
+	while ((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+
+		struct client *client = calloc(1, sizeof(struct client));
+		struct epoll_event event;
+
+		event.events = EPOLLIN | EPOLLRDHUP;
+		event.data.ptr = client;
+
+		if (client == NULL || epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+			fprintf(stderr, "Couldn't accept a client.\n");
+			free(client);
+			close(fd);
+			continue;
+		}
+		client->fd = fd;
+		client->watching = event.events;
+		client->next = clients;
+		if (clients != NULL) {
+			clients->prev = client;
+		}
+		clients = client;
+	}
+}
+
+
+
+/*
+* settleClient(epoll, client, failed, bulkMode) -- writes the results of 'client', runs the lines
+* it held back while it was backed up, and closes it once it is done, gone, or 'failed' is set.
+*/
+static void settleClient(int epoll, struct client *client, int failed, int bulkMode) {
+
+	// LINES HELD BACK WHILE RESULTS PILED UP CAN RUN ONCE THERE IS ROOM AGAIN
+	while (!failed && (failed = sendResults(client)) == 0 && !backedUp(client) && client->inLen > 0 &&
+	       (client->peerDone || scanNewline(client->in, client->in + client->inLen) < client->in + client->inLen)) {
+		failed = runLines(client, bulkMode);
+	}
+
+	if (failed || (client->peerDone && client->outLen == client->outSent && client->inLen == 0 && client->pending == 0)) {
+		dropClient(epoll, client);
+		return;
+	}
+	watch(epoll, client);
+}
+
+
+
+/*
+* serveClient(epoll, client, events, bulkMode) -- reacts to the epoll 'events' of 'client': runs
+* what it sent, writes its results, and closes it once it is done or gone.
+*/
+static void serveClient(int epoll, struct client *client, unsigned events, int bulkMode) {
+
+	int failed = 0;
+
+	if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+		failed = readCommands(client, bulkMode);
+	}
+	settleClient(epoll, client, failed, bulkMode);
+}
+
+
+
+/*
+* searchQueries(arg) -- a reader thread: answers queued queries, oldest first, until the server
+* stops and the queue is empty.
+*/
+static void * searchQueries(void *arg) {
+
+	struct viewScratch *scratch = arg;
+	size_t reader = scratch - pool.scratch;
+	uint64_t one = 1;
+
+	while (1) {
+
+		pthread_mutex_lock(&pool.lock);
+		while (!pool.stopping && pool.queued == NULL) {
+			pthread_cond_wait(&pool.wake, &pool.lock);
+		}
+		if (pool.queued == NULL) {
+			pthread_mutex_unlock(&pool.lock);
+			return NULL;
+		}
+
+		struct queryJob *job = pool.queued;
+		pool.queued = job->nextQueued;
+		if (pool.queued == NULL) {
+			pool.queuedTail = NULL;
+		}
+
+		// ENTERED BEFORE THE JOB LEAVES THE QUEUE'S PROTECTION, SO ITS VERSION CAN'T BE FREED IN BETWEEN
+		versionEnter(reader, job->version);
+		pthread_mutex_unlock(&pool.lock);
+
+		const struct graphView *view = &job->version->view;
+		int64_t from = view->ops->lookup(view->impl, job->from);
+		int64_t to = view->ops->lookup(view->impl, job->to);
+
+		if (from < 0 || to < 0) {
+			fprintf(stderr, "Either Page does not Exist.\n");
+		} else {
+			job->result = viewReachable(view, from, to, scratch);
+		}
+		versionExit(reader);
+
+		pthread_mutex_lock(&pool.lock);
+		job->nextQueued = pool.finished;
+		pool.finished = job;
+		pthread_mutex_unlock(&pool.lock);
+
+		ssize_t ignored = write(pool.doneFd, &one, sizeof(one));
+		(void) ignored;
+	}
+}
+
+
+
+/*
+* answerQueries(epoll, bulkMode) -- sends every client the results of its queries the readers have
+* finished: tagged ones right away, the others in the order it sent them. Then carries on with the
+* clients that were waiting on them.
+*/
+static void answerQueries(int epoll, int bulkMode) {
+
+	uint64_t count;
+	struct client *ready = NULL;
+	ssize_t ignored = read(pool.doneFd, &count, sizeof(count));
+	(void) ignored;
+
+	pthread_mutex_lock(&pool.lock);
+	struct queryJob *job = pool.finished;
+	pool.finished = NULL;
+	pthread_mutex_unlock(&pool.lock);
+
+	while (job != NULL) {
+		struct queryJob *next = job->nextQueued;
+		struct client *client = job->client;
+		if (client == NULL) {
+			free(job);
+		} else {
+			job->done = 1;
+
+			if (job->id.len > 0) {
+				if (job->prev != NULL) {
+					job->prev->next = job->next;
+				} else {
+					client->tagged = job->next;
+				}
+				if (job->next != NULL) {
+					job->next->prev = job->prev;
+				}
+				client->pending--;
+
+				// A CLIENT THAT CAN'T BE SENT A REPLY IS CLOSED WHEN IT IS SETTLED BELOW
+				client->lostReply |= replyTagged(client, job->id, job->result < 0 ? "error" : job->result ? "1" : "0");
+				free(job);
+			}
+
+			if (!client->ready) {
+				client->ready = 1;
+				client->nextReady = ready;
+				ready = client;
+			}
+		}
+		job = next;
+	}
+
+	reclaimVersions();
+
+	while (ready != NULL) {
+
+		struct client *client = ready;
+		int failed = client->lostReply;
+
+		ready = client->nextReady;
+		client->ready = 0;
+
+		while (!failed && client->jobs != NULL && client->jobs->done) {
+			job = client->jobs;
+			client->jobs = job->next;
+			if (client->jobs == NULL) {
+				client->jobsTail = NULL;
+			}
+			client->pending--;
+			if (job->result >= 0) {
+				outputInt(&scratchOut, job->result);
+			}
+			free(job);
+			failed = takeResults(client);
+		}
+		settleClient(epoll, client, failed, bulkMode);
+	}
+}
+
+
+
+/*
+* stopReaders() -- lets the readers finish the queries still queued, stops them and frees every
+* version. Called once every client is gone.
+*/
+static void stopReaders(void) {
+
+	pthread_mutex_lock(&pool.lock);
+	pool.stopping = 1;
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (size_t i = 0; i < pool.threadCount; i++) {
+		pthread_join(pool.threads[i], NULL);
+		scratchFree(&pool.scratch[i]);
+	}
+
+	while (pool.finished != NULL) {
+		struct queryJob *next = pool.finished->nextQueued;
+		free(pool.finished);
+		pool.finished = next;
+	}
+
+	versionStop();
+	published = NULL;
+	if (pool.doneFd >= 0) {
+		close(pool.doneFd);
+	}
+	pthread_mutex_destroy(&pool.lock);
+	pthread_cond_destroy(&pool.wake);
+}
+
+
+
+/*
+* startReaders(bulkMode) -- publishes the first version of the graph and starts a reader thread per
+* core, and at least MIN_READERS so a few long searches can't hold up every other query on a small
+* machine. Returns 0 on success, 1 if the readers can't be started.
+*/
+static int startReaders(int bulkMode) {
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t wanted = cores < MIN_READERS ? MIN_READERS : cores > MAX_READERS ? MAX_READERS : (size_t) cores;
+
+	memset(&pool, 0, sizeof(pool));
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.wake, NULL);
+
+	// COMMANDS BUFFERED BY THE INPUT FILE ARE PART OF THE GRAPH THE CLIENTS SEE
+	if (bulkMode) {
+		bulkFlush();
+	}
+
+	pool.doneFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (pool.doneFd >= 0 && versionStart(wanted) == 0 && (published = versionPublish()) != NULL) {
+		while (pool.threadCount < wanted &&
+		       pthread_create(&pool.threads[pool.threadCount], NULL, searchQueries, &pool.scratch[pool.threadCount]) == 0) {
+			pool.threadCount++;
+		}
+	}
+
+	if (pool.threadCount == 0) {
+		stopReaders();
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* serveSocket(path, bulkMode) -- listens on the Unix domain socket 'path' and runs the commands its
+* clients send against the graph built so far, until SIGINT or SIGTERM. Clients are served as
+* their input arrives: this thread runs every command that changes the graph, one at a time, and
+* publishes versions of it for the reader threads to answer queries from. Each client's results
+* go back to it in the order it sent its queries, except tagged ones, which go back as soon as
+* they are answered. Returns 0 after a clean shutdown, 1 if the
+* socket can't be set up.
+*/
+int serveSocket(const char *path, int bulkMode) {
+
+	struct epoll_event events[MAX_EVENTS];
+	struct epoll_event event;
+	struct outBuf *savedOut = resultOut;
+	int listener = openListener(path);
+	int epoll = epoll_create1(EPOLL_CLOEXEC);
+	int stopping = 0;
+	int answered = 0;
+
+	if (listener < 0 || epoll < 0 || pipe(stopPipe) != 0 ||
+	    outputInit(&scratchOut, -1, RESULT_SCRATCH, 0) != 0 || startReaders(bulkMode) != 0) {
+		fprintf(stderr, "Couldn't start the server.\n");
+		if (listener >= 0) {
+			close(listener);
+			unlink(path);
+		}
+		return 1;
+	}
+
+	fcntl(stopPipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(stopPipe[1], F_SETFL, O_NONBLOCK);
+
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+	event.data.ptr = &stopTag;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, stopPipe[0], &event);
+	event.data.ptr = &doneTag;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, pool.doneFd, &event);
+
+	struct sigaction stop;
+	memset(&stop, 0, sizeof(stop));
+	stop.sa_handler = onStop;
+	sigaction(SIGINT, &stop, NULL);
+	sigaction(SIGTERM, &stop, NULL);
+
+	resultOut = &scratchOut;
+
+	while (!stopping) {
+
+		int ready = epoll_wait(epoll, events, MAX_EVENTS, -1);
+
+		if (ready < 0 && errno != EINTR) {
+			fprintf(stderr, "The server's event loop failed.\n");
+			break;
+		}
+
+		for (int i = 0; i < ready; i++) {
+			if (events[i].data.ptr == NULL) {
+				acceptClients(epoll, listener);
+			} else if (events[i].data.ptr == &stopTag) {
+				stopping = 1;
+			} else if (events[i].data.ptr == &doneTag) {
+				answered = 1;
+			} else {
+				serveClient(epoll, events[i].data.ptr, events[i].events, bulkMode);
+			}
+		}
+
+		// ANSWERS CAN CLOSE CLIENTS, SO THEY WAIT UNTIL NO EVENT OF THIS ROUND POINTS AT ONE
+		if (answered) {
+			answerQueries(epoll, bulkMode);
+			answered = 0;
+		}
+	}
+
+	// CLIENTS STILL CONNECTED ARE CUT OFF; THE GRAPH IS LEFT FOR main() TO SAVE AND FREE
+	while (clients != NULL) {
+		dropClient(epoll, clients);
+	}
+	stopReaders();
+
+	resultOut = savedOut;
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	close(epoll);
+	close(listener);
+	unlink(path);
+	close(stopPipe[0]);
+	close(stopPipe[1]);
+	free(scratchOut.buf);
+	free(words);
+	words = NULL;
+	wordCap = 0;
+	return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+
+/*
+ * File: server.h
+ * Author: Chance Krueger
+ * Purpose: Daemon mode. serveSocket() keeps the graph this process has built and
+ *          answers commands from any number of clients connected to a Unix domain
+ *          socket, all from one epoll event loop. Clients speak the same line based
+ *          command syntax as the input file, and get the same result lines back;
+ *          errors still go to the server's stderr. A line starting with #ID is a
+ *          tagged request, answered with a line starting with #ID as soon as it is
+ *          done rather than in order.
+ */
+
+
+
+int serveSocket(const char *path, int bulkMode);
+
+#endif
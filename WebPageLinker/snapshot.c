@@ -0,0 +1,814 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "WebPageLinker.h"
+#include "snapshot.h"
+
+
+/*
+ * File: snapshot.c
+ * Author: Chance Krueger
+ * Purpose: Implements saving, loading and mapping the binary snapshots described in snapshot.h.
+ */
+
+
+
+#define CHECKSUM_PRIME1 0x9E3779B185EBCA87ULL
+#define CHECKSUM_PRIME2 0xC2B2AE3D27D4EB4FULL
+
+
+
+/*
+* rotl64(value, bits) -- rotates 'value' left by 'bits'.
+*/
+static inline uint64_t rotl64(uint64_t value, int bits) {
+
+	return (value << bits) | (value >> (64 - bits));
+}
+
+
+
+/*
+* load64le(ptr) -- returns the 8 bytes at 'ptr' as one integer.
+*/
+static inline uint64_t load64le(const unsigned char *ptr) {
+
+	uint64_t value;
+	memcpy(&value, ptr, 8);
+	return value;
+}
+
+
+
+/*
+* checksum64(data, len) -- returns a 64-bit checksum of 'len' bytes at 'data'. Four independent
+* lanes each take one 8-byte word of every 32-byte stripe, so checking a snapshot runs at memory
+* speed rather than one byte per step; the tail and the length are folded in at the end.
+*/
+uint64_t checksum64(const void *data, uint64_t len) {
+
+	const unsigned char *ptr = data;
+	uint64_t total = len;
+	uint64_t lanes[4] = { CHECKSUM_PRIME1 + CHECKSUM_PRIME2, CHECKSUM_PRIME2, 0, 0 - CHECKSUM_PRIME1 };
+
+	while (len >= 32) {
+		for (int i = 0; i < 4; i++) {
+			lanes[i] = rotl64(lanes[i] + load64le(ptr + 8 * i) * CHECKSUM_PRIME2, 31) * CHECKSUM_PRIME1;
+		}
+		ptr += 32;
+		len -= 32;
+	}
+
+	uint64_t hash = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) + rotl64(lanes[3], 18) + total;
+
+	while (len >= 8) {
+		hash ^= rotl64(load64le(ptr) * CHECKSUM_PRIME2, 31) * CHECKSUM_PRIME1;
+		hash = rotl64(hash, 27) * CHECKSUM_PRIME1;
+		ptr += 8;
+		len -= 8;
+	}
+
+	while (len > 0) {
+		hash ^= *ptr++ * CHECKSUM_PRIME1;
+		hash = rotl64(hash, 11) * CHECKSUM_PRIME2;
+		len--;
+	}
+
+	hash ^= hash >> 33;
+	hash *= CHECKSUM_PRIME2;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+
+
+/*
+* writeAll(fd, data, len) -- writes all 'len' bytes at 'data' to 'fd'. Returns 0 on success, 1 on error.
+*/
+int writeAll(int fd, const void *data, size_t len) {
+
+	const char *ptr = data;
+
+	while (len > 0) {
+		ssize_t wrote = write(fd, ptr, len);
+		if (wrote < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return 1;
+		}
+		ptr += wrote;
+		len -= wrote;
+	}
+	return 0;
+}
+
+
+
+/*
+* readAll(fd, data, len) -- reads exactly 'len' bytes from 'fd' into 'data'. Returns 0 on success,
+* 1 on error or a short file.
+*/
+static int readAll(int fd, void *data, size_t len) {
+
+	char *ptr = data;
+
+	while (len > 0) {
+		ssize_t got = read(fd, ptr, len);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			return 1;
+		}
+		ptr += got;
+		len -= got;
+	}
+	return 0;
+}
+
+
+
+/*
+* isLiveLink(edge) -- returns 1 if 'edge' is neither tombstoned nor pointing at a removed page.
+*/
+static inline int isLiveLink(struct link *edge) {
+
+	return edge->to != NULL && !edge->to->removed;
+}
+
+
+
+/*
+* alignUp(value) -- rounds 'value' up to the next SNAPSHOT_ALIGN boundary.
+*/
+static inline uint64_t alignUp(uint64_t value) {
+
+	return (value + SNAPSHOT_ALIGN - 1) & ~(uint64_t) (SNAPSHOT_ALIGN - 1);
+}
+
+
+
+/*
+* writeSections(fd, header, data) -- writes 'header' and then each section's bytes from 'data'
+* at the offset the header gives it, zero filling the alignment gaps. Returns 0 on success, 1 on error.
+*/
+static int writeSections(int fd, struct snapshotHeader *header, const void *data[SECTION_COUNT]) {
+
+	static const char zeros[SNAPSHOT_ALIGN];
+	uint64_t at = sizeof(struct snapshotHeader);
+
+	if (writeAll(fd, header, sizeof(struct snapshotHeader)) != 0) {
+		return 1;
+	}
+
+	for (int i = 0; i < SECTION_COUNT; i++) {
+		if (writeAll(fd, zeros, header->sections[i].offset - at) != 0 ||
+		    writeAll(fd, data[i], header->sections[i].size) != 0) {
+			return 1;
+		}
+		at = header->sections[i].offset + header->sections[i].size;
+	}
+	return 0;
+}
+
+
+
+/*
+ * snapshotBuild -- A snapshot of the live graph built in memory: its sections in `data`,
+ * laid out by `header` in an image of `size` bytes. The arrays behind the sections
+ * belong to it.
+ */
+struct snapshotBuild {
+
+
+	struct snapshotHeader header;
+	char *names;
+	uint64_t *nameOffsets;
+	uint64_t *offsets;
+	uint32_t *targets;
+	uint32_t *slots;
+	const void *data[SECTION_COUNT];
+	uint64_t size;
+};
+
+
+
+/*
+* freeBuild(build) -- frees the sections of 'build'.
+*/
+static void freeBuild(struct snapshotBuild *build) {
+
+	free(build->names);
+	free(build->nameOffsets);
+	free(build->offsets);
+	free(build->targets);
+	free(build->slots);
+}
+
+
+
+/*
+* buildSnapshot(build) -- builds the sections of a snapshot of the live graph into 'build'. Live
+* pages are numbered in list order through their `id` field, and the sections are checksummed and
+* laid out on aligned offsets. Returns 0 on success, 1 on error, with 'build' freed.
+*/
+static int buildSnapshot(struct snapshotBuild *build) {
+
+	struct snapshotHeader *header = &build->header;
+	uint64_t pages = 0;
+	uint64_t edges = 0;
+	uint64_t nameBytes = 0;
+
+	memset(build, 0, sizeof(struct snapshotBuild));
+
+	for (struct page *cur = graphHead; cur != NULL; cur = cur->next) {
+		if (cur->removed) {
+			continue;
+		}
+		cur->id = pages++;
+		nameBytes += strlen(cur->name) + 1;
+		for (struct link *edge = cur->edges; edge != NULL; edge = edge->next) {
+			edges += isLiveLink(edge);
+		}
+	}
+
+	if (pages >= UINT32_MAX) {
+		fprintf(stderr, "Too many pages for a snapshot.\n");
+		return 1;
+	}
+
+	uint64_t buckets = 16;
+	while (buckets < 2 * pages) {
+		buckets *= 2;
+	}
+
+	char *names = build->names = malloc(nameBytes + 1);
+	uint64_t *nameOffsets = build->nameOffsets = malloc((pages + 1) * sizeof(uint64_t));
+	uint64_t *offsets = build->offsets = malloc((pages + 1) * sizeof(uint64_t));
+	uint32_t *targets = build->targets = malloc((edges + 1) * sizeof(uint32_t));
+	uint32_t *slots = build->slots = calloc(buckets, sizeof(uint32_t));
+
+	if (names == NULL || nameOffsets == NULL || offsets == NULL || targets == NULL || slots == NULL) {
+		freeBuild(build);
+		return 1;
+	}
+
+	uint64_t page = 0;
+	uint64_t nameAt = 0;
+	uint64_t edgeAt = 0;
+
+	for (struct page *cur = graphHead; cur != NULL; cur = cur->next) {
+		if (cur->removed) {
+			continue;
+		}
+
+		struct token name = pageToken(cur);
+		uint64_t slot = hashName(name) & (buckets - 1);
+		while (slots[slot] != 0) {
+			slot = (slot + 1) & (buckets - 1);
+		}
+		slots[slot] = page + 1;
+
+		memcpy(names + nameAt, name.ptr, name.len + 1);
+		nameOffsets[page] = nameAt;
+		offsets[page++] = edgeAt;
+		nameAt += name.len + 1;
+
+		for (struct link *edge = cur->edges; edge != NULL; edge = edge->next) {
+			if (isLiveLink(edge)) {
+				targets[edgeAt++] = edge->to->id;
+			}
+		}
+	}
+	offsets[pages] = edgeAt;
+
+	const void *data[SECTION_COUNT] = { names, nameOffsets, offsets, targets, slots };
+	uint64_t sizes[SECTION_COUNT] = { nameBytes, pages * sizeof(uint64_t), (pages + 1) * sizeof(uint64_t),
+		edges * sizeof(uint32_t), buckets * sizeof(uint32_t) };
+	uint64_t at = alignUp(sizeof(struct snapshotHeader));
+
+	memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header->version = SNAPSHOT_VERSION;
+	header->headerSize = sizeof(struct snapshotHeader);
+	header->pageCount = pages;
+	header->edgeCount = edges;
+	header->bucketCount = buckets;
+
+	for (int i = 0; i < SECTION_COUNT; i++) {
+		build->data[i] = data[i];
+		header->sections[i].offset = at;
+		header->sections[i].size = sizes[i];
+		header->sections[i].checksum = checksum64(data[i], sizes[i]);
+		build->size = at + sizes[i];
+		at = alignUp(at + sizes[i]);
+	}
+	header->headerSum = checksum64(header, offsetof(struct snapshotHeader, headerSum));
+	return 0;
+}
+
+
+
+/*
+* saveSnapshot(path) -- writes the live graph to 'path'. The file is written beside 'path' and
+* renamed over it once synced, so a crash never leaves a half written snapshot behind. Returns 0 on
+* success, 1 on error.
+*/
+int saveSnapshot(const char *path) {
+
+	struct snapshotBuild build;
+	int failed = buildSnapshot(&build);
+
+	if (!failed) {
+
+		size_t pathLen = strlen(path);
+		char *tempPath = malloc(pathLen + 5);
+		int fd = -1;
+
+		if (tempPath != NULL) {
+			memcpy(tempPath, path, pathLen);
+			memcpy(tempPath + pathLen, ".tmp", 5);
+			fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		}
+
+		failed = fd < 0 || writeSections(fd, &build.header, build.data) != 0 || fsync(fd) != 0;
+
+		if (fd >= 0 && close(fd) != 0) {
+			failed = 1;
+		}
+		if (!failed && rename(tempPath, path) != 0) {
+			failed = 1;
+		}
+		if (failed && fd >= 0) {
+			unlink(tempPath);
+		}
+		free(tempPath);
+		freeBuild(&build);
+	}
+
+	if (failed) {
+		fprintf(stderr, "Couldn't save the snapshot.\n");
+	}
+	return failed;
+}
+
+
+
+/*
+* segmentName(name) -- returns 'name' as a POSIX shared memory name, with the leading slash it
+* needs, in a heap allocated string, or NULL if it has another slash or out of memory.
+*/
+static char * segmentName(const char *name) {
+
+	const char *bare = name[0] == '/' ? name + 1 : name;
+	char *full = bare[0] == 0 || strchr(bare, '/') != NULL ? NULL : malloc(strlen(bare) + 2);
+
+	if (full != NULL) {
+		full[0] = '/';
+		strcpy(full + 1, bare);
+	}
+	return full;
+}
+
+
+
+/*
+* shareSnapshot(name) -- builds the live graph into the POSIX shared memory segment 'name', laid
+* out exactly like a snapshot file, for other processes to attach with attachSnapshot(). A segment
+* of that name already there is unlinked first: processes still attached to it keep it until they
+* let go. The header goes in last, so a process attaching part way through finds no valid header
+* and fails instead of reading half a graph. Returns 0 on success, 1 on error.
+*/
+int shareSnapshot(const char *name) {
+
+	struct snapshotBuild build;
+	char *segment = segmentName(name);
+	int failed = segment == NULL || buildSnapshot(&build) != 0;
+
+	if (!failed) {
+
+		shm_unlink(segment);
+
+		int fd = shm_open(segment, O_RDWR | O_CREAT | O_EXCL, 0644);
+		char *base = MAP_FAILED;
+
+		if (fd >= 0 && ftruncate(fd, build.size) == 0) {
+			base = mmap(NULL, build.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+
+		failed = base == MAP_FAILED;
+
+		if (!failed) {
+			for (int i = 0; i < SECTION_COUNT; i++) {
+				memcpy(base + build.header.sections[i].offset, build.data[i], build.header.sections[i].size);
+			}
+			__atomic_thread_fence(__ATOMIC_RELEASE);
+			memcpy(base, &build.header, sizeof(struct snapshotHeader));
+			munmap(base, build.size);
+		}
+
+		if (fd >= 0) {
+			close(fd);
+		}
+		if (failed && fd >= 0) {
+			shm_unlink(segment);
+		}
+		freeBuild(&build);
+	}
+
+	if (failed) {
+		fprintf(stderr, "Couldn't share the graph as %s.\n", name);
+	}
+	free(segment);
+	return failed;
+}
+
+
+
+/*
+* sectionFits(section, size, expected) -- returns 1 if 'section' is 'expected' bytes long, aligned,
+* and lies inside a file of 'size' bytes, otherwise 0.
+*/
+static int sectionFits(const struct snapshotSection *section, uint64_t size, uint64_t expected) {
+
+	return section->size == expected && section->offset % SNAPSHOT_ALIGN == 0 &&
+		section->offset <= size && section->size <= size - section->offset;
+}
+
+
+
+/*
+* parseImage(image, verify) -- checks the header of the snapshot held in 'image' and locates its
+* sections. Every section's bounds are checked; its checksum only if 'verify' is set, since that
+* reads the whole file. Returns 0 on success, 1 if the file is not a snapshot or is damaged.
+*/
+static int parseImage(struct snapshotImage *image, int verify) {
+
+	struct snapshotHeader header;
+	uint64_t size = image->size;
+
+	if (size < sizeof(header) || memcmp(image->base, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+		return 1;
+	}
+	memcpy(&header, image->base, sizeof(header));
+
+	if (header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(header) ||
+	    header.headerSum != checksum64(&header, offsetof(struct snapshotHeader, headerSum)) ||
+	    header.pageCount >= UINT32_MAX || header.edgeCount > size || header.bucketCount > size ||
+	    header.bucketCount <= header.pageCount || (header.bucketCount & (header.bucketCount - 1)) != 0) {
+		return 1;
+	}
+
+	struct snapshotSection *sections = header.sections;
+	const char *base = image->base;
+
+	if (!sectionFits(&sections[SECTION_NAMES], size, sections[SECTION_NAMES].size) ||
+	    !sectionFits(&sections[SECTION_NAME_OFFSETS], size, header.pageCount * sizeof(uint64_t)) ||
+	    !sectionFits(&sections[SECTION_OFFSETS], size, (header.pageCount + 1) * sizeof(uint64_t)) ||
+	    !sectionFits(&sections[SECTION_TARGETS], size, header.edgeCount * sizeof(uint32_t)) ||
+	    !sectionFits(&sections[SECTION_BUCKETS], size, header.bucketCount * sizeof(uint32_t))) {
+		return 1;
+	}
+
+	image->pageCount = header.pageCount;
+	image->edgeCount = header.edgeCount;
+	image->nameBytes = sections[SECTION_NAMES].size;
+	image->bucketCount = header.bucketCount;
+	image->names = base + sections[SECTION_NAMES].offset;
+	image->nameOffsets = (const uint64_t *) (base + sections[SECTION_NAME_OFFSETS].offset);
+	image->offsets = (const uint64_t *) (base + sections[SECTION_OFFSETS].offset);
+	image->targets = (const uint32_t *) (base + sections[SECTION_TARGETS].offset);
+	image->buckets = (const uint32_t *) (base + sections[SECTION_BUCKETS].offset);
+
+	// Every name lookup relies on the dictionary ending in a terminator.
+	if (image->nameBytes > 0 && image->names[image->nameBytes - 1] != 0) {
+		return 1;
+	}
+
+	if (verify) {
+		for (int i = 0; i < SECTION_COUNT; i++) {
+			if (checksum64(base + sections[i].offset, sections[i].size) != sections[i].checksum) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+
+
+/*
+* buildFromImage(image) -- checks the structure of the sections in 'image' and adds their pages
+* and links to the graph. All pages come from one pool allocation and all links from another,
+* chained in CSR order, so no list is walked and no name is looked up except to reject duplicates.
+* Returns 0 on success, 1 if the sections are inconsistent or memory runs out.
+*/
+static int buildFromImage(const struct snapshotImage *image) {
+
+	uint64_t pages = image->pageCount;
+	uint64_t edges = image->edgeCount;
+	const char *names = image->names;
+	const uint64_t *nameOffsets = image->nameOffsets;
+	const uint64_t *offsets = image->offsets;
+	const uint32_t *targets = image->targets;
+
+	if (offsets[0] != 0 || offsets[pages] != edges || (image->nameBytes > 0 && names[image->nameBytes - 1] != 0)) {
+		return 1;
+	}
+
+	for (uint64_t i = 0; i < pages; i++) {
+		if (offsets[i] > offsets[i + 1] || nameOffsets[i] >= image->nameBytes) {
+			return 1;
+		}
+	}
+
+	for (uint64_t i = 0; i < edges; i++) {
+		if (targets[i] >= pages) {
+			return 1;
+		}
+	}
+
+	if (pages == 0) {
+		return 0;
+	}
+
+	struct page *batch = poolAllocArray(&pagePool, pages);
+	struct link *links = edges > 0 ? poolAllocArray(&linkPool, edges) : NULL;
+
+	if (batch == NULL || (edges > 0 && links == NULL) || reserveIndex(pages) != 0) {
+		return 1;
+	}
+
+	for (uint64_t i = 0; i < pages; i++) {
+
+		// A MAPPED BODY ISN'T CHECKSUMMED, SO A NAME MUST END INSIDE ITS SECTION
+		size_t left = image->nameBytes - nameOffsets[i];
+		struct token name = { names + nameOffsets[i], strnlen(names + nameOffsets[i], left) };
+		struct page *node = &batch[i];
+
+		if (name.len == left || findNode(name) != NULL) {
+			return 1;
+		}
+
+		node->name = internName(name);
+		node->id = i;
+		if (node->name == NULL || indexInsert(node) != 0) {
+			return 1;
+		}
+		appendPage(node);
+
+		for (uint64_t e = offsets[i]; e < offsets[i + 1]; e++) {
+			links[e].to = &batch[targets[e]];
+			links[e].next = e + 1 < offsets[i + 1] ? &links[e + 1] : NULL;
+			batch[targets[e]].inCount++;
+		}
+		node->edges = offsets[i] < offsets[i + 1] ? &links[offsets[i]] : NULL;
+		node->outCount = offsets[i + 1] - offsets[i];
+	}
+
+	linkCount += edges;
+	return 0;
+}
+
+
+
+/*
+* snapshotId(path, id) -- stores in '*id' a checksum of the header of the snapshot at 'path'. The
+* header holds every section's checksum, so a rewritten snapshot gets a different id.
+* Returns 0 on success, 1 if the file can't be read.
+*/
+int snapshotId(const char *path, uint64_t *id) {
+
+	struct snapshotHeader header;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		return 1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	ssize_t got = read(fd, &header, sizeof(header));
+	close(fd);
+
+	if (got <= 0) {
+		return 1;
+	}
+	*id = checksum64(&header, got);
+	return 0;
+}
+
+
+
+/*
+* loadSnapshot(path) -- adds the graph saved in the snapshot at 'path' to the (empty) graph.
+* The file is read with large sequential reads and every checksum is verified before anything
+* is built. Returns 0 on success, 1 on error.
+*/
+int loadSnapshot(const char *path) {
+
+	struct snapshotImage image;
+	struct stat info;
+	int failed = 1;
+	int fd = open(path, O_RDONLY);
+
+	memset(&image, 0, sizeof(image));
+
+	if (fd >= 0 && fstat(fd, &info) == 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		image.size = info.st_size;
+		image.base = malloc(image.size + 1);
+
+		if (image.base != NULL && readAll(fd, image.base, image.size) == 0 && parseImage(&image, 1) == 0) {
+			failed = buildFromImage(&image);
+		}
+	}
+
+	if (fd >= 0) {
+		close(fd);
+	}
+	free(image.base);
+
+	if (failed) {
+		fprintf(stderr, "Couldn't load the snapshot.\n");
+	}
+	return failed;
+}
+
+
+
+/*
+* mappedLookup(impl, name) -- finds 'name' in a mapped snapshot's name table by linear probing.
+* Like mappedSuccessors(), it checks that the name and its terminator lie inside the name section,
+* so a damaged entry misses instead of reading past the mapping. Returns its page number, or -1 if
+* there is no such page.
+*/
+static int64_t mappedLookup(const void *impl, struct token name) {
+
+	const struct snapshotImage *image = impl;
+	uint64_t mask = image->bucketCount - 1;
+	uint64_t slot = hashName(name) & mask;
+
+	for (uint64_t probes = 0; probes <= mask; probes++) {
+
+		uint32_t entry = image->buckets[slot];
+
+		if (entry == 0 || entry > image->pageCount) {
+			return -1;
+		}
+
+		uint64_t off = image->nameOffsets[entry - 1];
+		if (off < image->nameBytes && name.len < image->nameBytes - off &&
+		    strncmp(image->names + off, name.ptr, name.len) == 0 &&
+		    image->names[off + name.len] == 0) {
+			return entry - 1;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+
+
+/*
+* mappedSuccessors(impl, page, scratch, out) -- points '*out' at the CSR targets of 'page' in a
+* mapped snapshot. The offsets are checked against the target count since the mapped body is not
+* checksummed; a damaged entry yields no links rather than a stray read.
+*/
+static uint32_t mappedSuccessors(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out) {
+
+	const struct snapshotImage *image = impl;
+	uint64_t start = image->offsets[page];
+	uint64_t end = image->offsets[page + 1];
+
+	if (start > end || end > image->edgeCount) {
+		return 0;
+	}
+
+	*out = image->targets + start;
+	return end - start;
+}
+
+
+
+/*
+* mappedThaw(impl) -- adds the pages and links of a mapped snapshot to the graph. Returns 0 on
+* success, 1 on error.
+*/
+static int mappedThaw(const void *impl) {
+
+	if (buildFromImage(impl) != 0) {
+		fprintf(stderr, "Couldn't load the snapshot.\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* mappedClose(impl) -- unmaps a mapped snapshot and frees its state.
+*/
+static void mappedClose(void *impl) {
+
+	struct snapshotImage *image = impl;
+
+	munmap(image->base, image->size);
+	free(image);
+}
+
+
+
+static const struct viewOps mappedOps = { "mapped snapshot", mappedLookup, mappedSuccessors, NULL, NULL, mappedThaw, mappedClose };
+
+
+
+/*
+* mapImage(fd, view) -- maps the snapshot held in 'fd' read-only and opens 'view' on it.
+* Only the header and section bounds are checked, so startup does not touch the body: pages are
+* faulted in as queries reach them. Returns 0 on success, 1 on error.
+*/
+static int mapImage(int fd, struct graphView *view) {
+
+	struct stat info;
+	struct snapshotImage *image = calloc(1, sizeof(struct snapshotImage));
+
+	if (image == NULL || fstat(fd, &info) != 0 || info.st_size <= 0) {
+		free(image);
+		return 1;
+	}
+
+	image->size = info.st_size;
+	image->base = mmap(NULL, image->size, PROT_READ, MAP_SHARED, fd, 0);
+	image->mapped = 1;
+
+	if (image->base == MAP_FAILED) {
+		free(image);
+		return 1;
+	}
+
+	// PAIRS WITH THE FENCE shareSnapshot() PUTS BEFORE THE HEADER
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	if (parseImage(image, 0) != 0) {
+		munmap(image->base, image->size);
+		free(image);
+		return 1;
+	}
+
+	view->ops = &mappedOps;
+	view->impl = image;
+	view->pageCount = image->pageCount;
+	return 0;
+}
+
+
+
+/*
+* mapSnapshot(path, view) -- maps the snapshot at 'path' read-only and opens 'view' on it,
+* sharing the page cache with every other process mapping it. Returns 0 on success, 1 on error.
+*/
+int mapSnapshot(const char *path, struct graphView *view) {
+
+	int fd = open(path, O_RDONLY);
+	int failed = fd < 0 || mapImage(fd, view) != 0;
+
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	if (failed) {
+		fprintf(stderr, "Couldn't map the snapshot.\n");
+	}
+	return failed;
+}
+
+
+
+/*
+* attachSnapshot(name, view) -- maps the shared memory segment 'name' written by shareSnapshot()
+* read-only and opens 'view' on it. Every process attached to a segment uses the same memory, so
+* the graph takes it once however many of them there are. Returns 0 on success, 1 on error.
+*/
+int attachSnapshot(const char *name, struct graphView *view) {
+
+	char *segment = segmentName(name);
+	int fd = segment == NULL ? -1 : shm_open(segment, O_RDONLY, 0);
+	int failed = fd < 0 || mapImage(fd, view) != 0;
+
+	if (fd >= 0) {
+		close(fd);
+	}
+	free(segment);
+
+	if (failed) {
+		fprintf(stderr, "Couldn't attach the shared graph %s.\n", name);
+	}
+	return failed;
+}
@@ -0,0 +1,114 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "view.h"
+
+
+/*
+ * File: snapshot.h
+ * Author: Chance Krueger
+ * Purpose: Binary graph snapshots for fast restarts. @save writes the live graph
+ *          as a versioned file holding a name dictionary, a page array, the links
+ *          in CSR form (one offset per page into one target array) and a hashed
+ *          name table, each section with its own checksum. --load rebuilds the
+ *          graph from it with sequential reads; --map maps it read-only and
+ *          answers queries in place, sharing the page cache between processes.
+ *          --share builds the same layout into a POSIX shared memory segment,
+ *          which --attach maps read-only in any number of other processes.
+ */
+
+
+
+#define SNAPSHOT_MAGIC "WPLSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 64
+
+
+
+/*
+ * Snapshot sections, in file order.
+ */
+enum snapshotSectionId {
+	SECTION_NAMES,
+	SECTION_NAME_OFFSETS,
+	SECTION_OFFSETS,
+	SECTION_TARGETS,
+	SECTION_BUCKETS,
+	SECTION_COUNT
+};
+
+
+
+/*
+ * snapshotSection -- Where one section lives in the file, how long it is and its checksum.
+ */
+struct snapshotSection {
+
+
+	uint64_t offset;
+	uint64_t size;
+	uint64_t checksum;
+};
+
+
+
+/*
+ * snapshotHeader -- The header at the start of a snapshot. Every section
+ * starts on a SNAPSHOT_ALIGN boundary so a mapped file can be used in place:
+ * null-terminated names, `pageCount` 64-bit name offsets, `pageCount + 1` 64-bit
+ * CSR offsets, `edgeCount` 32-bit target page numbers, and `bucketCount` (a power
+ * of two) 32-bit name table slots holding page number + 1, or 0 when empty, placed
+ * by hashName() with linear probing. Fields are little-endian and `headerSum` covers
+ * the header bytes before it.
+ */
+struct snapshotHeader {
+
+
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint64_t pageCount;
+	uint64_t edgeCount;
+	uint64_t bucketCount;
+	struct snapshotSection sections[SECTION_COUNT];
+	uint64_t headerSum;
+};
+
+
+
+/*
+ * snapshotImage -- A snapshot's sections, located inside `base` (`size` bytes, read
+ * into memory or mapped with `mapped` set).
+ */
+struct snapshotImage {
+
+
+	void *base;
+	size_t size;
+	int mapped;
+	uint64_t pageCount;
+	uint64_t edgeCount;
+	uint64_t nameBytes;
+	uint64_t bucketCount;
+	const char *names;
+	const uint64_t *nameOffsets;
+	const uint64_t *offsets;
+	const uint32_t *targets;
+	const uint32_t *buckets;
+};
+
+
+
+uint64_t checksum64(const void *data, uint64_t len);
+int writeAll(int fd, const void *data, size_t len);
+int snapshotId(const char *path, uint64_t *id);
+int saveSnapshot(const char *path);
+int loadSnapshot(const char *path);
+int shareSnapshot(const char *name);
+int mapSnapshot(const char *path, struct graphView *view);
+int attachSnapshot(const char *name, struct graphView *view);
+
+#endif
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+
+/*
+ * File: stats.c
+ * Author: Chance Krueger
+ * Purpose: Implements the --stats histograms and report described in stats.h.
+ */
+
+
+
+/*
+ * Histogram buckets are HDR style: values below STAT_SUB nanoseconds get a bucket
+ * each, and every power of two above that is split into STAT_SUB buckets, so a
+ * percentile is within 1/STAT_SUB of the true value at any scale.
+ */
+#define STAT_SUB_BITS 4
+#define STAT_SUB (1 << STAT_SUB_BITS)
+#define STAT_BUCKETS ((64 - STAT_SUB_BITS + 1) << STAT_SUB_BITS)
+
+
+
+/*
+ * statBlock -- The histograms of one thread: `counts[kind][bucket]` calls of each
+ * stage per bucket, and per stage the total and longest time in nanoseconds. The
+ * merged report also fills in `calls`, the sum of a stage's buckets.
+ * Only its thread writes it, so recording takes no lock; the report reads it
+ * while that thread runs. When the thread exits the block is marked `idle` and
+ * the next new thread carries on filling it, so nothing recorded is lost.
+ */
+struct statBlock {
+
+
+	uint64_t counts[STAT_KINDS][STAT_BUCKETS];
+	uint64_t calls[STAT_KINDS];
+	uint64_t nanos[STAT_KINDS];
+	uint64_t longest[STAT_KINDS];
+	int idle;
+	struct statBlock *next;
+};
+
+
+
+static const char *statNames[STAT_KINDS] = {
+	"parse", "@addPages", "@addLinks", "@isConnected", "@removePages", "@removeLinks", "@save",
+	"@loadEdges", "addPageToGraph", "addLinkToPage", "findNode", "bulkFlush", "search", "startSearch"
+};
+
+int statsEnabled = 0;
+
+static struct statBlock *blocks = NULL;
+static pthread_mutex_t blockLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t blockKey;
+static __thread struct statBlock *threadBlock = NULL;
+static struct statBlock merged;
+static uint64_t startedAt;
+
+static sigset_t reportSignal;
+static pthread_t reporter;
+static int reporting = 0;
+static int stopping = 0;
+
+
+
+/*
+* bucketOf(nanos) -- returns the histogram bucket 'nanos' falls in.
+*/
+static int bucketOf(uint64_t nanos) {
+
+	if (nanos < STAT_SUB) {
+		return nanos;
+	}
+
+	int shift = 63 - __builtin_clzll(nanos) - STAT_SUB_BITS;
+	return ((shift + 1) << STAT_SUB_BITS) + ((nanos >> shift) & (STAT_SUB - 1));
+}
+
+
+
+/*
+* bucketTop(bucket) -- returns the largest value that falls in 'bucket'.
+*/
+static uint64_t bucketTop(int bucket) {
+
+	if (bucket < STAT_SUB) {
+		return bucket;
+	}
+
+	int shift = (bucket >> STAT_SUB_BITS) - 1;
+	uint64_t low = (uint64_t) (STAT_SUB + (bucket & (STAT_SUB - 1))) << shift;
+	return low + ((1ULL << shift) - 1);
+}
+
+
+
+/*
+* releaseBlock(block) -- marks the block of an exiting thread free for the next one.
+*/
+static void releaseBlock(void *block) {
+
+	pthread_mutex_lock(&blockLock);
+	((struct statBlock *) block)->idle = 1;
+	pthread_mutex_unlock(&blockLock);
+}
+
+
+
+/*
+* claimBlock() -- gives the calling thread a block, reusing one an exited thread left behind when
+* there is one. Returns NULL if out of memory, and the thread's stages then go untimed.
+*/
+static struct statBlock * claimBlock(void) {
+
+	struct statBlock *block;
+
+	pthread_mutex_lock(&blockLock);
+	for (block = blocks; block != NULL && !block->idle; block = block->next) {
+	}
+
+	if (block != NULL) {
+		block->idle = 0;
+	} else if ((block = calloc(1, sizeof(struct statBlock))) != NULL) {
+		block->next = blocks;
+		blocks = block;
+	}
+	pthread_mutex_unlock(&blockLock);
+
+	if (block != NULL) {
+		pthread_setspecific(blockKey, block);
+		threadBlock = block;
+	}
+	return block;
+}
+
+
+
+/*
+* bump(counter, by) -- adds 'by' to a counter only this thread writes, in a way the report can read
+* at the same time.
+*/
+static void bump(uint64_t *counter, uint64_t by) {
+
+	__atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + by, __ATOMIC_RELAXED);
+}
+
+
+
+/*
+* statsAdd(kind, nanos) -- records one call of stage 'kind' that took 'nanos' nanoseconds.
+*/
+void statsAdd(int kind, uint64_t nanos) {
+
+	struct statBlock *block = threadBlock != NULL ? threadBlock : claimBlock();
+
+	if (block == NULL) {
+		return;
+	}
+
+	bump(&block->counts[kind][bucketOf(nanos)], 1);
+	bump(&block->nanos[kind], nanos);
+	if (nanos > block->longest[kind]) {
+		__atomic_store_n(&block->longest[kind], nanos, __ATOMIC_RELAXED);
+	}
+}
+
+
+
+/*
+* percentile(kind, fraction) -- returns the time within which 'fraction' of the merged calls of
+* stage 'kind' finished, in nanoseconds.
+*/
+static uint64_t percentile(int kind, double fraction) {
+
+	uint64_t rank = fraction * merged.calls[kind];
+	uint64_t seen = 0;
+
+	// THE NEAREST RANK: THE CALL AT OR JUST ABOVE THE FRACTION, AND AT LEAST THE FIRST
+	rank += rank < fraction * merged.calls[kind] || rank == 0;
+
+	for (int bucket = 0; bucket < STAT_BUCKETS; bucket++) {
+		seen += merged.counts[kind][bucket];
+		if (seen >= rank) {
+			uint64_t top = bucketTop(bucket);
+			return top < merged.longest[kind] ? top : merged.longest[kind];
+		}
+	}
+	return merged.longest[kind];
+}
+
+
+
+/*
+* statsReport() -- merges the histograms of every thread and prints, for each stage that ran, its
+* calls, total time, calls per second since statsStart() and its p50/p99/p999 and longest latency
+* to stderr.
+*/
+void statsReport(void) {
+
+	uint64_t elapsed = statsBegin() - startedAt;
+	uint64_t commands = 0;
+	uint64_t commandNanos = 0;
+
+	memset(&merged, 0, sizeof(merged));
+
+	pthread_mutex_lock(&blockLock);
+	for (struct statBlock *block = blocks; block != NULL; block = block->next) {
+		for (int kind = 0; kind < STAT_KINDS; kind++) {
+			for (int bucket = 0; bucket < STAT_BUCKETS; bucket++) {
+				uint64_t count = __atomic_load_n(&block->counts[kind][bucket], __ATOMIC_RELAXED);
+				merged.counts[kind][bucket] += count;
+				merged.calls[kind] += count;
+			}
+			merged.nanos[kind] += __atomic_load_n(&block->nanos[kind], __ATOMIC_RELAXED);
+			uint64_t longest = __atomic_load_n(&block->longest[kind], __ATOMIC_RELAXED);
+			merged.longest[kind] = longest > merged.longest[kind] ? longest : merged.longest[kind];
+		}
+	}
+	pthread_mutex_unlock(&blockLock);
+
+	double seconds = elapsed / 1e9;
+
+	fprintf(stderr, "stats after %.3f s:\n", seconds);
+	fprintf(stderr, "%-16s %12s %12s %12s %10s %10s %10s %10s\n", "stage", "calls", "total ms", "calls/s",
+		"p50 us", "p99 us", "p999 us", "max us");
+
+	for (int kind = 0; kind < STAT_KINDS; kind++) {
+
+		if (merged.calls[kind] == 0) {
+			continue;
+		}
+		if (kind >= STAT_ADD_PAGES && kind <= STAT_LOAD_EDGES) {
+			commands += merged.calls[kind];
+			commandNanos += merged.nanos[kind];
+		}
+
+		fprintf(stderr, "%-16s %12llu %12.3f %12.0f %10.3f %10.3f %10.3f %10.3f\n", statNames[kind],
+			(unsigned long long) merged.calls[kind], merged.nanos[kind] / 1e6,
+			seconds > 0 ? merged.calls[kind] / seconds : 0, percentile(kind, 0.5) / 1e3,
+			percentile(kind, 0.99) / 1e3, percentile(kind, 0.999) / 1e3, merged.longest[kind] / 1e3);
+	}
+
+	fprintf(stderr, "%-16s %12llu %12.3f %12.0f\n", "commands", (unsigned long long) commands,
+		commandNanos / 1e6, seconds > 0 ? commands / seconds : 0);
+}
+
+
+
+/*
+* reportThread(arg) -- prints a report every time the process gets SIGUSR1, until statsStop().
+*/
+static void * reportThread(void *arg) {
+
+	int sig;
+
+	while (sigwait(&reportSignal, &sig) == 0 && !__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+		statsReport();
+	}
+	return NULL;
+}
+
+
+
+/*
+* statsStart() -- starts the clock throughput is measured against and a thread that reports on
+* SIGUSR1. It must run before any other thread is started: SIGUSR1 is blocked here, and every later
+* thread inherits that, so the signal only ever reaches the reporting thread. Returns 0 on success,
+* 1 if the reporting thread can't be started, in which case only the report at exit is printed.
+*/
+int statsStart(void) {
+
+	statsEnabled = 1;
+	startedAt = statsBegin();
+	pthread_key_create(&blockKey, releaseBlock);
+
+	sigemptyset(&reportSignal);
+	sigaddset(&reportSignal, SIGUSR1);
+
+	if (pthread_sigmask(SIG_BLOCK, &reportSignal, NULL) != 0 ||
+	    pthread_create(&reporter, NULL, reportThread, NULL) != 0) {
+		fprintf(stderr, "Couldn't start the --stats reporter.\n");
+		return 1;
+	}
+	reporting = 1;
+	return 0;
+}
+
+
+
+/*
+* statsStop() -- stops the reporting thread, prints the final report and frees the histograms.
+* Every other thread must have finished. It may be called without statsStart().
+*/
+void statsStop(void) {
+
+	if (!statsEnabled) {
+		return;
+	}
+
+	if (reporting) {
+		__atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+		pthread_kill(reporter, SIGUSR1);
+		pthread_join(reporter, NULL);
+		reporting = 0;
+	}
+
+	statsReport();
+	statsEnabled = 0;
+
+	while (blocks != NULL) {
+		struct statBlock *next = blocks->next;
+		free(blocks);
+		blocks = next;
+	}
+	threadBlock = NULL;
+	pthread_key_delete(blockKey);
+}
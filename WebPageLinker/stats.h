@@ -0,0 +1,88 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+
+/*
+ * File: stats.h
+ * Author: Chance Krueger
+ * Purpose: Latency histograms for --stats. Each timed stage (parsing a line, each
+ *          command, addPageToGraph, addLinkToPage, findNode, the reachability
+ *          search ...) records how long every call took on the monotonic clock
+ *          into a log-bucketed histogram of its own thread, so recording takes no
+ *          lock. At exit, and whenever the process gets SIGUSR1, the histograms of
+ *          all threads are merged and p50/p99/p999 latency, throughput and totals
+ *          are printed to stderr. Without --stats a stage costs one test of
+ *          `statsEnabled` and never reads the clock.
+ */
+
+
+
+/*
+ * statKind -- The stages that are timed. Stages nest: a command's time includes
+ * the findNode() calls it makes, and an @isConnected only queues its query, whose
+ * search is timed as STAT_SEARCH when the batch is answered.
+ */
+enum statKind {
+	STAT_PARSE,
+	STAT_ADD_PAGES,
+	STAT_ADD_LINKS,
+	STAT_IS_CONNECTED,
+	STAT_REMOVE_PAGES,
+	STAT_REMOVE_LINKS,
+	STAT_SAVE,
+	STAT_LOAD_EDGES,
+	STAT_ADD_PAGE,
+	STAT_ADD_LINK,
+	STAT_FIND_NODE,
+	STAT_BULK_FLUSH,
+	STAT_SEARCH,
+	STAT_START_SEARCH,
+	STAT_KINDS
+};
+
+
+
+/*
+ * Set by --stats before statsStart(); nothing is timed while it is 0.
+ */
+extern int statsEnabled;
+
+int statsStart(void);
+void statsAdd(int kind, uint64_t nanos);
+void statsReport(void);
+void statsStop(void);
+
+
+
+/*
+* statsBegin() -- returns the monotonic clock in nanoseconds to time a stage from, or 0 when
+* nothing is being timed.
+*/
+static inline uint64_t statsBegin(void) {
+
+	struct timespec ts;
+
+	if (!statsEnabled) {
+		return 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+
+/*
+* statsEnd(kind, start) -- records the time since 'start', taken by statsBegin(), as one call of
+* stage 'kind'.
+*/
+static inline void statsEnd(int kind, uint64_t start) {
+
+	if (start != 0) {
+		statsAdd(kind, statsBegin() - start);
+	}
+}
+
+#endif
@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "reader.h"
+#include "binproto.h"
+
+
+/*
+ * File: binconv.c
+ * Author: Chance Krueger
+ * Purpose: Converts between the text commands and the binary frames of binproto.h.
+ *          Runs of two-page @isConnected lines become one BIN_QUERY_BATCH frame,
+ *          and --results turns the result bytes of a --binary run back into the
+ *          lines the text syntax would have printed.
+ *          Usage: binconv --to-binary|--to-text|--results [file]
+ */
+
+
+
+#define BATCH_QUERIES 4096
+#define FLUSH_BYTES (1 << 20)
+
+
+
+/*
+ * queryBatch -- Consecutive @isConnected pairs waiting to be sent as one frame.
+ * The names are copied into `bytes`, since the lines they came from are reused.
+ */
+struct queryBatch {
+
+
+	char *bytes;
+	size_t used;
+	size_t cap;
+	size_t offsets[2 * BATCH_QUERIES];
+	size_t lens[2 * BATCH_QUERIES];
+	size_t count;
+};
+
+
+
+/*
+* writeOut(bytes, len) -- appends 'len' bytes to stdout. Returns 0 on success, 1 if the write fails.
+*/
+int writeOut(const void *bytes, size_t len) {
+
+	if (len > 0 && fwrite(bytes, 1, len, stdout) != len) {
+		fprintf(stderr, "Couldn't write the output.\n");
+		return 1;
+	}
+	return 0;
+}
+
+
+
+/*
+* flushFrames(frames, len, least) -- writes the '*len' encoded bytes at 'frames' once there are at least
+* 'least' of them. Returns 0 on success, 1 if the write fails.
+*/
+int flushFrames(uint8_t *frames, size_t *len, size_t least) {
+
+	if (*len < least || *len == 0) {
+		return 0;
+	}
+
+	int failed = writeOut(frames, *len);
+	*len = 0;
+	return failed;
+}
+
+
+
+/*
+* flushBatch(batch, names, frames, len, cap) -- encodes the queries in 'batch' as one frame.
+* Returns 0 on success, 1 if out of memory.
+*/
+int flushBatch(struct queryBatch *batch, struct binNames *names, uint8_t **frames, size_t *len, size_t *cap) {
+
+	struct token pairs[2 * BATCH_QUERIES];
+
+	if (batch->count == 0) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < batch->count; i++) {
+		pairs[i].ptr = batch->bytes + batch->offsets[i];
+		pairs[i].len = batch->lens[i];
+	}
+
+	int failed = binEncode(names, BIN_QUERY_BATCH, pairs, batch->count, frames, len, cap);
+	batch->count = 0;
+	batch->used = 0;
+	return failed;
+}
+
+
+
+/*
+* batchAdd(batch, name) -- copies 'name' into 'batch'. Returns 0 on success, 1 if out of memory.
+*/
+int batchAdd(struct queryBatch *batch, struct token name) {
+
+	if (batch->used + name.len > batch->cap) {
+		size_t newCap = batch->cap == 0 ? 4096 : batch->cap;
+		while (newCap < batch->used + name.len) {
+			newCap *= 2;
+		}
+		char *grown = realloc(batch->bytes, newCap);
+		if (grown == NULL) {
+			fprintf(stderr, "Ran Out Of Memory.\n");
+			return 1;
+		}
+		batch->bytes = grown;
+		batch->cap = newCap;
+	}
+
+	memcpy(batch->bytes + batch->used, name.ptr, name.len);
+	batch->offsets[batch->count] = batch->used;
+	batch->lens[batch->count] = name.len;
+	batch->used += name.len;
+	batch->count++;
+	return 0;
+}
+
+
+
+/*
+* toBinary(reader) -- writes the text commands read from 'reader' as binary frames. Lines that
+* don't start with a known action word are reported and left out. Returns the number of errors.
+*/
+int toBinary(struct lineReader *reader) {
+
+	static struct queryBatch batch;
+	struct binNames names = { 0 };
+	struct token *words = NULL;
+	size_t wordCap = 0;
+	uint8_t *frames = NULL;
+	size_t len = 0;
+	size_t cap = 0;
+	const char *line;
+	size_t lineLen;
+	size_t lineNumber = 0;
+	int errors = 0;
+	int status;
+
+	while ((status = readerNext(reader, &line, &lineLen)) > 0) {
+
+		size_t count = tokenize(line, lineLen, &words, &wordCap);
+		int tag = count > 0 ? commandTag(words[0]) : CMD_INVALID;
+		int failed = 0;
+
+		lineNumber++;
+		if (count == 0) {
+			continue;
+		}
+
+		if (tag == CMD_INVALID) {
+			fprintf(stderr, "Invalid command on line %zu.\n", lineNumber);
+			errors++;
+			continue;
+		}
+
+		// A QUERY JOINS THE CURRENT BATCH, ANYTHING ELSE SENDS THE BATCH FIRST
+		if (tag == CMD_IS_CONNECTED && count == 3) {
+			failed = batchAdd(&batch, words[1]) || batchAdd(&batch, words[2]);
+			if (!failed && batch.count == 2 * BATCH_QUERIES) {
+				failed = flushBatch(&batch, &names, &frames, &len, &cap);
+			}
+		} else {
+			failed = flushBatch(&batch, &names, &frames, &len, &cap) ||
+				 binEncode(&names, tag, words + 1, count - 1, &frames, &len, &cap);
+		}
+
+		if (failed || flushFrames(frames, &len, FLUSH_BYTES) != 0) {
+			errors++;
+			break;
+		}
+	}
+
+	if (status < 0) {
+		fprintf(stderr, "Couldn't read the input.\n");
+		errors++;
+	}
+
+	errors += flushBatch(&batch, &names, &frames, &len, &cap) || flushFrames(frames, &len, 0);
+	free(batch.bytes);
+	free(frames);
+	free(words);
+	binNamesFree(&names);
+	return errors;
+}
+
+
+
+/*
+* writeLine(action, args, count) -- writes one text command. Returns 0 on success, 1 if the write fails.
+*/
+int writeLine(struct token action, const struct token *args, size_t count) {
+
+	int failed = writeOut(action.ptr, action.len);
+
+	for (size_t i = 0; i < count; i++) {
+		failed |= writeOut(" ", 1) || writeOut(args[i].ptr, args[i].len);
+	}
+	return failed | writeOut("\n", 1);
+}
+
+
+
+/*
+* toText(reader) -- writes the binary frames read from 'reader' as text commands, one line per
+* command and per query of a batch. Returns the number of errors.
+*/
+int toText(struct lineReader *reader) {
+
+	struct binNames names = { 0 };
+	struct token *args = NULL;
+	size_t argCap = 0;
+	const char *prefix;
+	const char *body;
+	int errors = 0;
+	int status;
+
+	while ((status = readerTake(reader, 4, &prefix)) > 0) {
+
+		const unsigned char *bytes = (const unsigned char *) prefix;
+		uint32_t len = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+		int opcode;
+		size_t count;
+
+		if (len == 0 || len > BIN_MAX_FRAME || readerTake(reader, len, &body) <= 0) {
+			status = -1;
+			break;
+		}
+
+		if (binDecode(&names, (const uint8_t *) body, len, &opcode, &args, &count, &argCap) != 0 ||
+		    binActionWord(opcode).len == 0 || (opcode == BIN_QUERY_BATCH && count % 2 != 0)) {
+			fprintf(stderr, "Invalid binary command.\n");
+			errors++;
+			continue;
+		}
+
+		struct token action = binActionWord(opcode);
+
+		if (opcode != BIN_QUERY_BATCH) {
+			errors += writeLine(action, args, count);
+		}
+		for (size_t i = 0; opcode == BIN_QUERY_BATCH && i < count; i += 2) {
+			errors += writeLine(action, args + i, 2);
+		}
+	}
+
+	if (status < 0) {
+		fprintf(stderr, "Couldn't read the input.\n");
+		errors++;
+	}
+
+	free(args);
+	binNamesFree(&names);
+	return errors;
+}
+
+
+
+/*
+* toResults(reader) -- writes the result bytes read from 'reader' as the lines of 1 and 0 the
+* text syntax prints. Failed queries print nothing there, so they are left out here too.
+* Returns the number of errors.
+*/
+int toResults(struct lineReader *reader) {
+
+	const char *byte;
+	int errors = 0;
+	int status;
+
+	while ((status = readerTake(reader, 1, &byte)) > 0) {
+		if ((unsigned char) *byte == BIN_CONNECTED) {
+			errors += writeOut("1\n", 2);
+		} else if ((unsigned char) *byte == BIN_NOT_CONNECTED) {
+			errors += writeOut("0\n", 2);
+		}
+	}
+
+	if (status < 0) {
+		fprintf(stderr, "Couldn't read the input.\n");
+		errors++;
+	}
+	return errors;
+}
+
+
+
+int main(int argc, char *argv[]) {
+
+	struct lineReader reader;
+	int errors;
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: binconv --to-binary|--to-text|--results [file]\n");
+		return 1;
+	}
+
+	if (readerOpen(&reader, argc == 3 ? argv[2] : NULL) != 0) {
+		fprintf(stderr, "Couldn't open the file given.\n");
+		return 1;
+	}
+
+	if (strcmp(argv[1], "--to-binary") == 0) {
+		errors = toBinary(&reader);
+	} else if (strcmp(argv[1], "--to-text") == 0) {
+		errors = toText(&reader);
+	} else if (strcmp(argv[1], "--results") == 0) {
+		errors = toResults(&reader);
+	} else {
+		fprintf(stderr, "Usage: binconv --to-binary|--to-text|--results [file]\n");
+		errors = 1;
+	}
+
+	errors += readerClose(&reader);
+	errors += fflush(stdout) != 0;
+	return errors > 0;
+}
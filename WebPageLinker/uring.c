@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "uring.h"
+
+
+/*
+ * File: uring.c
+ * Author: Chance Krueger
+ * Purpose: Implements the io_uring wrapper described in uring.h.
+ */
+
+
+
+int uringDisabled = 0;
+
+
+
+/*
+* uringInit(ring, entries) -- sets up 'ring' with room for 'entries' requests at once. Rings that
+* can't read and write at the current file position (kernels before 5.6) aren't used, since pipes
+* have no other. Returns 0 on success, 1 if io_uring can't be used.
+*/
+int uringInit(struct uring *ring, unsigned entries) {
+
+	struct io_uring_params params;
+
+	memset(ring, 0, sizeof(struct uring));
+	memset(&params, 0, sizeof(params));
+
+	if (uringDisabled) {
+		return 1;
+	}
+
+	ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (ring->fd < 0) {
+		return 1;
+	}
+
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_RW_CUR_POS)) {
+		close(ring->fd);
+		return 1;
+	}
+
+	size_t sqLen = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	size_t cqLen = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+	ring->ringsLen = sqLen > cqLen ? sqLen : cqLen;
+	ring->sqesLen = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->rings = mmap(NULL, ring->ringsLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	ring->sqes = mmap(NULL, ring->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+	if (ring->rings == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		if (ring->rings != MAP_FAILED) {
+			munmap(ring->rings, ring->ringsLen);
+		}
+		if (ring->sqes != MAP_FAILED) {
+			munmap(ring->sqes, ring->sqesLen);
+		}
+		close(ring->fd);
+		return 1;
+	}
+
+	char *base = ring->rings;
+
+	ring->sqHead = (unsigned *) (base + params.sq_off.head);
+	ring->sqTail = (unsigned *) (base + params.sq_off.tail);
+	ring->sqMask = (unsigned *) (base + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned *) (base + params.sq_off.array);
+	ring->sqEntries = params.sq_entries;
+	ring->cqHead = (unsigned *) (base + params.cq_off.head);
+	ring->cqTail = (unsigned *) (base + params.cq_off.tail);
+	ring->cqMask = (unsigned *) (base + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *) (base + params.cq_off.cqes);
+	return 0;
+}
+
+
+
+/*
+* uringRegister(ring, buffers, count) -- registers the 'count' buffers described by 'buffers' with
+* 'ring', so the kernel maps them once instead of on every request. Requests name them by their
+* index in 'buffers'. Returns 0 on success, 1 if they can't be registered.
+*/
+int uringRegister(struct uring *ring, const struct iovec *buffers, unsigned count) {
+
+	return syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, buffers, count) != 0;
+}
+
+
+
+/*
+* queueRequest(ring, opcode, fd, buf, len, index, offset, tag) -- writes a request to the submission
+* ring for the next uringSubmit(). Returns 0 on success, 1 if the ring is full.
+*/
+static int queueRequest(struct uring *ring, int opcode, int fd, const void *buf, size_t len, int index,
+			off_t offset, uint64_t tag) {
+
+	unsigned tail = *ring->sqTail;
+
+	if (tail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) >= ring->sqEntries) {
+		return 1;
+	}
+
+	unsigned slot = tail & *ring->sqMask;
+	struct io_uring_sqe *sqe = &ring->sqes[slot];
+
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t) buf;
+	sqe->len = len;
+	sqe->off = offset < 0 ? (uint64_t) -1 : (uint64_t) offset;
+	sqe->buf_index = index;
+	sqe->user_data = tag;
+
+	ring->sqArray[slot] = slot;
+	__atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+	ring->queued++;
+	return 0;
+}
+
+
+
+/*
+* uringRead(ring, fd, buf, len, index, offset, tag) -- queues a read of up to 'len' bytes from 'fd'
+* at 'offset' (-1 for the current position) into 'buf', which lies in registered buffer 'index'.
+* Its completion carries 'tag'. Returns 0 on success, 1 if the ring is full.
+*/
+int uringRead(struct uring *ring, int fd, void *buf, size_t len, int index, off_t offset, uint64_t tag) {
+
+	return queueRequest(ring, IORING_OP_READ_FIXED, fd, buf, len, index, offset, tag);
+}
+
+
+
+/*
+* uringWrite(ring, fd, buf, len, index, offset, tag) -- queues a write of 'len' bytes from 'buf',
+* which lies in registered buffer 'index', to 'fd' at 'offset' (-1 for the current position). Its
+* completion carries 'tag'. Returns 0 on success, 1 if the ring is full.
+*/
+int uringWrite(struct uring *ring, int fd, const void *buf, size_t len, int index, off_t offset, uint64_t tag) {
+
+	return queueRequest(ring, IORING_OP_WRITE_FIXED, fd, buf, len, index, offset, tag);
+}
+
+
+
+/*
+* uringSubmit(ring, waitFor) -- hands every queued request to the kernel and waits until
+* 'waitFor' requests have finished, all in one system call. A signal can end the wait early, so
+* callers reap what there is and wait again if they need more. Returns 0 on success, 1 on error.
+*/
+int uringSubmit(struct uring *ring, unsigned waitFor) {
+
+	while (1) {
+
+		int taken = syscall(__NR_io_uring_enter, ring->fd, ring->queued, waitFor,
+				    waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+		if (taken >= 0) {
+			ring->queued -= taken;
+			if (ring->queued == 0) {
+				return 0;
+			}
+		} else if (errno == EINTR) {
+			if (ring->queued == 0) {
+				return 0;
+			}
+		} else if (errno != EAGAIN && errno != EBUSY) {
+			return 1;
+		}
+	}
+}
+
+
+
+/*
+* uringReap(ring, tag, result) -- takes the oldest finished request off the completion ring,
+* storing its tag in '*tag' and its result (a byte count, or minus an errno) in '*result'.
+* Returns 1 if there was one, 0 if none has finished.
+*/
+int uringReap(struct uring *ring, uint64_t *tag, int *result) {
+
+	unsigned head = *ring->cqHead;
+
+	if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+
+	struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+
+	*tag = cqe->user_data;
+	*result = cqe->res;
+	__atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+
+
+/*
+* uringFree(ring) -- tears down 'ring'. Every request on it must have finished.
+*/
+void uringFree(struct uring *ring) {
+
+	munmap(ring->sqes, ring->sqesLen);
+	munmap(ring->rings, ring->ringsLen);
+	close(ring->fd);
+}
@@ -0,0 +1,63 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+
+/*
+ * File: uring.h
+ * Author: Chance Krueger
+ * Purpose: A minimal io_uring, set up with the raw system calls so no library is
+ *          needed. Reads and writes go into registered buffers, any number of them
+ *          are queued and submitted with one system call, which can also wait for
+ *          the first to finish. When the kernel has no io_uring, or it is blocked,
+ *          uringInit() fails and callers keep to plain read() and write().
+ */
+
+
+
+/*
+ * uring -- One ring, used by one thread at a time. `sqHead` to `sqArray` and
+ * `cqHead` to `cqes` point into the rings shared with the kernel, mapped at `rings`;
+ * `queued` requests have been written to the submission ring but not yet submitted.
+ */
+struct uring {
+
+
+	int fd;
+	void *rings;
+	size_t ringsLen;
+	struct io_uring_sqe *sqes;
+	size_t sqesLen;
+	unsigned *sqHead;
+	unsigned *sqTail;
+	unsigned *sqMask;
+	unsigned *sqArray;
+	unsigned sqEntries;
+	unsigned *cqHead;
+	unsigned *cqTail;
+	unsigned *cqMask;
+	struct io_uring_cqe *cqes;
+	unsigned queued;
+};
+
+
+
+/*
+ * Set by --no-uring: every uringInit() fails, so all input and output takes the
+ * plain read() and write() path.
+ */
+extern int uringDisabled;
+
+int uringInit(struct uring *ring, unsigned entries);
+int uringRegister(struct uring *ring, const struct iovec *buffers, unsigned count);
+int uringRead(struct uring *ring, int fd, void *buf, size_t len, int index, off_t offset, uint64_t tag);
+int uringWrite(struct uring *ring, int fd, const void *buf, size_t len, int index, off_t offset, uint64_t tag);
+int uringSubmit(struct uring *ring, unsigned waitFor);
+int uringReap(struct uring *ring, uint64_t *tag, int *result);
+void uringFree(struct uring *ring);
+
+#endif
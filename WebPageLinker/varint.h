@@ -0,0 +1,75 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * File: varint.h
+ * Author: Chance Krueger
+ * Purpose: LEB128 variable length integers, shared by the packed link lists and
+ *          the binary command format: seven bits per byte, low bits first, with
+ *          the high bit of each byte marking that another follows.
+ */
+
+
+
+/*
+* putVarint(out, value) -- writes 'value' at 'out' seven bits per byte, low bits first, with the
+* high bit of each byte marking that another follows. Returns the number of bytes written.
+*/
+static inline size_t putVarint(uint8_t *out, uint64_t value) {
+
+	size_t len = 0;
+
+	while (value >= 0x80) {
+		out[len++] = (uint8_t) value | 0x80;
+		value >>= 7;
+	}
+	out[len++] = (uint8_t) value;
+	return len;
+}
+
+
+
+/*
+* getVarint(ptr) -- reads the varint at '*ptr' and advances '*ptr' past it.
+*/
+static inline uint64_t getVarint(const uint8_t **ptr) {
+
+	const uint8_t *p = *ptr;
+	uint64_t value = *p & 0x7F;
+	int shift = 7;
+
+	while (*p++ & 0x80) {
+		value |= (uint64_t) (*p & 0x7F) << shift;
+		shift += 7;
+	}
+	*ptr = p;
+	return value;
+}
+
+
+
+/*
+* readVarint(ptr, end, value) -- like getVarint(), for input that can't be trusted: stops at
+* 'end' and after ten bytes. Returns 0 with the value in '*value', or 1 if it is cut off or too long.
+*/
+static inline int readVarint(const uint8_t **ptr, const uint8_t *end, uint64_t *value) {
+
+	const uint8_t *p = *ptr;
+	uint64_t result = 0;
+
+	for (int shift = 0; p < end && shift < 70; shift += 7) {
+		result |= (uint64_t) (*p & 0x7F) << shift;
+		if ((*p++ & 0x80) == 0) {
+			*ptr = p;
+			*value = result;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+#endif
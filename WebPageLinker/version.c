@@ -0,0 +1,845 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
+
+#include "WebPageLinker.h"
+#include "packed.h"
+#include "version.h"
+
+
+/*
+ * File: version.c
+ * Author: Chance Krueger
+ * Purpose: Implements the published graph versions described in version.h.
+ */
+
+
+
+#define CHUNK_BITS 8
+#define CHUNK_SIZE (1 << CHUNK_BITS)
+#define CHUNK_MASK (CHUNK_SIZE - 1)
+#define ARENA_BLOCK (256 << 10)
+#define MIN_NAME_SLOTS 1024
+#define MIN_DELTA_BYTES (1 << 20)
+
+
+
+/*
+ * pageChunk -- CHUNK_SIZE consecutive page numbers of a version. `lists[i]` is NULL
+ * while the page still has its base links, removedList once it is removed, or else
+ * its link count followed by the page numbers it links to; `names[i]` is the name of
+ * a page added after the base. A chunk belongs to the version whose `seq` it carries
+ * and is copied before a later version changes it.
+ */
+struct pageChunk {
+
+
+	unsigned long seq;
+	const uint32_t *lists[CHUNK_SIZE];
+	const char *names[CHUNK_SIZE];
+};
+
+
+
+/*
+ * nameChunk -- CHUNK_SIZE slots of the open addressing table that finds pages added
+ * after the base by name: page number + 1, or 0 when empty. Copied like a pageChunk.
+ */
+struct nameChunk {
+
+
+	unsigned long seq;
+	uint32_t ids[CHUNK_SIZE];
+};
+
+
+
+/*
+ * arenaBlock -- One block of the memory a base hands out to the versions built on it.
+ */
+struct arenaBlock {
+
+
+	struct arenaBlock *next;
+	size_t used;
+	size_t cap;
+	unsigned char bytes[];
+};
+
+
+
+/*
+ * versionBase -- A packed graph and everything the versions built on it allocate:
+ * chunks, link lists and names all come from `blocks` and are freed together once
+ * the last of its `versions` is. An `adopted` base is the view queries were already
+ * answered from when the server started; it is copied into the list graph
+ * (`thawed`) before the first change. The base is repacked once the versions on it
+ * have allocated `deltaLimit` bytes or added half as many pages as there are
+ * `nameSlots`.
+ */
+struct versionBase {
+
+
+	struct graphView view;
+	int adopted;
+	int thawed;
+	size_t versions;
+	size_t nameSlots;
+	size_t deltaBytes;
+	size_t deltaLimit;
+	struct arenaBlock *blocks;
+};
+
+
+
+/*
+ * versionReader -- The version one reader thread is searching, by `seq`, or 0 while
+ * it is idle. Each sits on a cache line of its own.
+ */
+struct versionReader {
+
+
+	_Alignas(64) atomic_ulong seq;
+};
+
+
+
+/*
+ * dirtyName -- A page named by a command since the last version was published, and
+ * whether that command removed it.
+ */
+struct dirtyName {
+
+
+	char *name;
+	int removed;
+};
+
+static const uint32_t emptyList[1] = { 0 };
+static const uint32_t removedList[1] = { 0 };
+
+static struct versionReader *readers = NULL;
+static size_t readerCount = 0;
+static struct graphVersion *current = NULL;
+static struct graphVersion *retiredHead = NULL;
+static struct graphVersion *retiredTail = NULL;
+static unsigned long lastSeq = 0;
+static struct dirtyName *dirty = NULL;
+static size_t dirtyCount = 0;
+static size_t dirtyCap = 0;
+static int changed = 0;
+static int repack = 0;
+
+
+
+/*
+* baseAlloc(base, size) -- hands out 'size' bytes, 8-byte aligned, that live as long as 'base'.
+* Returns NULL if out of memory.
+*/
+static void * baseAlloc(struct versionBase *base, size_t size) {
+
+	size = (size + 7) & ~(size_t) 7;
+
+	if (base->blocks == NULL || base->blocks->used + size > base->blocks->cap) {
+
+		size_t cap = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+		struct arenaBlock *block = malloc(sizeof(struct arenaBlock) + cap);
+
+		if (block == NULL) {
+			return NULL;
+		}
+		block->next = base->blocks;
+		block->used = 0;
+		block->cap = cap;
+		base->blocks = block;
+	}
+
+	void *item = base->blocks->bytes + base->blocks->used;
+	base->blocks->used += size;
+	base->deltaBytes += size;
+	return item;
+}
+
+
+
+/*
+* baseFree(base) -- closes the packed graph of 'base' and frees it with everything built on it.
+*/
+static void baseFree(struct versionBase *base) {
+
+	viewClose(&base->view);
+
+	while (base->blocks != NULL) {
+		struct arenaBlock *next = base->blocks->next;
+		free(base->blocks);
+		base->blocks = next;
+	}
+	free(base);
+}
+
+
+
+/*
+* pageList(version, page) -- returns the list entry 'version' keeps for 'page': NULL while it has
+* its base links.
+*/
+static const uint32_t * pageList(const struct graphVersion *version, uint32_t page) {
+
+	if ((page >> CHUNK_BITS) >= version->pageChunks) {
+		return NULL;
+	}
+
+	const struct pageChunk *chunk = version->pages[page >> CHUNK_BITS];
+	return chunk == NULL ? NULL : chunk->lists[page & CHUNK_MASK];
+}
+
+
+
+/*
+* addedName(version, page) -- returns the name of 'page', added after the base of 'version'.
+*/
+static const char * addedName(const struct graphVersion *version, uint32_t page) {
+
+	return version->pages[page >> CHUNK_BITS]->names[page & CHUNK_MASK];
+}
+
+
+
+/*
+* findAdded(version, name, slot) -- probes the name table of 'version' for 'name', leaving the slot
+* where the search stopped in '*slot'. Returns its page number, or -1 if it wasn't added after
+* the base.
+*/
+static int64_t findAdded(const struct graphVersion *version, struct token name, size_t *slot) {
+
+	size_t mask = version->base->nameSlots - 1;
+
+	*slot = hashName(name) & mask;
+
+	while (1) {
+
+		const struct nameChunk *chunk = version->names[*slot >> CHUNK_BITS];
+		uint32_t entry = chunk == NULL ? 0 : chunk->ids[*slot & CHUNK_MASK];
+
+		if (entry == 0) {
+			return -1;
+		}
+
+		const char *stored = addedName(version, entry - 1);
+		if (strncmp(stored, name.ptr, name.len) == 0 && stored[name.len] == 0) {
+			return entry - 1;
+		}
+		*slot = (*slot + 1) & mask;
+	}
+}
+
+
+
+/*
+* versionLookup(impl, name) -- viewOps lookup for a version: pages added since the base first,
+* then the base, skipping removed pages.
+*/
+static int64_t versionLookup(const void *impl, struct token name) {
+
+	const struct graphVersion *version = impl;
+	const struct graphView *base = &version->base->view;
+	int64_t page = -1;
+	size_t slot;
+
+	if (version->addedCount > 0) {
+		page = findAdded(version, name, &slot);
+	}
+	if (page < 0) {
+		page = base->ops->lookup(base->impl, name);
+	}
+	return page >= 0 && pageList(version, page) == removedList ? -1 : page;
+}
+
+
+
+/*
+* versionSuccessors(impl, page, scratch, out) -- viewOps successors for a version: the list it keeps
+* for 'page', or else the base's, without the pages removed since.
+*/
+static uint32_t versionSuccessors(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out) {
+
+	const struct graphVersion *version = impl;
+	const struct graphView *base = &version->base->view;
+	const uint32_t *list = pageList(version, page);
+	const uint32_t *targets = NULL;
+	uint32_t count = 0;
+
+	if (list != NULL) {
+		count = list[0];
+		targets = list + 1;
+	} else if (page < base->pageCount) {
+		count = base->ops->successors(base->impl, page, scratch, &targets);
+	}
+
+	if (version->removedCount == 0 || count == 0) {
+		*out = targets;
+		return count;
+	}
+
+	// THE BASE LIST MAY ALREADY BE IN THE BUFFER, AND IS FILTERED IN PLACE
+	if (targets != scratch->buf && scratchReserveBuf(scratch, count) != 0) {
+		return 0;
+	}
+
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		if (pageList(version, targets[i]) != removedList) {
+			scratch->buf[kept++] = targets[i];
+		}
+	}
+
+	*out = scratch->buf;
+	return kept;
+}
+
+static const struct viewOps versionOps = { "published version", versionLookup, versionSuccessors, NULL, NULL, NULL, NULL };
+
+
+
+/*
+* writablePages(version, page) -- returns the chunk of 'version' holding 'page', copied first if an
+* older version shares it. Returns NULL if out of memory.
+*/
+static struct pageChunk * writablePages(struct graphVersion *version, uint32_t page) {
+
+	struct pageChunk **slot = &version->pages[page >> CHUNK_BITS];
+
+	if (*slot == NULL || (*slot)->seq != version->seq) {
+
+		struct pageChunk *copy = baseAlloc(version->base, sizeof(struct pageChunk));
+
+		if (copy == NULL) {
+			return NULL;
+		}
+		if (*slot != NULL) {
+			memcpy(copy, *slot, sizeof(struct pageChunk));
+		} else {
+			memset(copy, 0, sizeof(struct pageChunk));
+		}
+		copy->seq = version->seq;
+		*slot = copy;
+	}
+	return *slot;
+}
+
+
+
+/*
+* writableNames(version, slot) -- returns the chunk of the name table of 'version' holding 'slot',
+* copied first if an older version shares it. Returns NULL if out of memory.
+*/
+static struct nameChunk * writableNames(struct graphVersion *version, size_t slot) {
+
+	struct nameChunk **entry = &version->names[slot >> CHUNK_BITS];
+
+	if (*entry == NULL || (*entry)->seq != version->seq) {
+
+		struct nameChunk *copy = baseAlloc(version->base, sizeof(struct nameChunk));
+
+		if (copy == NULL) {
+			return NULL;
+		}
+		if (*entry != NULL) {
+			memcpy(copy, *entry, sizeof(struct nameChunk));
+		} else {
+			memset(copy, 0, sizeof(struct nameChunk));
+		}
+		copy->seq = version->seq;
+		*entry = copy;
+	}
+	return *entry;
+}
+
+
+
+/*
+* setList(version, page, list) -- makes 'list' the list entry of 'page' in 'version'. Returns 0 on
+* success, 1 if out of memory.
+*/
+static int setList(struct graphVersion *version, uint32_t page, const uint32_t *list) {
+
+	struct pageChunk *chunk = writablePages(version, page);
+
+	if (chunk == NULL) {
+		return 1;
+	}
+	chunk->lists[page & CHUNK_MASK] = list;
+	return 0;
+}
+
+
+
+/*
+* addPage(version, name) -- gives 'name' the next page number of 'version', with no links yet, and
+* enters it in the name table (in place of an earlier page of that name). Returns 0 on success,
+* 1 if out of memory.
+*/
+static int addPage(struct graphVersion *version, struct token name) {
+
+	uint32_t page = version->pageCount;
+	char *copy = baseAlloc(version->base, name.len + 1);
+	struct pageChunk *chunk = writablePages(version, page);
+	size_t slot;
+
+	if (copy == NULL || chunk == NULL) {
+		return 1;
+	}
+	memcpy(copy, name.ptr, name.len);
+	copy[name.len] = 0;
+
+	findAdded(version, name, &slot);
+
+	struct nameChunk *names = writableNames(version, slot);
+	if (names == NULL) {
+		return 1;
+	}
+
+	chunk->lists[page & CHUNK_MASK] = emptyList;
+	chunk->names[page & CHUNK_MASK] = copy;
+	names->ids[slot & CHUNK_MASK] = page + 1;
+	version->pageCount++;
+	version->addedCount++;
+	return 0;
+}
+
+
+
+/*
+* relink(version, page, node) -- gives 'page' of 'version' the live links of the list graph page
+* 'node'. Every page they point to must already be numbered. Returns 0 on success, 1 if out of memory.
+*/
+static int relink(struct graphVersion *version, uint32_t page, struct page *node) {
+
+	uint32_t *list = baseAlloc(version->base, ((size_t) node->outCount + 1) * sizeof(uint32_t));
+	uint32_t count = 0;
+
+	if (list == NULL) {
+		return 1;
+	}
+
+	for (struct link *edge = node->edges; edge != NULL && count < (uint32_t) node->outCount; edge = edge->next) {
+		if (edge->to == NULL || edge->to->removed) {
+			continue;
+		}
+		int64_t target = versionLookup(version, pageToken(edge->to));
+		if (target >= 0) {
+			list[1 + count++] = target;
+		}
+	}
+
+	list[0] = count;
+	return setList(version, page, list);
+}
+
+
+
+/*
+* compareDirty(a, b) -- qsort order for dirty names.
+*/
+static int compareDirty(const void *a, const void *b) {
+
+	return strcmp(((const struct dirtyName *) a)->name, ((const struct dirtyName *) b)->name);
+}
+
+
+
+/*
+* clearDirty() -- forgets the names changed since the last version.
+*/
+static void clearDirty(void) {
+
+	for (size_t i = 0; i < dirtyCount; i++) {
+		free(dirty[i].name);
+	}
+	dirtyCount = 0;
+	changed = 0;
+	repack = 0;
+}
+
+
+
+/*
+* settleView(version) -- points the view of 'version' at its base when nothing has changed since
+* the base, so the base's own search is used, and at the version otherwise.
+*/
+static void settleView(struct graphVersion *version) {
+
+	int touched = version->removedCount > 0 || version->addedCount > 0;
+
+	for (size_t i = 0; !touched && i < version->pageChunks; i++) {
+		touched = version->pages[i] != NULL;
+	}
+
+	if (touched) {
+		version->view.ops = &versionOps;
+		version->view.impl = version;
+		version->view.pageCount = version->pageCount;
+	} else {
+		version->view = version->base->view;
+	}
+}
+
+
+
+/*
+* packVersion() -- makes a version on a new base packed from the list graph, or, for the first
+* version, on the view queries were being answered from. Returns it, or NULL on error.
+*/
+static struct graphVersion * packVersion(void) {
+
+	struct versionBase *base = calloc(1, sizeof(struct versionBase));
+	struct graphVersion *version = calloc(1, sizeof(struct graphVersion));
+
+	if (base == NULL || version == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		free(base);
+		free(version);
+		return NULL;
+	}
+
+	if (current == NULL && frozenView.ops != NULL) {
+		base->view = frozenView;
+		base->adopted = 1;
+		frozenView.ops = NULL;
+		frozenView.impl = NULL;
+	} else if (packPages(&base->view) != 0) {
+		free(base);
+		free(version);
+		return NULL;
+	}
+
+	base->nameSlots = MIN_NAME_SLOTS;
+	while (base->nameSlots < base->view.pageCount) {
+		base->nameSlots *= 2;
+	}
+	base->deltaLimit = MIN_DELTA_BYTES + 16 * (size_t) base->view.pageCount;
+	base->versions = 1;
+
+	version->base = base;
+	version->seq = ++lastSeq;
+	version->pageCount = base->view.pageCount;
+	settleView(version);
+	return version;
+}
+
+
+
+/*
+* deriveVersion(old) -- makes a version sharing the base and unchanged chunks of 'old', with the
+* pages named since it was published renumbered, removed or relinked to match the list graph.
+* Returns it, or NULL on error.
+*/
+static struct graphVersion * deriveVersion(const struct graphVersion *old) {
+
+	struct versionBase *base = old->base;
+	struct graphVersion *version = calloc(1, sizeof(struct graphVersion));
+	size_t nameChunks = base->nameSlots / CHUNK_SIZE;
+	size_t pageChunks = ((size_t) old->pageCount + dirtyCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	if (version == NULL || (version->pages = calloc(pageChunks + 1, sizeof(struct pageChunk *))) == NULL ||
+	    (version->names = calloc(nameChunks, sizeof(struct nameChunk *))) == NULL) {
+		goto failed;
+	}
+
+	if (old->pageChunks > 0) {
+		memcpy(version->pages, old->pages, old->pageChunks * sizeof(struct pageChunk *));
+	}
+	if (old->names != NULL) {
+		memcpy(version->names, old->names, nameChunks * sizeof(struct nameChunk *));
+	}
+
+	version->base = base;
+	version->seq = ++lastSeq;
+	version->pageCount = old->pageCount;
+	version->removedCount = old->removedCount;
+	version->addedCount = old->addedCount;
+	version->pageChunks = pageChunks;
+
+	// A NAME CHANGED SEVERAL TIMES IS SETTLED ONCE, REMOVED IF ANY OF THOSE COMMANDS REMOVED IT
+	qsort(dirty, dirtyCount, sizeof(struct dirtyName), compareDirty);
+
+	size_t distinct = 0;
+	for (size_t i = 0; i < dirtyCount; i++) {
+		if (distinct > 0 && strcmp(dirty[distinct - 1].name, dirty[i].name) == 0) {
+			dirty[distinct - 1].removed |= dirty[i].removed;
+			free(dirty[i].name);
+		} else {
+			dirty[distinct++] = dirty[i];
+		}
+	}
+	dirtyCount = distinct;
+
+	// A PAGE REMOVED SINCE, EVEN IF IT IS BACK, LOSES ITS NUMBER, SO OLD LINKS TO IT STAY DEAD
+	for (size_t i = 0; i < dirtyCount; i++) {
+
+		struct token name = { dirty[i].name, strlen(dirty[i].name) };
+		struct page *node = findNode(name);
+		int64_t page = versionLookup(version, name);
+
+		if (page >= 0 && (dirty[i].removed || node == NULL)) {
+			if (setList(version, page, removedList) != 0) {
+				goto failed;
+			}
+			version->removedCount++;
+			page = -1;
+		}
+		if (node != NULL && page < 0 && addPage(version, name) != 0) {
+			goto failed;
+		}
+	}
+
+	// LINKS ARE COPIED ONCE EVERY PAGE THEY CAN POINT TO HAS ITS NUMBER
+	for (size_t i = 0; i < dirtyCount; i++) {
+
+		struct token name = { dirty[i].name, strlen(dirty[i].name) };
+		struct page *node = findNode(name);
+
+		if (node != NULL && relink(version, versionLookup(version, name), node) != 0) {
+			goto failed;
+		}
+	}
+
+	base->versions++;
+	settleView(version);
+	return version;
+
+failed:
+	fprintf(stderr, "Ran Out Of Memory.\n");
+	if (version != NULL) {
+		free(version->pages);
+		free(version->names);
+		free(version);
+	}
+	return NULL;
+}
+
+
+
+/*
+* freeVersion(version) -- frees 'version', and its base too if no other version is built on it.
+*/
+static void freeVersion(struct graphVersion *version) {
+
+	struct versionBase *base = version->base;
+
+	free(version->pages);
+	free(version->names);
+	free(version);
+
+	if (--base->versions == 0) {
+		baseFree(base);
+	}
+}
+
+
+
+/*
+* versionStart(count) -- sets up the epochs of 'count' reader threads, numbered from 0. Returns 0
+* on success, 1 if out of memory.
+*/
+int versionStart(size_t count) {
+
+	readers = aligned_alloc(64, (count > 0 ? count : 1) * sizeof(struct versionReader));
+
+	if (readers == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		atomic_init(&readers[i].seq, 0);
+	}
+	readerCount = count;
+	return 0;
+}
+
+
+
+/*
+* addDirty(name, removed) -- remembers that a command named the page 'name', removing it if
+* 'removed' is set. If that can't be remembered the next version is packed from scratch.
+*/
+static void addDirty(struct token name, int removed) {
+
+	char *copy = internName(name);
+
+	if (copy == NULL || growArray((void **) &dirty, &dirtyCap, sizeof(struct dirtyName), dirtyCount + 1) != 0) {
+		free(copy);
+		repack = 1;
+		return;
+	}
+	dirty[dirtyCount].name = copy;
+	dirty[dirtyCount].removed = removed;
+	dirtyCount++;
+}
+
+
+
+/*
+* versionChange(tag, args, count) -- called by the writer before it runs a command other than a
+* query, with its tag and arguments, so the next version covers what it changes. The first such
+* command after the server adopted a view copies it into the list graph. Returns 0 on success, 1
+* if that copy failed.
+*/
+int versionChange(int tag, const struct token *args, size_t count) {
+
+	int failed = 0;
+
+	if (current == NULL || tag == CMD_INVALID || tag == CMD_IS_CONNECTED) {
+		return 0;
+	}
+
+	// READERS KEEP SEARCHING THE VIEW WHILE THE WRITER WORKS ON ITS COPY
+	struct versionBase *base = current->base;
+	if (base->adopted && !base->thawed) {
+		failed = base->view.ops->thaw(base->view.impl);
+		base->thawed = 1;
+	}
+
+	switch (tag) {
+	case CMD_ADD_PAGES:
+	case CMD_REMOVE_PAGES:
+		for (size_t i = 0; i < count; i++) {
+			addDirty(args[i], tag == CMD_REMOVE_PAGES);
+		}
+		changed = 1;
+		break;
+
+	case CMD_ADD_LINKS:
+	case CMD_REMOVE_LINKS:
+		if (count > 0) {
+			addDirty(args[0], 0);
+		}
+		changed = 1;
+		break;
+
+	case CMD_LOAD_EDGES:
+		repack = 1;
+		changed = 1;
+		break;
+	}
+	return failed;
+}
+
+
+
+/*
+* versionPublish() -- returns the current version, first publishing a new one if the graph has
+* changed since. The replaced version is retired for versionReclaim(). Returns NULL on error.
+*/
+const struct graphVersion * versionPublish(void) {
+
+	struct graphVersion *next;
+
+	if (current != NULL && !changed) {
+		return current;
+	}
+
+	if (current == NULL || repack || current->base->deltaBytes > current->base->deltaLimit ||
+	    2 * (current->addedCount + dirtyCount) > current->base->nameSlots) {
+		next = packVersion();
+	} else {
+		next = deriveVersion(current);
+	}
+
+	if (next == NULL) {
+		return NULL;
+	}
+	clearDirty();
+
+	if (current != NULL) {
+		current->nextRetired = NULL;
+		if (retiredTail != NULL) {
+			retiredTail->nextRetired = current;
+		} else {
+			retiredHead = current;
+		}
+		retiredTail = current;
+	}
+	current = next;
+	return current;
+}
+
+
+
+/*
+* versionEnter(reader, version) -- announces that reader thread 'reader' is about to search
+* 'version'. It must be called before the version could be reclaimed, that is while the reader
+* still holds whatever kept it alive until then.
+*/
+void versionEnter(size_t reader, const struct graphVersion *version) {
+
+	atomic_store(&readers[reader].seq, version->seq);
+}
+
+
+
+/*
+* versionExit(reader) -- announces that reader thread 'reader' is done with its version.
+*/
+void versionExit(size_t reader) {
+
+	atomic_store(&readers[reader].seq, 0);
+}
+
+
+
+/*
+* versionReclaim(oldest) -- frees the retired versions older than both 'oldest', the oldest version
+* the writer still has handed out, and every version a reader has entered.
+*/
+void versionReclaim(unsigned long oldest) {
+
+	for (size_t i = 0; i < readerCount; i++) {
+		unsigned long seq = atomic_load(&readers[i].seq);
+		if (seq != 0 && seq < oldest) {
+			oldest = seq;
+		}
+	}
+
+	while (retiredHead != NULL && retiredHead->seq < oldest) {
+		struct graphVersion *done = retiredHead;
+		retiredHead = done->nextRetired;
+		if (retiredHead == NULL) {
+			retiredTail = NULL;
+		}
+		freeVersion(done);
+	}
+}
+
+
+
+/*
+* versionStop() -- frees every version once the readers have stopped. A view the server adopted
+* and never changed goes back to being the frozen view.
+*/
+void versionStop(void) {
+
+	versionReclaim(ULONG_MAX);
+
+	if (current != NULL) {
+		struct versionBase *base = current->base;
+		if (base->adopted && !base->thawed) {
+			frozenView = base->view;
+			base->view.ops = NULL;
+		}
+		freeVersion(current);
+		current = NULL;
+	}
+
+	clearDirty();
+	free(dirty);
+	free(readers);
+	dirty = NULL;
+	dirtyCap = 0;
+	readers = NULL;
+	readerCount = 0;
+}
@@ -0,0 +1,67 @@
+#ifndef VERSION_H
+#define VERSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scan.h"
+#include "view.h"
+
+
+/*
+ * File: version.h
+ * Author: Chance Krueger
+ * Purpose: Published graph versions for the server. One writer thread changes the
+ *          list graph as usual; before a query needs to see those changes it
+ *          publishes a new, immutable version of the graph, and reader threads
+ *          search versions without ever taking a lock or seeing a list half
+ *          written. A version is a packed base graph plus copy-on-write chunks
+ *          holding the pages added, removed or relinked since the base was
+ *          packed, so publishing costs about as much as the change, and the base
+ *          is repacked once the changes grow large. Versions are freed with
+ *          epoch-based reclamation: every reader announces the version it is
+ *          searching, and a replaced version goes once no reader can still hold it.
+ */
+
+
+
+struct versionBase;
+struct pageChunk;
+struct nameChunk;
+
+
+
+/*
+ * graphVersion -- One published version of the graph, searched through `view`.
+ * `seq` numbers versions from 1 in the order they were published. Pages from
+ * `base` keep their numbers; `pages` overrides the link lists of pages changed
+ * since, names the ones added after the base, and marks the removed ones, and
+ * `names` finds the added ones by name. `nextRetired` chains replaced versions
+ * waiting to be freed.
+ */
+struct graphVersion {
+
+
+	struct graphView view;
+	unsigned long seq;
+	struct versionBase *base;
+	uint32_t pageCount;
+	uint32_t removedCount;
+	uint32_t addedCount;
+	struct pageChunk **pages;
+	size_t pageChunks;
+	struct nameChunk **names;
+	struct graphVersion *nextRetired;
+};
+
+
+
+int versionStart(size_t readers);
+int versionChange(int tag, const struct token *args, size_t count);
+const struct graphVersion * versionPublish(void);
+void versionEnter(size_t reader, const struct graphVersion *version);
+void versionExit(size_t reader);
+void versionReclaim(unsigned long oldest);
+void versionStop(void);
+
+#endif
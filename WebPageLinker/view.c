@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "view.h"
+#include "stats.h"
+
+
+/*
+ * File: view.c
+ * Author: Chance Krueger
+ * Purpose: The traversal shared by every read-only graph view.
+ */
+
+
+
+/*
+* scratchReserveStack(scratch, need) -- makes sure `scratch->stack` holds 'need' entries.
+* Returns 0 on success, 1 if out of memory.
+*/
+int scratchReserveStack(struct viewScratch *scratch, size_t need) {
+
+	if (need <= scratch->stackCap) {
+		return 0;
+	}
+
+	size_t newCap = scratch->stackCap == 0 ? 1024 : scratch->stackCap;
+	while (newCap < need) {
+		newCap *= 2;
+	}
+
+	uint32_t *grown = realloc(scratch->stack, newCap * sizeof(uint32_t));
+	if (grown == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+	scratch->stack = grown;
+	scratch->stackCap = newCap;
+	return 0;
+}
+
+
+
+/*
+* scratchReserveBuf(scratch, count) -- makes sure `scratch->buf` holds 'count' page numbers.
+* Returns 0 on success, 1 if out of memory.
+*/
+int scratchReserveBuf(struct viewScratch *scratch, size_t count) {
+
+	if (count <= scratch->bufCap) {
+		return 0;
+	}
+
+	size_t newCap = scratch->bufCap == 0 ? 1024 : scratch->bufCap;
+	while (newCap < count) {
+		newCap *= 2;
+	}
+
+	uint32_t *grown = realloc(scratch->buf, newCap * sizeof(uint32_t));
+	if (grown == NULL) {
+		fprintf(stderr, "Ran Out Of Memory.\n");
+		return 1;
+	}
+	scratch->buf = grown;
+	scratch->bufCap = newCap;
+	return 0;
+}
+
+
+
+/*
+* startSearch(scratch, pages) -- makes room for the visited marks of a view of 'pages' pages and
+* opens a new search epoch, clearing the marks only when the epoch counter wraps. The marks only
+* grow, with some slack, so views that gain a few pages at a time don't reallocate every search.
+* Returns 0 on success, 1 if out of memory.
+*/
+static int startSearch(struct viewScratch *scratch, uint32_t pages) {
+
+	uint64_t start = statsBegin();
+
+	if (scratch->seen == NULL || pages > scratch->pages) {
+
+		size_t room = (size_t) pages + pages / 8 + 1;
+		room = room > UINT32_MAX ? UINT32_MAX : room;
+		uint32_t *grown = realloc(scratch->seen, room * sizeof(uint32_t));
+
+		if (grown == NULL) {
+			fprintf(stderr, "Ran Out Of Memory.\n");
+			return 1;
+		}
+		memset(grown + scratch->pages, 0, (room - scratch->pages) * sizeof(uint32_t));
+		scratch->seen = grown;
+		scratch->pages = room;
+	}
+
+	if (++scratch->epoch == 0) {
+		memset(scratch->seen, 0, scratch->pages * sizeof(uint32_t));
+		scratch->epoch = 1;
+	}
+	statsEnd(STAT_START_SEARCH, start);
+	return 0;
+}
+
+
+
+/*
+* searchView(view, from, to, scratch) -- returns 1 if page 'to' can be reached from page 'from'
+* by following links in 'view', otherwise 0 (or -1 if out of memory). A page always
+* reaches itself. The search is depth-first with an explicit stack, so deep graphs can't overflow
+* the call stack, and marks pages with the scratch epoch instead of resetting flags afterwards.
+* A backend with its own reachable() gets the opened epoch and does the search itself.
+*/
+static int searchView(const struct graphView *view, uint32_t from, uint32_t to, struct viewScratch *scratch) {
+
+	if (from == to) {
+		return 1;
+	}
+
+	// A page nothing links to cannot be reached, whatever the size of the graph.
+	const uint32_t *in;
+	if (view->ops->predecessors != NULL && view->ops->predecessors(view->impl, to, scratch, &in) == 0) {
+		return 0;
+	}
+
+	if (startSearch(scratch, view->pageCount) != 0 || scratchReserveStack(scratch, 1) != 0) {
+		return -1;
+	}
+
+	if (view->ops->reachable != NULL) {
+		return view->ops->reachable(view->impl, from, to, scratch);
+	}
+
+	size_t depth = 0;
+	scratch->stack[depth++] = from;
+	scratch->seen[from] = scratch->epoch;
+
+	while (depth > 0) {
+
+		const uint32_t *next;
+		uint32_t count = view->ops->successors(view->impl, scratch->stack[--depth], scratch, &next);
+
+		if (scratchReserveStack(scratch, depth + count) != 0) {
+			return -1;
+		}
+
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t page = next[i];
+			if (page == to) {
+				return 1;
+			}
+			if (page < view->pageCount && scratch->seen[page] != scratch->epoch) {
+				scratch->seen[page] = scratch->epoch;
+				scratch->stack[depth++] = page;
+			}
+		}
+	}
+	return 0;
+}
+
+
+
+/*
+* viewReachable(view, from, to, scratch) -- answers whether page 'to' can be reached from page
+* 'from' in 'view' with searchView(), timing the search for --stats.
+*/
+int viewReachable(const struct graphView *view, uint32_t from, uint32_t to, struct viewScratch *scratch) {
+
+	uint64_t start = statsBegin();
+	int reached = searchView(view, from, to, scratch);
+
+	statsEnd(STAT_SEARCH, start);
+	return reached;
+}
+
+
+
+/*
+* scratchFree(scratch) -- frees the memory held by 'scratch'.
+*/
+void scratchFree(struct viewScratch *scratch) {
+
+	free(scratch->seen);
+	free(scratch->stack);
+	free(scratch->buf);
+	memset(scratch, 0, sizeof(struct viewScratch));
+}
+
+
+
+/*
+* viewClose(view) -- releases the backend state of 'view'.
+*/
+void viewClose(struct graphView *view) {
+
+	if (view->ops != NULL) {
+		view->ops->close(view->impl);
+	}
+	view->ops = NULL;
+	view->impl = NULL;
+}
+
+
+
+/*
+* viewThaw(view) -- turns the view open in 'view' back into ordinary pages and links so the graph
+* can change again, then closes it. Does nothing if no view is open. Returns 0 on success, 1 on error.
+*/
+int viewThaw(struct graphView *view) {
+
+	if (view->ops == NULL) {
+		return 0;
+	}
+
+	int failed = view->ops->thaw(view->impl);
+
+	viewClose(view);
+	return failed;
+}
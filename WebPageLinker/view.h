@@ -0,0 +1,89 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scan.h"
+
+
+/*
+ * File: view.h
+ * Author: Chance Krueger
+ * Purpose: Read-only graph views. A view answers @isConnected straight from some
+ *          frozen storage (a mapped snapshot, packed adjacency lists or a k²-tree)
+ *          without building `struct page` and `struct link` nodes. Each backend supplies name lookup and successor
+ *          lists through viewOps; the traversal itself is shared.
+ */
+
+
+
+/*
+ * viewScratch -- Per-search working memory for viewReachable(). `seen[page]` equals
+ * `epoch` when the page was visited by the current search, so starting a new search
+ * only bumps `epoch`; `pages` is how many marks `seen` has room for. `stack` holds
+ * pages still to expand and `buf` is room for a backend that has to decode a
+ * successor list before returning it.
+ */
+struct viewScratch {
+
+
+	uint32_t *seen;
+	uint32_t epoch;
+	uint32_t pages;
+	uint32_t *stack;
+	size_t stackCap;
+	uint32_t *buf;
+	size_t bufCap;
+};
+
+
+
+/*
+ * viewOps -- The operations a view backend implements. lookup() returns the page
+ * number for a name or -1, successors() points '*out' at the page numbers 'page'
+ * links to (possibly inside 'scratch->buf') and returns how many there are,
+ * predecessors() does the same for the pages linking to 'page' (NULL when a backend
+ * cannot answer it cheaply), reachable() replaces the shared traversal for a backend
+ * with a better one of its own (or is NULL), and thaw() adds the view's pages and links to the
+ * (empty) list graph.
+ */
+struct viewOps {
+
+
+	const char *name;
+	int64_t (*lookup)(const void *impl, struct token name);
+	uint32_t (*successors)(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out);
+	uint32_t (*predecessors)(const void *impl, uint32_t page, struct viewScratch *scratch, const uint32_t **out);
+	int (*reachable)(const void *impl, uint32_t from, uint32_t to, struct viewScratch *scratch);
+	int (*thaw)(const void *impl);
+	void (*close)(void *impl);
+};
+
+
+
+/*
+ * graphView -- One open view: its backend, the backend's state and its page count.
+ */
+struct graphView {
+
+
+	const struct viewOps *ops;
+	void *impl;
+	uint32_t pageCount;
+};
+
+
+
+extern struct graphView frozenView;
+
+
+
+int viewReachable(const struct graphView *view, uint32_t from, uint32_t to, struct viewScratch *scratch);
+int scratchReserveStack(struct viewScratch *scratch, size_t count);
+int scratchReserveBuf(struct viewScratch *scratch, size_t count);
+void scratchFree(struct viewScratch *scratch);
+int viewThaw(struct graphView *view);
+void viewClose(struct graphView *view);
+
+#endif